@@ -0,0 +1,138 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+// replaces the global allocation functions for the whole program, the only
+// overhead over malloc is a relaxed atomic increment per allocation and free
+namespace {
+std::atomic<uint64_t> allocationCount(0);
+std::atomic<uint64_t> freeCount(0);
+
+void* countedAllocate(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void countedFree(void* pointer)
+{
+    if (pointer != nullptr)
+    {
+        freeCount.fetch_add(1, std::memory_order_relaxed);
+        std::free(pointer);
+    }
+}
+} // namespace
+
+uint64_t getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+int64_t getLiveAllocationCount()
+{
+    return (int64_t)(allocationCount.load(std::memory_order_relaxed) - freeCount.load(std::memory_order_relaxed));
+}
+
+uint64_t getResidentBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+    {
+        return info.resident_size;
+    }
+    return 0;
+#else
+    // second field of statm is the resident set in pages
+    unsigned long long pages = 0;
+    std::FILE* file = std::fopen("/proc/self/statm", "r");
+    if (file == nullptr)
+    {
+        return 0;
+    }
+    if (std::fscanf(file, "%*s %llu", &pages) != 1)
+    {
+        pages = 0;
+    }
+    std::fclose(file);
+    return pages * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+    void* pointer = countedAllocate(size);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    countedFree(pointer);
+}
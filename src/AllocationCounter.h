@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// number of global operator new calls since start, from every thread.
+// benchmarks take the difference around a frame to find allocations in the hot path
+uint64_t getAllocationCount();
+
+// allocations not freed yet, steadily growing over a soak test means a leak
+int64_t getLiveAllocationCount();
+
+// memory of the process held in RAM, 0 where the platform isn't supported
+uint64_t getResidentBytes();
@@ -0,0 +1,160 @@
+#include "AudioEngine.h"
+#include "Profiler.h"
+
+#include <chrono>
+
+AudioEngine::~AudioEngine()
+{
+    close();
+}
+
+void AudioEngine::setup(int sampleRate, int bufferFrames_)
+{
+    close();
+    bufferFrames = bufferFrames_;
+    mixer.setup(sampleRate);
+}
+
+int AudioEngine::addCue(AudioCue&& cue)
+{
+    return mixer.addCue(std::move(cue));
+}
+
+bool AudioEngine::start(Backend backend_)
+{
+    close();
+    backend = backend_;
+    if (backend == soundCard)
+    {
+        scratch.assign(bufferFrames * 4 * AudioMixer::channels, 0.0f);
+        ofSoundStreamSettings settings;
+        settings.setOutListener(this);
+        settings.sampleRate = mixer.getSampleRate();
+        settings.numOutputChannels = AudioMixer::channels;
+        settings.numInputChannels = 0;
+        settings.bufferSize = bufferFrames;
+        settings.numBuffers = 2;
+        if (stream.setup(settings))
+        {
+            running = true;
+            ofLogNotice("AudioEngine") << "mixing at " << mixer.getSampleRate() << " Hz, " << bufferFrames << " frames per buffer ("
+                << bufferFrames * 1000.0 / mixer.getSampleRate() << " ms)";
+            return true;
+        }
+        ofLogError("AudioEngine") << "no sound card, mixing into the null output";
+        backend = nullOutput;
+    }
+
+    quit = false;
+    nullThread = std::thread(&AudioEngine::nullOutputThread, this);
+    running = true;
+    return backend == backend_;
+}
+
+void AudioEngine::close()
+{
+    if (!running)
+    {
+        return;
+    }
+    if (backend == soundCard)
+    {
+        stream.close();
+    }
+    else
+    {
+        quit = true;
+        nullThread.join();
+    }
+    running = false;
+}
+
+//--------------------------------------------------------------
+void AudioEngine::play(int cue, uint64_t timestampMicros)
+{
+    push(AudioCommandType::play, cue, 1, 0, timestampMicros);
+}
+
+void AudioEngine::stop(int cue)
+{
+    push(AudioCommandType::stop, cue, 0, 0, 0);
+}
+
+void AudioEngine::setVolume(int cue, float volume)
+{
+    push(AudioCommandType::volume, cue, volume, 0, 0);
+}
+
+void AudioEngine::duck(float level, float seconds)
+{
+    push(AudioCommandType::duck, -1, level, seconds, 0);
+}
+
+void AudioEngine::push(AudioCommandType type, int cue, float value, float seconds, uint64_t timestampMicros)
+{
+    AudioCommand command;
+    command.type = type;
+    command.cue = cue;
+    command.value = value;
+    command.seconds = seconds;
+    command.timestampMicros = timestampMicros != 0 ? timestampMicros : ofGetElapsedTimeMicros();
+    mixer.push(command);
+}
+
+const AudioMixer& AudioEngine::getMixer() const
+{
+    return mixer;
+}
+
+AudioEngine::Backend AudioEngine::getBackend() const
+{
+    return backend;
+}
+
+int AudioEngine::getBufferFrames() const
+{
+    return bufferFrames;
+}
+
+//--------------------------------------------------------------
+void AudioEngine::audioOut(ofSoundBuffer& buffer)
+{
+    // the sound card's thread, the buffer is heard about now
+    int frames = (int)buffer.getNumFrames();
+    int outputChannels = (int)buffer.getNumChannels();
+    if (outputChannels == AudioMixer::channels)
+    {
+        mixer.mix(buffer.getBuffer().data(), frames, ofGetElapsedTimeMicros());
+        return;
+    }
+
+    // the setup asked for stereo, a card that insists on more gets it on the first two channels
+    if ((int)scratch.size() < frames * AudioMixer::channels)
+    {
+        buffer.set(0);
+        return;
+    }
+    mixer.mix(scratch.data(), frames, ofGetElapsedTimeMicros());
+    float* out = buffer.getBuffer().data();
+    for (int i = 0; i < frames; i++)
+    {
+        for (int c = 0; c < outputChannels; c++)
+        {
+            out[i * outputChannels + c] = c < AudioMixer::channels ? scratch[i * AudioMixer::channels + c] : 0;
+        }
+    }
+}
+
+void AudioEngine::nullOutputThread()
+{
+    Profiler::setThreadName("audio");
+    std::vector<float> output(bufferFrames * AudioMixer::channels);
+    auto period = std::chrono::microseconds((int64_t)bufferFrames * 1000000 / mixer.getSampleRate());
+    auto next = std::chrono::steady_clock::now();
+    while (!quit)
+    {
+        mixer.mix(output.data(), bufferFrames, ofGetElapsedTimeMicros());
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ofMain.h"
+#include "AudioMixer.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// The game's sound. Cues are decoded up front and handed over with
+// addCue(), the game thread only queues timestamped commands, and an
+// AudioMixer turns them into samples on the audio thread: the sound card's
+// callback, or with the null backend a thread of its own that mixes at the
+// same pace into nowhere, for headless runs and machines without a sound card.
+class AudioEngine : public ofBaseSoundOutput {
+public:
+    enum Backend
+    {
+        soundCard = 0,
+        nullOutput = 1
+    };
+
+    ~AudioEngine();
+
+    // cues are added between setup() and start()
+    void setup(int sampleRate = 44100, int bufferFrames = 256);
+    int addCue(AudioCue&& cue);
+    bool start(Backend backend);
+    void close();
+
+    // game thread, the sound starts at timestampMicros on the ofGetElapsedTimeMicros() clock,
+    // 0 is now. Never blocks, a command is dropped if the audio thread stopped taking them
+    void play(int cue, uint64_t timestampMicros = 0);
+    void stop(int cue);
+    void setVolume(int cue, float volume);
+    void duck(float level, float seconds = 0.3f); // music cues only
+
+    const AudioMixer& getMixer() const;
+    Backend getBackend() const;
+    int getBufferFrames() const;
+
+    void audioOut(ofSoundBuffer& buffer) override;
+
+private:
+    void push(AudioCommandType type, int cue, float value, float seconds, uint64_t timestampMicros);
+    void nullOutputThread();
+
+    AudioMixer mixer;
+    Backend backend = soundCard;
+    int bufferFrames = 256;
+    bool running = false;
+
+    ofSoundStream stream;
+    std::vector<float> scratch; // sound cards with more than two channels
+
+    std::thread nullThread;
+    std::atomic<bool> quit{ false };
+};
@@ -0,0 +1,384 @@
+#include "AudioMixer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+const float volumeRampSeconds = 0.01f; // volume changes and the shortest duck take this long, no clicks
+
+uint32_t readU32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t readU16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// one sample of a wave file as -1..1
+float readSample(const uint8_t* p, int bits, bool isFloat)
+{
+    if (isFloat)
+    {
+        float value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+    switch (bits)
+    {
+    case 8:
+        return (p[0] - 128) / 128.0f;
+    case 16:
+        return (int16_t)readU16(p) / 32768.0f;
+    case 24:
+        return (int32_t)((p[0] << 8) | (p[1] << 16) | ((uint32_t)p[2] << 24)) / 2147483648.0f;
+    default:
+        return (int32_t)readU32(p) / 2147483648.0f;
+    }
+}
+
+float moveTowards(float value, float target, float step)
+{
+    return value < target ? std::min(value + step, target) : std::max(value - step, target);
+}
+
+} // namespace
+
+void AudioMixer::setup(int sampleRate_)
+{
+    sampleRate = sampleRate_;
+    numCues = 0;
+    numPending = 0;
+    for (Voice& voice : voices)
+    {
+        voice.cue = -1;
+    }
+    cueGain.fill(1);
+    cueTarget.fill(1);
+    musicGain = 1;
+    musicTarget = 1;
+    musicStep = 0;
+}
+
+int AudioMixer::addCue(AudioCue&& cue)
+{
+    if (numCues >= maxCues)
+    {
+        return -1;
+    }
+    cueGain[numCues] = cue.volume;
+    cueTarget[numCues] = cue.volume;
+    cues[numCues] = std::move(cue);
+    return numCues++;
+}
+
+int AudioMixer::getSampleRate() const
+{
+    return sampleRate;
+}
+
+bool AudioMixer::push(const AudioCommand& command)
+{
+    if (!commands.push(command))
+    {
+        droppedCommands++;
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void AudioMixer::mix(float* output, int frames, uint64_t bufferMicros)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::fill(output, output + frames * channels, 0.0f);
+
+    // everything due before the end of this buffer starts in it, at its own frame
+    uint64_t bufferEnd = bufferMicros + (uint64_t)frames * 1000000 / sampleRate;
+    auto offsetOf = [&](uint64_t timestamp) {
+        return timestamp > bufferMicros ? (int)((timestamp - bufferMicros) * sampleRate / 1000000) : 0;
+    };
+    int kept = 0;
+    for (int i = 0; i < numPending; i++)
+    {
+        if (pending[i].timestampMicros < bufferEnd)
+        {
+            apply(pending[i], offsetOf(pending[i].timestampMicros), bufferMicros);
+        }
+        else
+        {
+            pending[kept++] = pending[i];
+        }
+    }
+    numPending = kept;
+    AudioCommand command;
+    while (commands.pop(command))
+    {
+        if (command.timestampMicros < bufferEnd)
+        {
+            apply(command, offsetOf(command.timestampMicros), bufferMicros);
+        }
+        else if (numPending < (int)pending.size())
+        {
+            pending[numPending++] = command;
+        }
+        else
+        {
+            droppedCommands++;
+        }
+    }
+
+    // gains move linearly over the buffer towards their targets
+    std::array<float, maxCues> startGain = cueGain;
+    float rampStep = frames / (volumeRampSeconds * sampleRate);
+    for (int c = 0; c < numCues; c++)
+    {
+        cueGain[c] = moveTowards(cueGain[c], cueTarget[c], rampStep);
+    }
+    float startMusic = musicGain;
+    musicGain = moveTowards(musicGain, musicTarget, musicStep * frames);
+
+    int active = 0;
+    for (Voice& voice : voices)
+    {
+        if (voice.cue < 0)
+        {
+            continue;
+        }
+        const AudioCue& cue = cues[voice.cue];
+        const float g0 = startGain[voice.cue];
+        const float g1 = cueGain[voice.cue];
+        const float m0 = cue.music ? startMusic : 1;
+        const float m1 = cue.music ? musicGain : 1;
+        int frame = voice.startOffset;
+        voice.startOffset = 0;
+        for (; frame < frames; frame++)
+        {
+            if (voice.position >= cue.frames)
+            {
+                if (!cue.loop)
+                {
+                    voice.cue = -1;
+                    break;
+                }
+                voice.position = 0;
+            }
+            float t = (float)frame / frames;
+            float gain = (g0 + (g1 - g0) * t) * (m0 + (m1 - m0) * t) / 32768.0f;
+            const int16_t* sample = &cue.samples[(size_t)voice.position * channels];
+            output[frame * channels] += sample[0] * gain;
+            output[frame * channels + 1] += sample[1] * gain;
+            voice.position++;
+        }
+        if (voice.cue >= 0)
+        {
+            active++;
+        }
+    }
+
+    for (int i = 0; i < frames * channels; i++)
+    {
+        output[i] = std::max(std::min(output[i], 1.0f), -1.0f);
+    }
+    activeVoices = active;
+    lastMixMicros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void AudioMixer::apply(const AudioCommand& command, int offset, uint64_t bufferMicros)
+{
+    if (command.type == AudioCommandType::duck)
+    {
+        musicTarget = command.value;
+        musicStep = std::abs(musicTarget - musicGain) / (std::max(command.seconds, volumeRampSeconds) * sampleRate);
+        return;
+    }
+    if (command.cue < 0 || command.cue >= numCues)
+    {
+        return;
+    }
+
+    switch (command.type)
+    {
+    case AudioCommandType::play:
+    {
+        startVoice(command.cue, offset);
+        uint64_t sounds = bufferMicros + (uint64_t)offset * 1000000 / sampleRate;
+        uint64_t latency = sounds > command.timestampMicros ? sounds - command.timestampMicros : 0;
+        lastLatencyMicros = latency;
+        if (latency > maxLatencyMicros)
+        {
+            maxLatencyMicros = latency;
+        }
+        break;
+    }
+    case AudioCommandType::stop:
+        for (Voice& voice : voices)
+        {
+            if (voice.cue == command.cue)
+            {
+                voice.cue = -1;
+            }
+        }
+        break;
+    case AudioCommandType::volume:
+        cueTarget[command.cue] = std::max(std::min(command.value, 1.0f), 0.0f);
+        break;
+    default:
+        break;
+    }
+}
+
+void AudioMixer::startVoice(int cue, int offset)
+{
+    // a file that didn't decode stays silent
+    if (cues[cue].frames == 0)
+    {
+        return;
+    }
+
+    Voice* freeVoice = nullptr;
+    Voice* oldest = &voices[0];
+    for (Voice& voice : voices)
+    {
+        if (voice.cue == cue && cues[cue].loop)
+        {
+            return;
+        }
+        if (voice.cue < 0 && freeVoice == nullptr)
+        {
+            freeVoice = &voice;
+        }
+        if (voice.started < oldest->started)
+        {
+            oldest = &voice;
+        }
+    }
+
+    // all voices busy, the one playing longest is cut off
+    Voice& voice = freeVoice != nullptr ? *freeVoice : *oldest;
+    voice.cue = cue;
+    voice.position = 0;
+    voice.startOffset = offset;
+    voice.started = ++voicesStarted;
+}
+
+//--------------------------------------------------------------
+uint64_t AudioMixer::getLastLatencyMicros() const
+{
+    return lastLatencyMicros;
+}
+
+uint64_t AudioMixer::getMaxLatencyMicros() const
+{
+    return maxLatencyMicros;
+}
+
+uint64_t AudioMixer::getDroppedCommands() const
+{
+    return droppedCommands;
+}
+
+uint64_t AudioMixer::getLastMixMicros() const
+{
+    return lastMixMicros;
+}
+
+int AudioMixer::getActiveVoices() const
+{
+    return activeVoices;
+}
+
+//--------------------------------------------------------------
+bool AudioMixer::decodeWav(const std::string& path, int sampleRate, AudioCue& cue, std::string& error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        error = "can't open " + path;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 || std::memcmp(data.data() + 8, "WAVE", 4) != 0)
+    {
+        error = path + " is not a wave file";
+        return false;
+    }
+
+    // walk the chunks for the format and the samples
+    int format = 0;
+    int fileChannels = 0;
+    int fileRate = 0;
+    int bits = 0;
+    const uint8_t* samples = nullptr;
+    size_t sampleBytes = 0;
+    size_t at = 12;
+    while (at + 8 <= data.size())
+    {
+        const uint8_t* chunk = data.data() + at;
+        size_t size = readU32(chunk + 4);
+        size_t available = std::min(size, data.size() - at - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16)
+        {
+            format = readU16(chunk + 8);
+            fileChannels = readU16(chunk + 10);
+            fileRate = (int)readU32(chunk + 12);
+            bits = readU16(chunk + 22);
+            if (format == 0xFFFE && available >= 26)
+            {
+                format = readU16(chunk + 32); // extensible, the sub format starts with the plain format tag
+            }
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            samples = chunk + 8;
+            sampleBytes = available;
+        }
+        at += 8 + size + (size & 1);
+    }
+
+    bool isFloat = format == 3 && bits == 32;
+    if ((format != 1 && !isFloat) || (format == 1 && bits != 8 && bits != 16 && bits != 24 && bits != 32) || fileChannels < 1 || fileRate <= 0 || samples == nullptr)
+    {
+        error = path + ": only PCM and float wave files are supported";
+        return false;
+    }
+
+    // to stereo, mono is doubled and further channels are dropped
+    int bytesPerSample = bits / 8;
+    size_t fileFrames = sampleBytes / (bytesPerSample * fileChannels);
+    if (fileFrames == 0)
+    {
+        error = path + " has no samples";
+        return false;
+    }
+    std::vector<float> stereo(fileFrames * channels);
+    for (size_t i = 0; i < fileFrames; i++)
+    {
+        const uint8_t* frame = samples + i * bytesPerSample * fileChannels;
+        stereo[i * 2] = readSample(frame, bits, isFloat);
+        stereo[i * 2 + 1] = fileChannels > 1 ? readSample(frame + bytesPerSample, bits, isFloat) : stereo[i * 2];
+    }
+
+    // linear resampling to the mixer rate
+    size_t frames = fileRate == sampleRate ? fileFrames : (size_t)((double)fileFrames * sampleRate / fileRate);
+    cue.samples.resize(frames * channels);
+    for (size_t i = 0; i < frames; i++)
+    {
+        double position = fileRate == sampleRate ? (double)i : (double)i * fileRate / sampleRate;
+        size_t i0 = std::min((size_t)position, fileFrames - 1);
+        size_t i1 = std::min(i0 + 1, fileFrames - 1);
+        float t = (float)(position - i0);
+        for (int c = 0; c < channels; c++)
+        {
+            float value = stereo[i0 * 2 + c] + (stereo[i1 * 2 + c] - stereo[i0 * 2 + c]) * t;
+            cue.samples[i * 2 + c] = (int16_t)std::lround(std::max(std::min(value, 1.0f), -1.0f) * 32767.0f);
+        }
+    }
+    cue.frames = (int)frames;
+    return true;
+}
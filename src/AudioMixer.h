@@ -0,0 +1,103 @@
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one sound, decoded to 16 bit stereo at the mixer's sample rate
+struct AudioCue {
+    std::vector<int16_t> samples; // interleaved left, right
+    int frames = 0;
+    bool loop = false;
+    bool music = false; // lowered by duck()
+    float volume = 1;
+};
+
+enum class AudioCommandType
+{
+    play,   // start a voice of the cue, a looping cue that already plays keeps playing
+    stop,   // every voice of the cue
+    volume, // of the cue, value 0-1
+    duck    // all music cues to value over seconds
+};
+
+struct AudioCommand {
+    AudioCommandType type = AudioCommandType::play;
+    int cue = 0;
+    float value = 1;
+    float seconds = 0;
+    uint64_t timestampMicros = 0; // when it should sound, earlier ones sound as soon as possible
+};
+
+// Mixes preloaded cues on the audio thread. Commands come from one game
+// thread through a lock-free queue and are applied sample accurately at
+// their timestamp, so nothing on the audio thread waits, allocates or reads
+// a file. Volume changes are ramped to avoid clicks. Nothing in here
+// touches openFrameworks, a null backend can drive it headless.
+class AudioMixer {
+public:
+    static const int channels = 2;
+    static const int maxCues = 16;
+    static const int maxVoices = 16;
+
+    // before the audio thread starts
+    void setup(int sampleRate);
+    int addCue(AudioCue&& cue); // returns the cue's number, cues are numbered in the order they are added
+    int getSampleRate() const;
+
+    // game thread, false if the queue is full and the command was dropped
+    bool push(const AudioCommand& command);
+
+    // audio thread: frames of interleaved stereo, bufferMicros is when the first frame sounds
+    void mix(float* output, int frames, uint64_t bufferMicros);
+
+    // any thread
+    uint64_t getLastLatencyMicros() const; // command timestamp until its first sample, play commands only
+    uint64_t getMaxLatencyMicros() const;
+    uint64_t getDroppedCommands() const;   // the queue was full
+    uint64_t getLastMixMicros() const;     // time mix() took on its last call
+    int getActiveVoices() const;
+
+    // RIFF wave files, 8/16/24/32 bit integer or 32 bit float, any rate and channel count.
+    // Safe to call from any thread, e.g. several startup workers at once
+    static bool decodeWav(const std::string& path, int sampleRate, AudioCue& cue, std::string& error);
+
+private:
+    struct Voice {
+        int cue = -1; // -1 while free
+        int position = 0;
+        int startOffset = 0; // frames into the current buffer before it starts
+        uint64_t started = 0; // for stealing the oldest voice
+    };
+
+    void apply(const AudioCommand& command, int offset, uint64_t bufferMicros);
+    void startVoice(int cue, int offset);
+
+    int sampleRate = 44100;
+    std::array<AudioCue, maxCues> cues;
+    int numCues = 0;
+
+    // game thread to audio thread
+    SpscQueue<AudioCommand, 256> commands;
+    std::atomic<uint64_t> droppedCommands{ 0 };
+
+    // audio thread only. Commands for a later buffer wait here
+    std::array<AudioCommand, 64> pending;
+    int numPending = 0;
+    std::array<Voice, maxVoices> voices;
+    uint64_t voicesStarted = 0;
+    std::array<float, maxCues> cueGain;
+    std::array<float, maxCues> cueTarget;
+    float musicGain = 1;
+    float musicTarget = 1;
+    float musicStep = 0; // per frame
+
+    std::atomic<uint64_t> lastLatencyMicros{ 0 };
+    std::atomic<uint64_t> maxLatencyMicros{ 0 };
+    std::atomic<uint64_t> lastMixMicros{ 0 };
+    std::atomic<int> activeVoices{ 0 };
+};
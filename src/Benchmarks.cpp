@@ -0,0 +1,1254 @@
+#include "Benchmarks.h"
+#include "DepthThreshold.h"
+#include "BlobLabeler.h"
+#include "BubblePlacer.h"
+#include "DepthRecording.h"
+#include "PersonTracker.h"
+#include "GameSimulation.h"
+#include "PipelineStats.h"
+#include "AllocationCounter.h"
+#include "NetworkSync.h"
+#include "SyntheticCrowd.h"
+#include "AudioEngine.h"
+
+#include "ofMain.h"
+#include "ofxOpenCv.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace {
+
+const int benchmarkIterations = 500;
+
+// the benchmarks can run beside the game, which draws from ofRandom() on the render thread
+thread_local std::mt19937 syntheticRandom(1);
+
+int randomInt(int from, int to) // from <= value < to
+{
+    return std::uniform_int_distribution<int>(from, to - 1)(syntheticRandom);
+}
+
+// a floor at mid depth with a few people standing on it
+void fillSyntheticDepth(ofPixels& depth, int width, int height, int people = 8)
+{
+    depth.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    unsigned char* data = depth.getData();
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int value = 60 + (y * 40) / height + randomInt(0, 6);
+            data[y * width + x] = (unsigned char)value;
+        }
+    }
+    for (int person = 0; person < people; person++)
+    {
+        int cx = randomInt(20, width - 20);
+        int cy = randomInt(20, height - 20);
+        int radius = randomInt(10, 30);
+        for (int y = std::max(cy - radius, 0); y < std::min(cy + radius, height); y++)
+        {
+            for (int x = std::max(cx - radius, 0); x < std::min(cx + radius, width); x++)
+            {
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius)
+                {
+                    data[y * width + x] = 180;
+                }
+            }
+        }
+    }
+}
+
+// floor of fillSyntheticDepth() with four people walking circles over it
+void moveSyntheticPeople(const ofPixels& floor, ofPixels& depth, int frame)
+{
+    const int width = (int)floor.getWidth();
+    const int height = (int)floor.getHeight();
+    std::memcpy(depth.getData(), floor.getData(), floor.getTotalBytes());
+    unsigned char* data = depth.getData();
+    for (int person = 0; person < 4; person++)
+    {
+        float angle = frame * 0.02f + person * TWO_PI / 4;
+        int cx = width / 2 + (int)(std::cos(angle) * width / 3);
+        int cy = height / 2 + (int)(std::sin(angle) * height / 3);
+        const int radius = 18;
+        for (int y = std::max(cy - radius, 0); y < std::min(cy + radius, height); y++)
+        {
+            for (int x = std::max(cx - radius, 0); x < std::min(cx + radius, width); x++)
+            {
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius)
+                {
+                    data[y * width + x] = 180;
+                }
+            }
+        }
+    }
+}
+
+template<typename F>
+double timePerIteration(F&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < benchmarkIterations; i++)
+    {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / benchmarkIterations;
+}
+
+void benchmarkThresholdAt(int width, int height)
+{
+    const int nearThreshold = 230;
+    const int farThreshold = 100;
+
+    ofPixels depth;
+    fillSyntheticDepth(depth, width, height);
+
+    ofxCvGrayscaleImage grayImage;
+    ofxCvGrayscaleImage grayThreshNear;
+    ofxCvGrayscaleImage grayThreshFar;
+    grayImage.setUseTexture(false);
+    grayThreshNear.setUseTexture(false);
+    grayThreshFar.setUseTexture(false);
+    grayImage.allocate(width, height);
+    grayThreshNear.allocate(width, height);
+    grayThreshFar.allocate(width, height);
+
+    double openCvMicros = timePerIteration([&] {
+        grayImage.setFromPixels(depth);
+        grayThreshNear = grayImage;
+        grayThreshFar = grayImage;
+        grayThreshNear.threshold(nearThreshold, true);
+        grayThreshFar.threshold(farThreshold);
+        cvAnd(grayThreshNear.getCvImage(), grayThreshFar.getCvImage(), grayImage.getCvImage(), NULL);
+        grayImage.flagImageChanged();
+    });
+
+    DepthThreshold depthThreshold;
+    depthThreshold.setup(width, height);
+    ofPixels mask;
+    mask.allocate(width, height, OF_IMAGE_GRAYSCALE);
+
+    double fusedMicros = timePerIteration([&] {
+        depthThreshold.apply(depth.getData(), width, mask.getData(), width, nearThreshold, farThreshold);
+    });
+    double openMicros = timePerIteration([&] {
+        depthThreshold.apply(depth.getData(), width, mask.getData(), width, nearThreshold, farThreshold, DepthThreshold::open);
+    });
+
+    ofLogNotice("Benchmark") << "threshold " << width << "x" << height
+        << ": opencv chain " << openCvMicros << " us"
+        << ", fused " << DepthThreshold::getInstructionSet() << " " << fusedMicros << " us"
+        << " (" << openCvMicros / std::max(fusedMicros, 0.001) << "x)"
+        << ", fused + open " << openMicros << " us";
+}
+
+// the contour finder and the labeler on the same masks, times are per frame
+struct LabelerTimes {
+    double contourMicros = 0;
+    double singleMicros = 0;
+    double parallelMicros = 0;
+    int stripes = 1;
+    int mismatches = 0; // frames where the two disagreed on the number of blobs
+};
+
+LabelerTimes benchmarkLabelerOn(const std::vector<ofPixels>& masks, int minArea, int maxArea, int maxBlobs)
+{
+    const int width = (int)masks[0].getWidth();
+    const int height = (int)masks[0].getHeight();
+    const int repeats = std::max(benchmarkIterations / (int)masks.size(), 1);
+    const int frames = repeats * (int)masks.size();
+
+    ofxCvGrayscaleImage grayImage;
+    grayImage.setUseTexture(false);
+    grayImage.allocate(width, height);
+    ofxCvContourFinder contourFinder;
+    BlobLabeler single;
+    single.setup(width, height, 1);
+    BlobLabeler parallel;
+    parallel.setup(width, height, 0);
+    std::vector<LabeledBlob> blobs;
+
+    LabelerTimes times;
+    times.stripes = parallel.getNumStripes();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        grayImage.setFromPixels(masks[i % masks.size()]);
+        contourFinder.findContours(grayImage, minArea, maxArea, maxBlobs, false);
+    }
+    times.contourMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        single.label(masks[i % masks.size()].getData(), width, minArea, maxArea, maxBlobs, blobs);
+    }
+    times.singleMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        parallel.label(masks[i % masks.size()].getData(), width, minArea, maxArea, maxBlobs, blobs);
+    }
+    times.parallelMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+
+    // contour areas are a little smaller than pixel counts, so blobs near the
+    // size limits may differ, counts of well separated people should match
+    for (const ofPixels& mask : masks)
+    {
+        grayImage.setFromPixels(mask);
+        contourFinder.findContours(grayImage, minArea, maxArea, maxBlobs, false);
+        parallel.label(mask.getData(), width, minArea, maxArea, maxBlobs, blobs);
+        if (contourFinder.nBlobs != (int)blobs.size())
+        {
+            times.mismatches++;
+        }
+    }
+    return times;
+}
+
+void logLabelerTimes(const std::string& name, const LabelerTimes& times)
+{
+    ofLogNotice("Benchmark") << "labeler " << name << ": contour finder " << times.contourMicros << " us"
+        << ", labeler " << times.singleMicros << " us (" << times.contourMicros / std::max(times.singleMicros, 0.001) << "x)"
+        << ", " << times.stripes << " stripes " << times.parallelMicros << " us (" << times.contourMicros / std::max(times.parallelMicros, 0.001) << "x)"
+        << ", blob count differs in " << times.mismatches << " frames";
+}
+
+// timestamped inputs of a scripted session, fed to a GameSimulation as its clock passes them
+struct SimulationScript {
+    struct People {
+        double time;
+        TrackedPointBuffer points;
+    };
+    struct Click {
+        double time;
+        float x;
+        float y;
+    };
+    struct Event {
+        double time;
+        GameEvent event;
+    };
+
+    std::vector<People> people;
+    std::vector<Click> clicks;
+    std::vector<Event> events;
+};
+
+struct SimulationRun {
+    std::vector<GameOutput> outputs;
+    std::vector<uint64_t> checkpointTicks;
+    std::vector<GameSnapshot> checkpoints; // every 1/checkpointRate seconds
+    GameSnapshot final;
+};
+
+const int simulationFrameRate = 60; // of the scripted players
+const int checkpointRate = 6;       // both 30 and 144 fps have a frame every 1/6 s
+
+int indexOfBubble(const BubbleStore& bubbles, int expectedAmount)
+{
+    for (int i = 0; i < bubbles.size(); i++)
+    {
+        if (bubbles.getExpectedAmount(i) == expectedAmount)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Players react to what they see at 60 fps: three pick their count and start,
+// find their bubbles a little later every round but miss the third, read the
+// score and play again, then two start a second game that is skipped to the
+// end. Everything they do is written down with its time.
+SimulationScript recordSimulationScript(const GameSettings& settings, double seconds)
+{
+    SimulationScript script;
+    GameSimulation simulation;
+    simulation.setup(settings, 0);
+
+    int games = 0;
+    bool skipped = false;
+    gameStateEnum lastState = mainMenu;
+    int lastRound = 0;
+    double stateSince = 0;
+    TrackedPointBuffer points;
+    for (int frame = 1; frame <= seconds * simulationFrameRate; frame++)
+    {
+        double time = (double)frame / simulationFrameRate;
+        gameStateEnum state = simulation.getState();
+        int round = simulation.getRound();
+        if (state != lastState || round != lastRound)
+        {
+            lastState = state;
+            lastRound = round;
+            stateSince = time;
+        }
+        double waited = time - stateSince;
+
+        const BubbleStore& bubbles = simulation.getBubbles();
+        auto click = [&](int button) {
+            script.clicks.push_back({ time, bubbles.getX(button), bubbles.getY(button) });
+            simulation.pushClick(time, bubbles.getX(button), bubbles.getY(button));
+        };
+        points.clear();
+        if (state == mainMenu && waited > 0.5)
+        {
+            int players = games == 0 ? 3 : 2;
+            int button = indexOfBubble(bubbles, simulation.getAmountOfPlayers() != players ? players : -2);
+            if (button >= 0)
+            {
+                click(button);
+            }
+        }
+        else if (state == gameLoop && round != 3 && waited > 0.4 * round)
+        {
+            for (int i = 0; i < bubbles.size(); i++)
+            {
+                for (int p = 0; p < bubbles.getExpectedAmount(i); p++)
+                {
+                    points.push(bubbles.getX(i) + p * 10, bubbles.getY(i), 1000, points.size() + 1);
+                }
+            }
+        }
+        else if (state == endScreen && games == 1 && waited > 1)
+        {
+            click(indexOfBubble(bubbles, -3));
+        }
+        if (state == gameLoop && games == 1 && round == 2 && !skipped)
+        {
+            script.events.push_back({ time + 0.5, GameEvent::skipToEnd });
+            simulation.pushEvent(time + 0.5, GameEvent::skipToEnd);
+            skipped = true;
+        }
+        script.people.push_back({ time, points });
+        simulation.pushPeople(time, points.getSpan());
+
+        simulation.advance(time);
+        for (GameOutput output : simulation.getOutputs())
+        {
+            if (output == GameOutput::gameEnded)
+            {
+                games++;
+            }
+        }
+        simulation.clearOutputs();
+    }
+    return script;
+}
+
+// plays the script back calling advance() frameRate times per second
+SimulationRun replaySimulationScript(const SimulationScript& script, const GameSettings& settings, double seconds, int frameRate)
+{
+    SimulationRun run;
+    GameSimulation simulation;
+    simulation.setup(settings, 0);
+    size_t nextPeople = 0;
+    size_t nextClick = 0;
+    size_t nextEvent = 0;
+    for (int frame = 1; frame <= seconds * frameRate; frame++)
+    {
+        double time = (double)frame / frameRate;
+        for (; nextPeople < script.people.size() && script.people[nextPeople].time <= time; nextPeople++)
+        {
+            simulation.pushPeople(script.people[nextPeople].time, script.people[nextPeople].points.getSpan());
+        }
+        for (; nextClick < script.clicks.size() && script.clicks[nextClick].time <= time; nextClick++)
+        {
+            const SimulationScript::Click& click = script.clicks[nextClick];
+            simulation.pushClick(click.time, click.x, click.y);
+        }
+        for (; nextEvent < script.events.size() && script.events[nextEvent].time <= time; nextEvent++)
+        {
+            simulation.pushEvent(script.events[nextEvent].time, script.events[nextEvent].event);
+        }
+
+        simulation.advance(time);
+        run.outputs.insert(run.outputs.end(), simulation.getOutputs().begin(), simulation.getOutputs().end());
+        simulation.clearOutputs();
+        if (frame % (frameRate / checkpointRate) == 0)
+        {
+            run.checkpointTicks.push_back(simulation.getTick());
+            run.checkpoints.emplace_back();
+            simulation.getSnapshot(run.checkpoints.back());
+        }
+    }
+    simulation.getSnapshot(run.final);
+    return run;
+}
+
+bool sameSnapshot(const GameSnapshot& a, const GameSnapshot& b)
+{
+    if (a.state != b.state || a.score != b.score || a.round != b.round || a.roundAmount != b.roundAmount || a.amountOfPlayers != b.amountOfPlayers
+        || a.remainingSeconds != b.remainingSeconds || a.lastRoundWon != b.lastRoundWon || a.layout != b.layout || a.bubbles.size() != b.bubbles.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.bubbles.size(); i++)
+    {
+        if (a.bubbles.getX(i) != b.bubbles.getX(i) || a.bubbles.getY(i) != b.bubbles.getY(i) || a.bubbles.getRadius(i) != b.bubbles.getRadius(i)
+            || a.bubbles.getExpectedAmount(i) != b.bubbles.getExpectedAmount(i) || a.bubbles.getCurrentAmount(i) != b.bubbles.getCurrentAmount(i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void runThresholdBenchmark()
+{
+    benchmarkThresholdAt(640, 480);
+    benchmarkThresholdAt(512, 424);
+}
+
+void runPlacementBenchmark()
+{
+    const int trials = 2000;
+    BubblePlacer placer;
+    placer.setup(BubblePlacer::Settings(), 1);
+    std::vector<PlacedBubble> bubbles;
+
+    for (int players = 1; players <= 8; players++)
+    {
+        int results[3] = { 0, 0, 0 };
+        double totalMicros = 0;
+        double worstMicros = 0;
+        for (int trial = 0; trial < trials; trial++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            BubblePlacer::Result result = placer.place(players, 1920, 1080, bubbles);
+            double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            totalMicros += micros;
+            worstMicros = std::max(worstMicros, micros);
+            results[result]++;
+        }
+        ofLogNotice("Benchmark") << "placement " << players << " players: mean " << totalMicros / trials << " us"
+            << ", worst " << worstMicros << " us"
+            << ", placed " << results[BubblePlacer::placed]
+            << ", shrunk " << results[BubblePlacer::placedShrunk]
+            << ", fallback " << results[BubblePlacer::fallbackLayout];
+    }
+}
+
+void runPipelineBenchmark(const std::string& recording, const VisionSettings& settings, const std::string& jsonPath)
+{
+    enum Stage
+    {
+        depthStage,
+        visionStage,
+        detectionStage,
+        trackerStage,
+        simulationStage,
+        endToEndStage
+    };
+
+    // frames come from the recording, or from people walking circles on a synthetic floor
+    const bool synthetic = recording == "" || recording == "synthetic";
+    const int syntheticFrames = 900;
+    DepthReplay replay;
+    ofPixels syntheticDepth;
+    int width = 640;
+    int height = 480;
+    int frameCount = syntheticFrames;
+    VisionSettings visionSettings = settings;
+    if (synthetic)
+    {
+        fillSyntheticDepth(syntheticDepth, width, height, 0);
+        // the synthetic people stand at 180, the floor is below 110
+        visionSettings.nearThreshold = 255;
+        visionSettings.farThreshold = 150;
+    }
+    else
+    {
+        if (!replay.open(recording))
+        {
+            return;
+        }
+        width = replay.getWidth();
+        height = replay.getHeight();
+        frameCount = replay.getNumFrames();
+    }
+
+    VisionWorker vision;
+    vision.setup(width, height, VisionWorker::synchronous);
+    PersonTracker tracker;
+    tracker.setup(TrackerSettings());
+    PipelineStats stats;
+    stats.setup({ "depth", "vision", "detections", "tracker", "simulation", "endToEnd" }, frameCount);
+
+    // start a game right away so rounds are played with the people in the frames
+    GameSimulation simulation;
+    GameSettings gameSettings;
+    double startTime = 0;
+    if (!synthetic && replay.readFrame(0))
+    {
+        startTime = replay.getFrameTimestampMicros() / 1000000.0;
+    }
+    simulation.setup(gameSettings, startTime);
+    simulation.pushEvent(startTime, GameEvent::start);
+
+    ofPixels depth;
+    depth.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    TrackedPointBuffer detections;
+    TrackedPointBuffer people;
+    double time = startTime;
+    auto elapsedMicros = [](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<double, std::micro>(to - from).count();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        uint64_t allocationsBefore = getAllocationCount();
+        auto t0 = std::chrono::steady_clock::now();
+        const ofPixels* pixels = &depth;
+        if (synthetic)
+        {
+            moveSyntheticPeople(syntheticDepth, depth, frame);
+            time = startTime + frame / 30.0;
+        }
+        else
+        {
+            if (!replay.readFrame(frame))
+            {
+                break;
+            }
+            pixels = &replay.getDepthPixels();
+            time = replay.getFrameTimestampMicros() / 1000000.0;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        vision.pushDepthFrame(*pixels, visionSettings, (uint64_t)(time * 1000000.0));
+        vision.updateSnapshot();
+        auto t2 = std::chrono::steady_clock::now();
+
+        // sensor to floor without the calibration sliders
+        const VisionSnapshot& snapshot = vision.getSnapshot();
+        detections.clear();
+        for (int i = 0; i < (int)snapshot.blobs.size(); i++)
+        {
+            const VisionBlob& blob = snapshot.blobs[i];
+            detections.push(blob.centroid.x * gameSettings.width / width, blob.centroid.y * gameSettings.height / height, blob.area, i + 1);
+        }
+        auto t3 = std::chrono::steady_clock::now();
+
+        tracker.update(detections.getSpan(), time);
+        people.clear();
+        tracker.predict(time, people);
+        auto t4 = std::chrono::steady_clock::now();
+
+        simulation.pushPeople(time, people.getSpan());
+        simulation.advance(time);
+        simulation.clearOutputs();
+        auto t5 = std::chrono::steady_clock::now();
+
+        stats.addSample(depthStage, elapsedMicros(t0, t1));
+        stats.addSample(visionStage, elapsedMicros(t1, t2));
+        stats.addSample(detectionStage, elapsedMicros(t2, t3));
+        stats.addSample(trackerStage, elapsedMicros(t3, t4));
+        stats.addSample(simulationStage, elapsedMicros(t4, t5));
+        stats.addSample(endToEndStage, elapsedMicros(t0, t5));
+        stats.endFrame(getAllocationCount() - allocationsBefore);
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double recordedSeconds = time - startTime;
+
+    std::string name = synthetic ? "synthetic" : recording;
+    ofLogNotice("Benchmark") << "pipeline " << name << ": " << stats.getNumFrames() << " frames, " << recordedSeconds << " s of depth in "
+        << wallSeconds << " s (" << recordedSeconds / std::max(wallSeconds, 0.000001) << "x real time)";
+    stats.log("pipeline");
+
+    if (jsonPath != "")
+    {
+        ofJson json = stats.toJson();
+        json["benchmark"] = "pipeline";
+        json["source"] = name;
+        json["width"] = width;
+        json["height"] = height;
+        json["depthSeconds"] = recordedSeconds;
+        json["wallSeconds"] = wallSeconds;
+        json["instructionSet"] = DepthThreshold::getInstructionSet();
+        if (ofSavePrettyJson(jsonPath, json))
+        {
+            ofLogNotice("Benchmark") << "pipeline report written to " << jsonPath;
+        }
+    }
+}
+
+void runSensorScalingBenchmark(int maxSensors)
+{
+    const int width = 640;
+    const int height = 480;
+    const double secondsPerStep = 3;
+
+    ofPixels floor;
+    fillSyntheticDepth(floor, width, height, 0);
+    ofPixels depth;
+    depth.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    VisionSettings settings;
+    settings.nearThreshold = 255;
+    settings.farThreshold = 150;
+
+    ofLogNotice("Benchmark") << "sensor scaling, " << std::thread::hardware_concurrency() << " hardware threads";
+    double singleSensorRate = 0;
+    for (int numSensors = 1; numSensors <= maxSensors; numSensors++)
+    {
+        std::vector<std::unique_ptr<VisionWorker>> workers;
+        int labelStripes = std::max((int)std::thread::hardware_concurrency() / numSensors, 1);
+        for (int i = 0; i < numSensors; i++)
+        {
+            workers.emplace_back(new VisionWorker());
+            workers.back()->setup(width, height, VisionWorker::threaded, "vision " + ofToString(i), labelStripes);
+        }
+
+        // every round hands each sensor a frame and waits for all of them,
+        // like the app does when all kinects deliver at the same time
+        int rounds = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < secondsPerStep)
+        {
+            moveSyntheticPeople(floor, depth, rounds);
+            for (auto& worker : workers)
+            {
+                worker->pushDepthFrame(depth, settings);
+            }
+            for (auto& worker : workers)
+            {
+                while (!worker->updateSnapshot())
+                {
+                    std::this_thread::yield();
+                }
+            }
+            rounds++;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        for (auto& worker : workers)
+        {
+            worker->stop();
+        }
+
+        double rate = rounds * numSensors / elapsed;
+        if (numSensors == 1)
+        {
+            singleSensorRate = rate;
+        }
+        ofLogNotice("Benchmark") << numSensors << " sensors: " << rate << " frames/s, " << rate / numSensors << " per sensor, "
+            << rate / std::max(singleSensorRate, 0.000001) << "x one sensor";
+    }
+}
+
+void runLabelerBenchmark(const std::string& recording, const VisionSettings& settings)
+{
+    const int width = 640;
+    const int height = 480;
+    const int maxBlobs = 32; // room for everyone, the app keeps VisionSettings::maxBlobs
+    const int framesPerCount = 16;
+    ofLogNotice("Benchmark") << "labeler, " << std::thread::hardware_concurrency() << " hardware threads";
+
+    // synthetic floors, the people stand at 180 and the floor is below 110
+    DepthThreshold depthThreshold;
+    depthThreshold.setup(width, height);
+    const int peopleCounts[] = { 1, 5, 10, 20, 30 };
+    for (int people : peopleCounts)
+    {
+        std::vector<ofPixels> masks(framesPerCount);
+        ofPixels depth;
+        for (ofPixels& mask : masks)
+        {
+            fillSyntheticDepth(depth, width, height, people);
+            mask.allocate(width, height, OF_IMAGE_GRAYSCALE);
+            depthThreshold.apply(depth.getData(), width, mask.getData(), width, 255, 150);
+        }
+        logLabelerTimes(ofToString(people) + " people", benchmarkLabelerOn(masks, settings.minBlobSize, settings.maxBlobSize, maxBlobs));
+    }
+
+    if (recording == "" || recording == "synthetic")
+    {
+        return;
+    }
+    DepthReplay replay;
+    if (!replay.open(recording))
+    {
+        return;
+    }
+    std::vector<ofPixels> masks;
+    depthThreshold.setup(replay.getWidth(), replay.getHeight());
+    for (int frame = 0; frame < replay.getNumFrames() && replay.readFrame(frame); frame++)
+    {
+        masks.emplace_back();
+        masks.back().allocate(replay.getWidth(), replay.getHeight(), OF_IMAGE_GRAYSCALE);
+        depthThreshold.apply(replay.getDepthPixels().getData(), replay.getWidth(), masks.back().getData(), replay.getWidth(),
+            settings.nearThreshold, settings.farThreshold, settings.morphology);
+    }
+    if (masks.empty())
+    {
+        return;
+    }
+    logLabelerTimes(recording, benchmarkLabelerOn(masks, settings.minBlobSize, settings.maxBlobSize, maxBlobs));
+}
+
+void runNetworkBenchmark(int port)
+{
+    const int framesPerCount = 600;
+    NetworkPublisher publisher;
+    NetworkReceiver receiver;
+    if (!receiver.setup(port) || !publisher.setup("127.0.0.1", port))
+    {
+        return;
+    }
+
+    NetworkFrame frame;
+    frame.game.state = gameLoop;
+    for (int i = 0; i < 8; i++)
+    {
+        frame.game.bubbles.add(ofRandom(200, 1720), ofRandom(200, 880), 150, i % 4 + 1);
+        frame.bubbleColors[i] = ofColor::fromHsb(ofRandom(255), 200, 230);
+    }
+
+    const int peopleCounts[] = { 1, 10, 30 };
+    for (int people : peopleCounts)
+    {
+        uint64_t lostBefore = receiver.getLostFrames();
+        uint64_t staleBefore = receiver.getStaleFrames();
+        uint64_t sendMicros = 0;
+        uint64_t allocations = 0;
+        int receivedFrames = 0;
+        for (int n = 0; n < framesPerCount; n++)
+        {
+            frame.people.clear();
+            for (int i = 0; i < people; i++)
+            {
+                frame.people.push(ofRandom(1920), ofRandom(1080), ofRandom(500, 3000), i);
+            }
+            frame.timestampMicros = ofGetElapsedTimeMicros();
+
+            uint64_t allocationsBefore = getAllocationCount();
+            uint64_t start = ofGetElapsedTimeMicros();
+            publisher.publish(frame);
+            sendMicros += ofGetElapsedTimeMicros() - start;
+            allocations += getAllocationCount() - allocationsBefore;
+
+            // about the vision rate, so the receive thread keeps up like it would on the network
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            if (receiver.update())
+            {
+                receivedFrames++;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (receiver.update())
+        {
+            receivedFrames++;
+        }
+
+        bool matches = receiver.hasFrame() && receiver.getFrame().sequence == publisher.getSequence()
+            && receiver.getFrame().people.size() == people && receiver.getFrame().game.bubbles.size() == frame.game.bubbles.size();
+        ofLogNotice("Benchmark") << "network, " << people << " people: " << publisher.getLastPacketSize() << " bytes, "
+            << (double)sendMicros / framesPerCount << " us to send, " << (double)allocations / framesPerCount << " allocations per send, "
+            << receivedFrames << " of " << framesPerCount << " frames received, " << receiver.getLostFrames() - lostBefore << " lost, "
+            << receiver.getStaleFrames() - staleBefore << " stale, last frame " << (matches ? "matches" : "DIFFERS");
+    }
+    publisher.close();
+    receiver.close();
+}
+
+void runSoakTest(int games, int people, bool depth, const std::string& jsonPath, int reportEvery)
+{
+    enum Stage
+    {
+        inputStage,
+        visionStage,
+        trackerStage,
+        simulationStage,
+        frameStage
+    };
+
+    const int width = 640;
+    const int height = 480;
+    const double frameTime = 1.0 / 30;
+    const double operatorDelay = 1;          // seconds the operator waits in the menu and on the end screen
+    const double stuckSeconds = 600;         // no game ended for this long, give up
+    const double placementStallMicros = 2000;
+    reportEvery = std::max(reportEvery, 1);
+
+    GameSettings gameSettings;
+    GameSimulation simulation;
+    simulation.setup(gameSettings, 0);
+
+    CrowdSettings crowdSettings;
+    crowdSettings.width = gameSettings.width;
+    crowdSettings.height = gameSettings.height;
+    SyntheticCrowd crowd;
+    crowd.setup(crowdSettings);
+    crowd.setPeople(people);
+
+    VisionWorker vision;
+    VisionSettings visionSettings;
+    visionSettings.nearThreshold = 255;
+    visionSettings.farThreshold = 150;
+    visionSettings.maxBlobs = TrackedPointBuffer::capacity;
+    ofPixels depthFrame;
+    if (depth)
+    {
+        vision.setup(width, height, VisionWorker::synchronous);
+        depthFrame.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    }
+    PersonTracker tracker;
+    tracker.setup(TrackerSettings());
+    TrackedPointBuffer detections;
+    TrackedPointBuffer tracked;
+
+    // a block is reportEvery games, a game is about 25 s at 30 fps
+    PipelineStats stats;
+    stats.setup({ "input", "vision", "tracker", "simulation", "frame" }, reportEvery * 1500);
+    ofJson blocks = ofJson::array();
+
+    std::string mode = depth ? "depth" : "points";
+    ofLogNotice("Benchmark") << "soak: " << games << " games, " << people << " people, " << mode
+                             << ", at most " << visionSettings.maxBlobs << " blobs per sensor frame";
+
+    int played = 0;
+    int roundsWon = 0;
+    int roundsLost = 0;
+    long long totalScore = 0;
+    uint64_t placements = simulation.getPlacementCount();
+    int placementStalls = 0;
+    int placementResults[3] = { 0, 0, 0 };
+    double worstPlacementMicros = 0;
+    double lastGameEnd = 0;
+    bool stuck = false;
+
+    gameStateEnum lastState = simulation.getState();
+    double stateEntered = 0;
+    bool operatorDone = false;
+    double time = 0;
+    auto elapsedMicros = [](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<double, std::micro>(to - from).count();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    while (played < games)
+    {
+        time += frameTime;
+        uint64_t allocationsBefore = getAllocationCount();
+        auto t0 = std::chrono::steady_clock::now();
+        crowd.update(frameTime);
+        if (depth)
+        {
+            crowd.renderDepth(depthFrame.getData(), width, height, width);
+        }
+        else
+        {
+            crowd.getDetections(detections);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        if (depth)
+        {
+            vision.pushDepthFrame(depthFrame, visionSettings, (uint64_t)(time * 1000000.0));
+            vision.updateSnapshot();
+            const VisionSnapshot& snapshot = vision.getSnapshot();
+            detections.clear();
+            for (int i = 0; i < (int)snapshot.blobs.size(); i++)
+            {
+                const VisionBlob& blob = snapshot.blobs[i];
+                detections.push(blob.centroid.x * gameSettings.width / width, blob.centroid.y * gameSettings.height / height, blob.area, i + 1);
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        tracker.update(detections.getSpan(), time);
+        tracked.clear();
+        tracker.predict(time, tracked);
+        auto t3 = std::chrono::steady_clock::now();
+
+        // the operator picks a player count and holds start, or play again on the end screen
+        gameStateEnum state = simulation.getState();
+        if (state != lastState)
+        {
+            lastState = state;
+            stateEntered = time;
+            operatorDone = false;
+        }
+        if (!operatorDone && (state == mainMenu || state == endScreen) && time - stateEntered >= operatorDelay)
+        {
+            const BubbleStore& bubbles = simulation.getBubbles();
+            if (state == mainMenu)
+            {
+                int players = (int)ofRandom(1, std::min(std::max(people, 1), 8) + 1);
+                for (int i = 1; i < bubbles.size(); i++)
+                {
+                    if (bubbles.getExpectedAmount(i) == players)
+                    {
+                        simulation.pushClick(time, bubbles.getX(i), bubbles.getY(i));
+                    }
+                }
+            }
+            for (int click = 1; click <= gameSettings.waitTime; click++)
+            {
+                simulation.pushClick(time + click * 0.05, bubbles.getX(0), bubbles.getY(0));
+            }
+            operatorDone = true;
+        }
+
+        simulation.pushPeople(time, tracked.getSpan());
+        simulation.advance(time);
+        bool gameEnded = false;
+        for (GameOutput output : simulation.getOutputs())
+        {
+            switch (output)
+            {
+            case GameOutput::layoutChanged:
+                if (simulation.getState() == gameLoop || simulation.getState() == cooldown)
+                {
+                    crowd.setTargets(simulation.getBubbles());
+                }
+                else
+                {
+                    crowd.clearTargets();
+                }
+                break;
+            case GameOutput::roundWon:
+                roundsWon++;
+                break;
+            case GameOutput::roundLost:
+                roundsLost++;
+                break;
+            case GameOutput::gameEnded:
+                played++;
+                totalScore += simulation.getScore();
+                lastGameEnd = time;
+                gameEnded = true;
+                // people come and go between games
+                crowd.setPeople((int)ofRandom(people * 0.75f, people + 1));
+                break;
+            default:
+                break;
+            }
+        }
+        simulation.clearOutputs();
+        auto t4 = std::chrono::steady_clock::now();
+
+        // placement runs inside the simulation, its frame bounds how long it took
+        double simulationMicros = elapsedMicros(t3, t4);
+        if (simulation.getPlacementCount() != placements)
+        {
+            placements = simulation.getPlacementCount();
+            placementResults[simulation.getLastPlacementResult()]++;
+            worstPlacementMicros = std::max(worstPlacementMicros, simulationMicros);
+            if (simulationMicros > placementStallMicros)
+            {
+                placementStalls++;
+            }
+        }
+
+        stats.addSample(inputStage, elapsedMicros(t0, t1));
+        stats.addSample(visionStage, elapsedMicros(t1, t2));
+        stats.addSample(trackerStage, elapsedMicros(t2, t3));
+        stats.addSample(simulationStage, simulationMicros);
+        stats.addSample(frameStage, elapsedMicros(t0, t4));
+        stats.endFrame(getAllocationCount() - allocationsBefore);
+
+        bool blockDone = gameEnded && played % reportEvery == 0;
+        if (time - lastGameEnd > stuckSeconds)
+        {
+            ofLogError("Benchmark") << "soak: no game ended for " << stuckSeconds << " s, stuck in state " << simulation.getState();
+            stuck = true;
+        }
+        if (blockDone || stuck || played == games)
+        {
+            PipelineStats::Summary frame = stats.getSummary(frameStage);
+            PipelineStats::Summary allocations = stats.getAllocationSummary();
+            int64_t liveAllocations = getLiveAllocationCount();
+            uint64_t residentBytes = getResidentBytes();
+            ofLogNotice("Benchmark") << "soak: " << played << " games, frame p50 " << frame.p50 << " us, p99 " << frame.p99
+                << " us, max " << frame.max << " us, " << allocations.mean << " allocations/frame, " << liveAllocations
+                << " live allocations, " << residentBytes / (1024.0 * 1024.0) << " MB resident";
+            ofJson block = stats.toJson();
+            block["games"] = played;
+            block["liveAllocations"] = liveAllocations;
+            block["residentBytes"] = residentBytes;
+            blocks.push_back(block);
+            stats.clear();
+        }
+        if (stuck)
+        {
+            break;
+        }
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ofLogNotice("Benchmark") << "soak: " << played << " games in " << wallSeconds << " s (" << time / std::max(wallSeconds, 0.000001)
+        << "x real time), " << roundsWon << " rounds won, " << roundsLost << " lost, mean score " << (played > 0 ? (double)totalScore / played : 0);
+    ofLogNotice("Benchmark") << "soak: " << placements << " layouts, placed " << placementResults[BubblePlacer::placed]
+        << ", shrunk " << placementResults[BubblePlacer::placedShrunk] << ", fallback " << placementResults[BubblePlacer::fallbackLayout]
+        << ", worst " << worstPlacementMicros << " us, " << placementStalls << " over " << placementStallMicros << " us";
+
+    if (jsonPath != "")
+    {
+        ofJson json;
+        json["benchmark"] = "soak";
+        json["mode"] = mode;
+        json["people"] = people;
+        json["games"] = played;
+        json["stuck"] = stuck;
+        json["gameSeconds"] = time;
+        json["wallSeconds"] = wallSeconds;
+        json["roundsWon"] = roundsWon;
+        json["roundsLost"] = roundsLost;
+        json["placements"] = placements;
+        json["placementsShrunk"] = placementResults[BubblePlacer::placedShrunk];
+        json["placementFallbacks"] = placementResults[BubblePlacer::fallbackLayout];
+        json["placementStalls"] = placementStalls;
+        json["worstPlacementMicros"] = worstPlacementMicros;
+        json["blocks"] = blocks;
+        if (ofSavePrettyJson(jsonPath, json))
+        {
+            ofLogNotice("Benchmark") << "soak report written to " << jsonPath;
+        }
+    }
+    if (depth)
+    {
+        vision.stop();
+    }
+}
+
+void runAudioBenchmark()
+{
+    const int sampleRate = 44100;
+    const int bufferFrames = 256;
+
+    // a short beep and a looping hum stand in for the cues
+    auto makeCue = [&](float seconds, float frequency, bool loop) {
+        AudioCue cue;
+        cue.frames = (int)(seconds * sampleRate);
+        cue.samples.resize(cue.frames * AudioMixer::channels);
+        for (int i = 0; i < cue.frames; i++)
+        {
+            int16_t value = (int16_t)(std::sin(TWO_PI * frequency * i / sampleRate) * 8000);
+            cue.samples[i * 2] = value;
+            cue.samples[i * 2 + 1] = value;
+        }
+        cue.loop = loop;
+        cue.music = loop;
+        return cue;
+    };
+
+    std::vector<float> output(bufferFrames * AudioMixer::channels);
+    const int voiceCounts[] = { 1, 4, 16 };
+    for (int voices : voiceCounts)
+    {
+        AudioMixer mixer;
+        mixer.setup(sampleRate);
+        mixer.addCue(makeCue(60, 440, false));
+        for (int i = 0; i < voices; i++)
+        {
+            AudioCommand command;
+            command.cue = 0;
+            mixer.push(command);
+        }
+        AudioCommand duck;
+        duck.type = AudioCommandType::duck;
+        duck.value = 0.2f;
+        duck.seconds = 1;
+        mixer.push(duck);
+
+        uint64_t allocationsBefore = getAllocationCount();
+        double worstMicros = 0;
+        double micros = timePerIteration([&]() {
+            auto start = std::chrono::steady_clock::now();
+            mixer.mix(output.data(), bufferFrames, 0);
+            worstMicros = std::max(worstMicros, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        });
+        ofLogNotice("Benchmark") << "audio mix " << voices << " voices: " << micros << " us per " << bufferFrames << " frames, worst "
+            << worstMicros << " us, " << getAllocationCount() - allocationsBefore << " allocations";
+    }
+
+    AudioEngine engine;
+    engine.setup(sampleRate, bufferFrames);
+    engine.addCue(makeCue(0.3f, 880, false));
+    engine.addCue(makeCue(2, 110, true));
+    engine.start(AudioEngine::nullOutput);
+    engine.play(1);
+    int triggers = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        engine.play(0);
+        engine.duck(triggers % 2 == 0 ? 0.2f : 1.0f);
+        triggers++;
+        std::this_thread::sleep_for(std::chrono::microseconds((int)ofRandom(1000, 20000)));
+    }
+    const AudioMixer& mixer = engine.getMixer();
+    ofLogNotice("Benchmark") << "audio null output: " << triggers << " sounds, latest " << mixer.getMaxLatencyMicros() / 1000.0
+        << " ms late (one buffer is " << bufferFrames * 1000.0 / sampleRate << " ms), " << mixer.getDroppedCommands() << " commands dropped";
+    engine.close();
+}
+
+bool runSimulationCheck()
+{
+    const double seconds = 60;
+    GameSettings settings;
+    settings.seed = 7;
+    SimulationScript script = recordSimulationScript(settings, seconds);
+    SimulationRun slow = replaySimulationScript(script, settings, seconds, 30);
+    SimulationRun fast = replaySimulationScript(script, settings, seconds, 144);
+
+    // a script that never won, lost or finished a game would prove nothing
+    auto count = [&](GameOutput output) {
+        return std::count(slow.outputs.begin(), slow.outputs.end(), output);
+    };
+    ofLogNotice("Check") << "simulation script: " << script.people.size() << " people frames, " << script.clicks.size() << " clicks, "
+        << script.events.size() << " events, " << count(GameOutput::roundWon) << " rounds won, " << count(GameOutput::roundLost)
+        << " lost, " << count(GameOutput::gameEnded) << " games ended, final score " << slow.final.score;
+    if (count(GameOutput::roundWon) == 0 || count(GameOutput::roundLost) == 0 || count(GameOutput::gameEnded) < 2 || count(GameOutput::menuEntered) == 0)
+    {
+        ofLogError("Check") << "simulation script did not play out as intended";
+        return false;
+    }
+
+    bool same = true;
+    if (slow.outputs != fast.outputs)
+    {
+        ofLogError("Check") << "simulation outputs differ: " << slow.outputs.size() << " at 30 fps, " << fast.outputs.size() << " at 144 fps";
+        same = false;
+    }
+    for (size_t i = 0; i < std::min(slow.checkpoints.size(), fast.checkpoints.size()); i++)
+    {
+        if (slow.checkpointTicks[i] != fast.checkpointTicks[i] || !sameSnapshot(slow.checkpoints[i], fast.checkpoints[i]))
+        {
+            ofLogError("Check") << "simulation differs at " << (i + 1.0) / checkpointRate << " s: tick " << slow.checkpointTicks[i] << " / "
+                << fast.checkpointTicks[i] << ", state " << slow.checkpoints[i].state << " / " << fast.checkpoints[i].state << ", score "
+                << slow.checkpoints[i].score << " / " << fast.checkpoints[i].score;
+            same = false;
+            break;
+        }
+    }
+    if (slow.checkpoints.size() != fast.checkpoints.size() || !sameSnapshot(slow.final, fast.final))
+    {
+        ofLogError("Check") << "simulation ends differently: score " << slow.final.score << " / " << fast.final.score;
+        same = false;
+    }
+    ofLogNotice("Check") << "simulation at 30 and 144 fps: " << (same ? "same" : "DIFFERENT");
+    return same;
+}
+
+bool runVisionCheck(const std::string& recording, const VisionSettings& settings)
+{
+    const bool synthetic = recording == "" || recording == "synthetic";
+    const int syntheticFrames = 300;
+    DepthReplay replay;
+    ofPixels syntheticDepth;
+    ofPixels depth;
+    int width = 640;
+    int height = 480;
+    int frameCount = syntheticFrames;
+    VisionSettings visionSettings = settings;
+    if (synthetic)
+    {
+        fillSyntheticDepth(syntheticDepth, width, height, 0);
+        depth.allocate(width, height, OF_IMAGE_GRAYSCALE);
+        visionSettings.nearThreshold = 255;
+        visionSettings.farThreshold = 150;
+    }
+    else
+    {
+        if (!replay.open(recording))
+        {
+            return false;
+        }
+        width = replay.getWidth();
+        height = replay.getHeight();
+        frameCount = replay.getNumFrames();
+    }
+
+    VisionWorker threaded;
+    threaded.setup(width, height, VisionWorker::threaded, "vision check");
+    VisionWorker synchronous;
+    synchronous.setup(width, height, VisionWorker::synchronous);
+
+    // the first third whole frames, then regions of interest as during a round
+    // (stateful, the blobs of one frame decide what the next one processes),
+    // the last third whole frames again with the morphology on
+    int differences = 0;
+    int compared = 0;
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        const ofPixels* pixels = &depth;
+        if (synthetic)
+        {
+            moveSyntheticPeople(syntheticDepth, depth, frame);
+        }
+        else
+        {
+            if (!replay.readFrame(frame))
+            {
+                break;
+            }
+            pixels = &replay.getDepthPixels();
+        }
+        VisionSettings frameSettings = visionSettings;
+        if (frame >= frameCount / 3 && frame < frameCount * 2 / 3)
+        {
+            frameSettings.useRegions = true;
+            frameSettings.numRegions = 2;
+            frameSettings.regions[0] = { width / 8, height / 8, width / 4, height / 4 };
+            frameSettings.regions[1] = { width / 2, height / 2, width / 3, height / 3 };
+        }
+        else if (frame >= frameCount * 2 / 3)
+        {
+            frameSettings.morphology = DepthThreshold::open;
+        }
+
+        // the threaded worker skips frames that arrive while it is busy, wait
+        // for each one so both see the same sequence
+        uint64_t timestampMicros = (uint64_t)frame * 33333;
+        threaded.pushDepthFrame(*pixels, frameSettings, timestampMicros);
+        synchronous.pushDepthFrame(*pixels, frameSettings, timestampMicros);
+        synchronous.updateSnapshot();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (threaded.getSnapshot().sequence != synchronous.getSnapshot().sequence && std::chrono::steady_clock::now() < deadline)
+        {
+            if (!threaded.updateSnapshot())
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        const VisionSnapshot& a = threaded.getSnapshot();
+        const VisionSnapshot& b = synchronous.getSnapshot();
+        bool same = a.sequence == b.sequence && a.timestampMicros == b.timestampMicros && a.coverage == b.coverage
+            && a.blobs.size() == b.blobs.size() && std::memcmp(a.mask.getData(), b.mask.getData(), a.mask.getTotalBytes()) == 0;
+        for (size_t i = 0; same && i < a.blobs.size(); i++)
+        {
+            same = a.blobs[i].centroid == b.blobs[i].centroid && a.blobs[i].area == b.blobs[i].area
+                && a.blobs[i].boundingRect == b.blobs[i].boundingRect && a.blobs[i].seed == b.blobs[i].seed;
+        }
+        if (!same)
+        {
+            if (differences == 0)
+            {
+                ofLogError("Check") << "vision differs at frame " << frame << ": sequence " << a.sequence << " / " << b.sequence
+                    << ", " << a.blobs.size() << " / " << b.blobs.size() << " blobs, coverage " << a.coverage << " / " << b.coverage;
+            }
+            differences++;
+        }
+        compared++;
+    }
+    threaded.stop();
+
+    ofLogNotice("Check") << "vision threaded and synchronous on " << (synthetic ? "synthetic" : recording) << ": " << compared
+        << " frames, " << differences << " differ";
+    return compared > 0 && differences == 0;
+}
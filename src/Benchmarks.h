@@ -0,0 +1,72 @@
+#pragma once
+
+#include "VisionWorker.h"
+
+#include <string>
+
+// Micro benchmarks that can be started from inside the app (key 'b', on a
+// worker thread) or the command line, results are written to the log.
+
+// fused DepthThreshold kernel against the OpenCV copy/threshold/threshold/cvAnd
+// chain it replaced, at Kinect v1 (640x480) and Kinect v2 (512x424) depth resolution
+void runThresholdBenchmark();
+
+// BubblePlacer for every player count the main menu offers (1-8) on the
+// 1920x1080 floor, reports mean and worst case time and how often it had to
+// shrink bubbles or fall back to the grid layout
+void runPlacementBenchmark();
+
+// drives vision, tracker and game simulation from a depth recording (or
+// "synthetic" people walking circles) as fast as possible on the recorded
+// clock, no window or kinect needed. Logs p50/p95/p99 per stage, end to end
+// and allocations per frame, and writes them as JSON to jsonPath if given
+// so builds can be compared.
+void runPipelineBenchmark(const std::string& recording, const VisionSettings& settings, const std::string& jsonPath = "");
+
+// one vision worker thread per sensor on synthetic frames, for 1 to maxSensors
+// sensors. Logs frames per second in total and how that compares to a single
+// sensor, which should grow about linearly while there are free cores.
+void runSensorScalingBenchmark(int maxSensors = 4);
+
+// BlobLabeler on one thread and on all cores against the ofxCvContourFinder it
+// replaced, on synthetic floors with 1 to 30 people and, if a recording is
+// given, on its thresholded frames. Logs the mean time per frame of each and
+// whether both found the same number of blobs.
+void runLabelerBenchmark(const std::string& recording, const VisionSettings& settings);
+
+// NetworkPublisher to a NetworkReceiver in the same process over 127.0.0.1,
+// with 8 bubbles and 1 to 30 people per frame. Logs packet size, time to pack
+// and send a frame, allocations per send and how many frames were lost or
+// arrived stale.
+void runNetworkBenchmark(int port = 12000);
+
+// plays games unattended on a simulated 30 fps clock: a SyntheticCrowd of
+// up to people walkers plays along, rendered into depth frames for the vision
+// (depth) or handed to the tracker as points, and an operator picks the player
+// count and presses start and play again. Every reportEvery games it logs frame
+// time percentiles, allocations, live allocations and resident memory, so
+// growth over the run shows up, and at the end placement stalls, shrunk and
+// fallback layouts and rounds won and lost. Writes everything as JSON to
+// jsonPath if given.
+void runSoakTest(int games, int people, bool depth, const std::string& jsonPath = "", int reportEvery = 50);
+
+// AudioMixer with 1 to 16 voices of synthetic cues, mean and worst time to
+// mix a 256 frame buffer and allocations while mixing. Then an AudioEngine on
+// the null output takes a play command every few milliseconds from this
+// thread for a few seconds and logs how late the sounds started and whether
+// commands were dropped.
+void runAudioBenchmark();
+
+// Headless checks, they log what they compared and return false on a difference.
+
+// players at 60 fps play two games with a fixed seed and every input they
+// gave is written down with its time. The script is then played into two
+// GameSimulations calling advance() at 30 and 144 fps, whose outputs,
+// snapshots every 1/6 s and final state have to be the same.
+bool runSimulationCheck();
+
+// the same depth frames, from a recording or synthetic people, through a
+// threaded and a synchronous VisionWorker, waiting for the threaded one to
+// take each frame. Whole frames, regions of interest and the morphology are
+// all used; masks and blobs of every frame have to be the same.
+bool runVisionCheck(const std::string& recording, const VisionSettings& settings);
@@ -0,0 +1,437 @@
+#include "BlobLabeler.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int minStripeRows = 16; // thinner stripes cost more at the seams than they save
+
+int findRoot(std::vector<int>& parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// the smaller index becomes the root, so a root is the first run of its component in raster order
+void unite(std::vector<int>& parent, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b)
+    {
+        parent[b] = a;
+    }
+    else if (b < a)
+    {
+        parent[a] = b;
+    }
+}
+
+// the mask is 0 or 255, so eight pixels at a time are either all clear or all set
+int skipWhile(const uint8_t* row, int x, int width, uint64_t word)
+{
+    for (; x + 8 <= width; x += 8)
+    {
+        uint64_t pixels;
+        std::memcpy(&pixels, row + x, 8);
+        if (pixels != word)
+        {
+            break;
+        }
+    }
+    const uint8_t value = (uint8_t)word;
+    while (x < width && (row[x] != 0) == (value != 0))
+    {
+        x++;
+    }
+    return x;
+}
+
+} // namespace
+
+BlobLabeler::~BlobLabeler()
+{
+    stopWorkers();
+}
+
+void BlobLabeler::setup(int width_, int height_, int numStripes, const std::string& name_)
+{
+    stopWorkers();
+    width = width_;
+    height = height_;
+    name = name_;
+
+    if (numStripes <= 0)
+    {
+        numStripes = (int)std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    numStripes = std::max(std::min(numStripes, height / minStripeRows), 1);
+
+    // a person is a handful of runs per row, reserve generously so labeling never reallocates
+    stripes.assign(numStripes, Stripe());
+    for (int s = 0; s < numStripes; s++)
+    {
+        Stripe& stripe = stripes[s];
+        stripe.y0 = height * s / numStripes;
+        stripe.y1 = height * (s + 1) / numStripes;
+        int capacity = (stripe.y1 - stripe.y0) * 16;
+        stripe.runs.reserve(capacity);
+        stripe.parent.reserve(capacity);
+        stripe.components.reserve(capacity);
+    }
+    rowStart.assign(height, 0);
+    rowEnd.assign(height, 0);
+    stripeBase.assign(numStripes + 1, 0);
+    globalParent.reserve(height * 16);
+    mergedOfRoot.reserve(height * 16);
+    merged.reserve(256);
+
+    for (int s = 1; s < numStripes; s++)
+    {
+        workers.emplace_back(&BlobLabeler::workerFunction, this, s, generation);
+    }
+}
+
+void BlobLabeler::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    startCondition.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    quit = false;
+}
+
+int BlobLabeler::getNumStripes() const
+{
+    return (int)stripes.size();
+}
+
+void BlobLabeler::workerFunction(int stripe, uint64_t startGeneration)
+{
+    Profiler::setThreadName((name + " " + std::to_string(stripe)).c_str());
+    uint64_t seen = startGeneration;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+            {
+                return;
+            }
+            seen = generation;
+        }
+
+        labelStripe(stripes[stripe]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+void BlobLabeler::label(const uint8_t* mask_, int stride_, int minArea, int maxArea, int maxBlobs, std::vector<LabeledBlob>& blobs)
+{
+    mask = mask_;
+    stride = stride_;
+
+    // every stripe on its own, the first one on this thread
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        pending = (int)workers.size();
+    }
+    startCondition.notify_all();
+    labelStripe(stripes[0]);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this] { return pending == 0; });
+    }
+
+    PROFILE_SCOPE("merge stripes");
+    int total = 0;
+    for (int s = 0; s < (int)stripes.size(); s++)
+    {
+        stripeBase[s] = total;
+        total += (int)stripes[s].runs.size();
+    }
+    stripeBase[stripes.size()] = total;
+
+    // the stripes flattened their trees, so every run points straight at its root
+    globalParent.resize(total);
+    for (int s = 0; s < (int)stripes.size(); s++)
+    {
+        const std::vector<int>& parent = stripes[s].parent;
+        int base = stripeBase[s];
+        for (int i = 0; i < (int)parent.size(); i++)
+        {
+            globalParent[base + i] = base + parent[i];
+        }
+    }
+    for (int s = 0; s + 1 < (int)stripes.size(); s++)
+    {
+        joinSeam(s);
+    }
+
+    // roots in increasing order, so a component is created by its first root
+    // before any later root of another stripe is added to it
+    merged.clear();
+    mergedOfRoot.resize(total);
+    for (int s = 0; s < (int)stripes.size(); s++)
+    {
+        const Stripe& stripe = stripes[s];
+        int base = stripeBase[s];
+        for (int i = 0; i < (int)stripe.runs.size(); i++)
+        {
+            if (stripe.parent[i] != i)
+            {
+                continue;
+            }
+            const Component& component = stripe.components[i];
+            int root = findRoot(globalParent, base + i);
+            if (root == base + i)
+            {
+                mergedOfRoot[root] = (int)merged.size();
+                merged.push_back(component);
+                continue;
+            }
+            Component& into = merged[mergedOfRoot[root]];
+            into.area += component.area;
+            into.sumX += component.sumX;
+            into.sumY += component.sumY;
+            into.minX = std::min(into.minX, component.minX);
+            into.minY = std::min(into.minY, component.minY);
+            into.maxX = std::max(into.maxX, component.maxX);
+            into.maxY = std::max(into.maxY, component.maxY);
+        }
+    }
+
+    blobs.clear();
+    for (const Component& component : merged)
+    {
+        if (component.area < minArea || component.area > maxArea)
+        {
+            continue;
+        }
+        LabeledBlob blob;
+        blob.centroidX = (float)(component.sumX / component.area);
+        blob.centroidY = (float)(component.sumY / component.area);
+        blob.area = component.area;
+        blob.minX = component.minX;
+        blob.minY = component.minY;
+        blob.maxX = component.maxX;
+        blob.maxY = component.maxY;
+        blob.seedX = component.seedX;
+        blob.seedY = component.seedY;
+        blobs.push_back(blob);
+    }
+
+    // largest first like the contour finder, ties in raster order so the result is stable
+    std::sort(blobs.begin(), blobs.end(), [](const LabeledBlob& a, const LabeledBlob& b) {
+        if (a.area != b.area)
+        {
+            return a.area > b.area;
+        }
+        return a.seedY != b.seedY ? a.seedY < b.seedY : a.seedX < b.seedX;
+    });
+    if ((int)blobs.size() > maxBlobs)
+    {
+        blobs.resize(maxBlobs);
+    }
+}
+
+void BlobLabeler::labelStripe(Stripe& stripe)
+{
+    PROFILE_SCOPE("label stripe");
+    std::vector<Run>& runs = stripe.runs;
+    std::vector<int>& parent = stripe.parent;
+    runs.clear();
+    parent.clear();
+
+    for (int y = stripe.y0; y < stripe.y1; y++)
+    {
+        const uint8_t* row = mask + (size_t)y * stride;
+        int start = (int)runs.size();
+        int x = 0;
+        while (x < width)
+        {
+            x = skipWhile(row, x, width, 0);
+            if (x >= width)
+            {
+                break;
+            }
+            int x0 = x;
+            x = skipWhile(row, x, width, ~0ull);
+            parent.push_back((int)runs.size());
+            runs.push_back({ y, x0, x });
+        }
+        rowStart[y] = start;
+        rowEnd[y] = (int)runs.size();
+
+        // join with the runs of the row above, both lists are sorted by x.
+        // 8-connectivity: runs touch if they overlap or meet at a corner
+        if (y > stripe.y0)
+        {
+            int a = rowStart[y - 1];
+            int b = start;
+            while (a < rowEnd[y - 1] && b < rowEnd[y])
+            {
+                if (runs[a].x0 <= runs[b].x1 && runs[b].x0 <= runs[a].x1)
+                {
+                    unite(parent, a, b);
+                }
+                if (runs[a].x1 < runs[b].x1)
+                {
+                    a++;
+                }
+                else
+                {
+                    b++;
+                }
+            }
+        }
+    }
+
+    // flatten the trees and sum every component into its root run. The root
+    // is the first run of the component, so it is set up before the others
+    std::vector<Component>& components = stripe.components;
+    components.resize(runs.size());
+    for (int i = 0; i < (int)runs.size(); i++)
+    {
+        const Run& run = runs[i];
+        int length = run.x1 - run.x0;
+        double sumX = (double)(run.x0 + run.x1 - 1) * length / 2;
+        int root = findRoot(parent, i);
+        parent[i] = root;
+        if (root == i)
+        {
+            components[i] = { length, sumX, (double)run.y * length, run.x0, run.y, run.x1 - 1, run.y, run.x0, run.y };
+            continue;
+        }
+        Component& component = components[root];
+        component.area += length;
+        component.sumX += sumX;
+        component.sumY += (double)run.y * length;
+        component.minX = std::min(component.minX, run.x0);
+        component.maxX = std::max(component.maxX, run.x1 - 1);
+        component.maxY = run.y;
+    }
+}
+
+void BlobLabeler::joinSeam(int upper)
+{
+    const Stripe& top = stripes[upper];
+    const Stripe& bottom = stripes[upper + 1];
+    if (top.y1 <= top.y0 || bottom.y1 <= bottom.y0)
+    {
+        return;
+    }
+
+    // last row of the upper stripe against the first row of the lower one
+    int lastRow = top.y1 - 1;
+    int firstRow = bottom.y0;
+    int a = rowStart[lastRow];
+    int b = rowStart[firstRow];
+    int topBase = stripeBase[upper];
+    int bottomBase = stripeBase[upper + 1];
+    while (a < rowEnd[lastRow] && b < rowEnd[firstRow])
+    {
+        const Run& runA = top.runs[a];
+        const Run& runB = bottom.runs[b];
+        if (runA.x0 <= runB.x1 && runB.x0 <= runA.x1)
+        {
+            unite(globalParent, topBase + a, bottomBase + b);
+        }
+        if (runA.x1 < runB.x1)
+        {
+            a++;
+        }
+        else
+        {
+            b++;
+        }
+    }
+}
+
+void BlobLabeler::traceContour(const uint8_t* mask, int stride, int width, int height, int seedX, int seedY, std::vector<int>& points)
+{
+    // neighbours clockwise on screen (y down), starting east
+    static const int dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+    static const int dy[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+    // direction of an offset, indexed by (dy + 1) * 3 + dx + 1
+    static const int directionOf[9] = { 5, 6, 7, 4, -1, 0, 3, 2, 1 };
+
+    auto isSet = [&](int x, int y) {
+        return x >= 0 && y >= 0 && x < width && y < height && mask[(size_t)y * stride + x] != 0;
+    };
+
+    points.clear();
+    if (!isSet(seedX, seedY))
+    {
+        return;
+    }
+    points.push_back(seedX);
+    points.push_back(seedY);
+
+    // moore neighbour tracing. The seed is the topmost, leftmost pixel, so its
+    // west neighbour is background and the search starts right after it
+    int x = seedX;
+    int y = seedY;
+    int back = 4;
+    int firstMove = -1;
+    const int maxSteps = 4 * width * height;
+    for (int step = 0; step < maxSteps; step++)
+    {
+        int move = -1;
+        for (int k = 1; k <= 8; k++)
+        {
+            int d = (back + k) % 8;
+            if (isSet(x + dx[d], y + dy[d]))
+            {
+                move = d;
+                break;
+            }
+        }
+        if (move < 0)
+        {
+            return; // a single pixel
+        }
+        if (x == seedX && y == seedY && move == firstMove)
+        {
+            break; // around once, leaving the seed the same way as the first time
+        }
+        if (firstMove < 0)
+        {
+            firstMove = move;
+        }
+
+        // the neighbour checked just before the move is background, the next search starts after it
+        int backX = x + dx[(move + 7) % 8];
+        int backY = y + dy[(move + 7) % 8];
+        x += dx[move];
+        y += dy[move];
+        back = directionOf[(backY - y + 1) * 3 + backX - x + 1];
+        points.push_back(x);
+        points.push_back(y);
+    }
+
+    // the walk ends on the seed again
+    if (points.size() > 2)
+    {
+        points.resize(points.size() - 2);
+    }
+}
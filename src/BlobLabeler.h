@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// one 8-connected region of the mask
+struct LabeledBlob {
+    float centroidX = 0;
+    float centroidY = 0;
+    int area = 0;     // pixels
+    int minX = 0;     // bounding box, inclusive
+    int minY = 0;
+    int maxX = 0;
+    int maxY = 0;
+    int seedX = 0;    // topmost, then leftmost pixel, where traceContour() starts
+    int seedY = 0;
+};
+
+// Connected components of a binary mask without tracing any contours. Every
+// row is cut into runs of set pixels, runs touching a run of the row above
+// are joined with union-find, and area, centroid and bounding box are summed
+// per component on the way. The image is split into horizontal stripes that
+// are labeled in parallel, components crossing a stripe seam are joined
+// afterwards by comparing the two rows at the seam only.
+class BlobLabeler {
+public:
+    ~BlobLabeler();
+
+    // stripes = 0 uses one per hardware thread. The calling thread labels the
+    // first stripe, the others get a thread each that lives until the destructor.
+    void setup(int width, int height, int stripes = 0, const std::string& name = "labeler");
+
+    // blobs with minArea <= area <= maxArea, largest first, at most maxBlobs
+    void label(const uint8_t* mask, int stride, int minArea, int maxArea, int maxBlobs, std::vector<LabeledBlob>& blobs);
+
+    // outer contour of the blob containing the seed pixel by walking its border,
+    // for the debug view only. points are x, y pairs of border pixels in clockwise order
+    static void traceContour(const uint8_t* mask, int stride, int width, int height, int seedX, int seedY, std::vector<int>& points);
+
+    int getNumStripes() const;
+
+private:
+    struct Run {
+        int y;
+        int x0;
+        int x1; // exclusive
+    };
+
+    struct Component {
+        int area;
+        double sumX;
+        double sumY;
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+        int seedX;
+        int seedY;
+    };
+
+    // indices into runs, parent and components are local to the stripe
+    struct Stripe {
+        int y0 = 0;
+        int y1 = 0;
+        std::vector<Run> runs;
+        std::vector<int> parent;           // union-find over runs, a root is always the first run of its component
+        std::vector<Component> components; // valid at root runs
+    };
+
+    void labelStripe(Stripe& stripe);
+    void joinSeam(int upper);
+    void workerFunction(int stripe, uint64_t startGeneration);
+    void stopWorkers();
+
+    int width = 0;
+    int height = 0;
+
+    std::vector<Stripe> stripes;
+    std::vector<int> rowStart; // runs of row y are rowStart[y] .. rowEnd[y] of its stripe,
+    std::vector<int> rowEnd;   // every row is written by the thread of its stripe only
+
+    // seam merge, calling thread only. indices are stripeBase[stripe] + local run
+    std::vector<int> stripeBase;
+    std::vector<int> globalParent;
+    std::vector<int> mergedOfRoot;
+    std::vector<Component> merged;
+
+    const uint8_t* mask = nullptr;
+    int stride = 0;
+
+    std::string name;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    uint64_t generation = 0;
+    int pending = 0;
+    bool quit = false;
+};
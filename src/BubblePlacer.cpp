@@ -0,0 +1,182 @@
+#include "BubblePlacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+void BubblePlacer::setup(const Settings& settings_, uint32_t seed)
+{
+    settings = settings_;
+    setSeed(seed);
+}
+
+void BubblePlacer::setSeed(uint32_t seed)
+{
+    generator.seed(seed);
+}
+
+float BubblePlacer::random(float min, float max)
+{
+    if (max <= min)
+    {
+        return min;
+    }
+    std::uniform_real_distribution<float> distribution(min, max);
+    return distribution(generator);
+}
+
+const char* BubblePlacer::getResultName(Result result)
+{
+    switch (result)
+    {
+    case placed:
+        return "placed";
+    case placedShrunk:
+        return "placedShrunk";
+    case fallbackLayout:
+        return "fallbackLayout";
+    }
+    return "unknown";
+}
+
+void BubblePlacer::splitIntoGroups(int people)
+{
+    // same distribution as the old rejection loop: pick 1..remaining players per bubble
+    groups.clear();
+    while (people > 0)
+    {
+        int amount = std::min(people, 1 + (int)random(0, (float)people));
+        groups.push_back(amount);
+        people -= amount;
+    }
+    std::sort(groups.begin(), groups.end(), [](int a, int b) { return a > b; });
+}
+
+bool BubblePlacer::fits(float x, float y, float radius, float width, float height, const std::vector<PlacedBubble>& bubbles) const
+{
+    if (x - radius < settings.margin || y - radius < settings.margin || x + radius > width - settings.margin || y + radius > height - settings.margin)
+    {
+        return false;
+    }
+    for (const PlacedBubble& other : bubbles)
+    {
+        float minDistance = radius + other.radius + settings.margin;
+        float dx = x - other.x;
+        float dy = y - other.y;
+        if (dx * dx + dy * dy < minDistance * minDistance)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BubblePlacer::placeBubble(int index, float width, float height, std::vector<PlacedBubble>& bubbles)
+{
+    float radius = radii[index];
+    float low = radius + settings.margin;
+
+    for (int attempt = 0; attempt < settings.candidatesPerBubble; attempt++)
+    {
+        float x;
+        float y;
+        if (bubbles.empty() || attempt % 2 == 0)
+        {
+            // anywhere on the floor
+            x = random(low, width - low);
+            y = random(low, height - low);
+        }
+        else
+        {
+            // in the annulus just outside an existing bubble, which packs tightly
+            const PlacedBubble& anchor = bubbles[(int)random(0, (float)bubbles.size()) % bubbles.size()];
+            float minDistance = anchor.radius + radius + settings.margin;
+            float distance = random(minDistance, minDistance * 1.5f);
+            float angle = random(0, 6.2831853f);
+            x = anchor.x + distance * std::cos(angle);
+            y = anchor.y + distance * std::sin(angle);
+        }
+        if (fits(x, y, radius, width, height, bubbles))
+        {
+            bubbles.push_back({ x, y, radius, groups[index] });
+            return true;
+        }
+    }
+    return false;
+}
+
+void BubblePlacer::placeGrid(int people, float width, float height, std::vector<PlacedBubble>& bubbles)
+{
+    // precomputed layout that always fits: one bubble per player on a regular grid
+    bubbles.clear();
+    if (people <= 0)
+    {
+        return;
+    }
+    int columns = (int)std::ceil(std::sqrt(people * width / height));
+    columns = std::max(1, std::min(columns, people));
+    int rows = (people + columns - 1) / columns;
+    float cellWidth = width / columns;
+    float cellHeight = height / rows;
+    float radius = std::max(1.0f, std::min(cellWidth, cellHeight) / 2 - settings.margin);
+    for (int i = 0; i < people; i++)
+    {
+        int column = i % columns;
+        int row = i / columns;
+        bubbles.push_back({ (column + 0.5f) * cellWidth, (row + 0.5f) * cellHeight, radius, 1 });
+    }
+}
+
+BubblePlacer::Result BubblePlacer::place(int people, float width, float height, std::vector<PlacedBubble>& bubbles)
+{
+    float largestFitting = std::min(width, height) / 2 - settings.margin;
+
+    for (int regroup = 0; regroup < settings.maxRegroups; regroup++)
+    {
+        splitIntoGroups(people);
+        radii.clear();
+        bool shrunk = false;
+        for (int amount : groups)
+        {
+            float minRadius = settings.baseMinRadius + settings.radiusPerPlayer * amount;
+            float maxRadius = settings.baseMaxRadius + settings.radiusPerPlayer * amount;
+            float radius = random(minRadius, maxRadius);
+            shrunk = shrunk || radius > largestFitting;
+            radii.push_back(std::min(radius, largestFitting));
+        }
+
+        for (int step = 0; step <= settings.maxShrinkSteps; step++)
+        {
+            bubbles.clear();
+            int failed = -1;
+            for (int i = 0; i < (int)groups.size(); i++)
+            {
+                if (!placeBubble(i, width, height, bubbles))
+                {
+                    failed = i;
+                    break;
+                }
+            }
+            if (failed < 0)
+            {
+                return shrunk ? placedShrunk : placed;
+            }
+
+            // make everything from the failed bubble on smaller and try again
+            bool canShrink = false;
+            for (int i = failed; i < (int)radii.size(); i++)
+            {
+                float smaller = std::max(radii[i] * settings.shrinkFactor, settings.minRadius);
+                canShrink = canShrink || smaller < radii[i];
+                radii[i] = smaller;
+            }
+            if (!canShrink)
+            {
+                break;
+            }
+            shrunk = true;
+        }
+    }
+
+    placeGrid(people, width, height, bubbles);
+    return fallbackLayout;
+}
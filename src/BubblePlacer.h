@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+struct PlacedBubble {
+    float x;
+    float y;
+    float radius;
+    int amount; // players that have to stand in it
+};
+
+// Places the bubbles of a round with a hard upper bound on the work done.
+// Players are split into random groups like before, bubbles are placed
+// largest first with Bridson style candidates around the bubbles already on
+// the floor. A bubble that does not fit is shrunk, then the grouping is
+// rerolled, and if nothing works a fixed one-player-per-bubble grid is used.
+class BubblePlacer {
+public:
+    enum Result
+    {
+        placed = 0,       // layout with the requested radii
+        placedShrunk = 1, // some bubbles had to be made smaller to fit
+        fallbackLayout = 2 // no random layout fit, grid of single player bubbles
+    };
+
+    struct Settings {
+        float margin = 20;            // gap between bubbles and to the screen border
+        float baseMinRadius = 150;    // radius range is base + perPlayer * amount
+        float baseMaxRadius = 200;
+        float radiusPerPlayer = 100;
+        float minRadius = 110;        // bubbles never shrink below this
+        float shrinkFactor = 0.85f;
+        int candidatesPerBubble = 30; // Bridson's k
+        int maxShrinkSteps = 4;
+        int maxRegroups = 6;
+    };
+
+    void setup(const Settings& settings, uint32_t seed);
+    void setSeed(uint32_t seed);
+
+    Result place(int people, float width, float height, std::vector<PlacedBubble>& bubbles);
+
+    static const char* getResultName(Result result);
+
+private:
+    float random(float min, float max);
+    void splitIntoGroups(int people);
+    bool placeBubble(int index, float width, float height, std::vector<PlacedBubble>& bubbles);
+    bool fits(float x, float y, float radius, float width, float height, const std::vector<PlacedBubble>& bubbles) const;
+    void placeGrid(int people, float width, float height, std::vector<PlacedBubble>& bubbles);
+
+    Settings settings;
+    std::mt19937 generator;
+    std::vector<int> groups; // players per bubble, largest first
+    std::vector<float> radii;
+};
@@ -0,0 +1,296 @@
+#include "BubbleRenderer.h"
+
+#include <cstddef>
+
+namespace {
+
+// instance attribute locations, after the ones openFrameworks binds by default
+const int circleAttribute = 5;
+const int colorAttribute = 6;
+const int arcAttribute = 7;
+
+// GLSL 1.50 for the programmable renderer, one instance per circle
+const char* instancedVertexShader = R"(#version 150
+uniform mat4 modelViewProjectionMatrix;
+in vec4 position;
+in vec4 circle;    // x, y, radius, inner radius
+in vec4 fillColor;
+in float arc;
+out vec2 local;
+out vec4 color;
+out vec3 shape;
+void main()
+{
+    // one unit larger than the circle so the antialiased edge fits
+    local = position.xy * (circle.z + 1.0);
+    color = fillColor;
+    shape = vec3(circle.z, circle.w, arc);
+    gl_Position = modelViewProjectionMatrix * vec4(circle.xy + local, 0.0, 1.0);
+}
+)";
+
+const char* instancedFragmentShader = R"(#version 150
+in vec2 local;
+in vec4 color;
+in vec3 shape;
+out vec4 outputColor;
+void main()
+{
+    float d = length(local);
+    float coverage = clamp(shape.x - d + 0.5, 0.0, 1.0);
+    coverage *= shape.y > 0.0 ? clamp(d - shape.y + 0.5, 0.0, 1.0) : 1.0;
+    // clockwise from twelve o'clock, y points down on screen
+    coverage *= shape.z < 1.0 ? step(fract(atan(local.x, -local.y) / 6.2831853), shape.z) : 1.0;
+    if (coverage <= 0.0)
+    {
+        discard;
+    }
+    outputColor = vec4(color.rgb, color.a * coverage);
+}
+)";
+
+// GLSL 1.20 for the fixed function renderer, the quads come in world space
+const char* batchedVertexShader = R"(#version 120
+varying vec2 local;
+varying vec3 shape;
+void main()
+{
+    local = gl_MultiTexCoord0.xy;
+    shape = gl_Normal;
+    gl_FrontColor = gl_Color;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+}
+)";
+
+const char* batchedFragmentShader = R"(#version 120
+varying vec2 local;
+varying vec3 shape;
+void main()
+{
+    float d = length(local);
+    float coverage = clamp(shape.x - d + 0.5, 0.0, 1.0);
+    if (shape.y > 0.0)
+    {
+        coverage *= clamp(d - shape.y + 0.5, 0.0, 1.0);
+    }
+    if (shape.z < 1.0)
+    {
+        coverage *= step(fract(atan(local.x, -local.y) / 6.2831853), shape.z);
+    }
+    if (coverage <= 0.0)
+    {
+        discard;
+    }
+    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * coverage);
+}
+)";
+
+} // namespace
+
+void BubbleRenderer::setup(int maxCircles_)
+{
+    maxCircles = maxCircles_;
+    instances.reserve(maxCircles);
+
+    if (ofIsGLProgrammableRenderer() && setupInstanced())
+    {
+        mode = instanced;
+    }
+    else if (!ofIsGLProgrammableRenderer() && setupBatched())
+    {
+        mode = batched;
+    }
+    else
+    {
+        mode = immediate;
+    }
+    ofLogNotice("BubbleRenderer") << "drawing circles " << getModeName();
+}
+
+bool BubbleRenderer::setupInstanced()
+{
+    if (!shader.setupShaderFromSource(GL_VERTEX_SHADER, instancedVertexShader)
+        || !shader.setupShaderFromSource(GL_FRAGMENT_SHADER, instancedFragmentShader))
+    {
+        return false;
+    }
+    shader.bindDefaults();
+    shader.bindAttribute(circleAttribute, "circle");
+    shader.bindAttribute(colorAttribute, "fillColor");
+    shader.bindAttribute(arcAttribute, "arc");
+    if (!shader.linkProgram())
+    {
+        return false;
+    }
+
+    const float corners[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+    quad.setVertexData(corners, 2, 4, GL_STATIC_DRAW);
+
+    instanceBuffer.allocate(maxCircles * sizeof(Instance), GL_STREAM_DRAW);
+    quad.setAttributeBuffer(circleAttribute, instanceBuffer, 4, sizeof(Instance), offsetof(Instance, x));
+    quad.setAttributeBuffer(colorAttribute, instanceBuffer, 4, sizeof(Instance), offsetof(Instance, r));
+    quad.setAttributeBuffer(arcAttribute, instanceBuffer, 1, sizeof(Instance), offsetof(Instance, arc));
+    quad.setAttributeDivisor(circleAttribute, 1);
+    quad.setAttributeDivisor(colorAttribute, 1);
+    quad.setAttributeDivisor(arcAttribute, 1);
+    return true;
+}
+
+bool BubbleRenderer::setupBatched()
+{
+    if (!shader.setupShaderFromSource(GL_VERTEX_SHADER, batchedVertexShader)
+        || !shader.setupShaderFromSource(GL_FRAGMENT_SHADER, batchedFragmentShader)
+        || !shader.linkProgram())
+    {
+        return false;
+    }
+
+    mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+    mesh.setUsage(GL_STREAM_DRAW);
+    mesh.getVertices().reserve(maxCircles * 6);
+    mesh.getTexCoords().reserve(maxCircles * 6);
+    mesh.getColors().reserve(maxCircles * 6);
+    mesh.getNormals().reserve(maxCircles * 6);
+    return true;
+}
+
+BubbleRenderer::Mode BubbleRenderer::getMode() const
+{
+    return mode;
+}
+
+const char* BubbleRenderer::getModeName() const
+{
+    switch (mode)
+    {
+    case instanced:
+        return "instanced";
+    case batched:
+        return "batched";
+    default:
+        return "immediate";
+    }
+}
+
+void BubbleRenderer::begin()
+{
+    instances.clear();
+}
+
+void BubbleRenderer::addCircle(float x, float y, float radius, const ofColor& color)
+{
+    addRing(x, y, radius, 0, color, 1);
+}
+
+void BubbleRenderer::addRing(float x, float y, float radius, float innerRadius, const ofColor& color, float arc)
+{
+    if ((int)instances.size() >= maxCircles)
+    {
+        return;
+    }
+    Instance instance;
+    instance.x = x;
+    instance.y = y;
+    instance.radius = radius;
+    instance.innerRadius = innerRadius;
+    instance.r = color.r / 255.0f;
+    instance.g = color.g / 255.0f;
+    instance.b = color.b / 255.0f;
+    instance.a = color.a / 255.0f;
+    instance.arc = arc;
+    instances.push_back(instance);
+}
+
+int BubbleRenderer::getNumCircles() const
+{
+    return (int)instances.size();
+}
+
+void BubbleRenderer::draw()
+{
+    if (instances.empty())
+    {
+        return;
+    }
+
+    ofPushStyle();
+    ofEnableAlphaBlending();
+    switch (mode)
+    {
+    case instanced:
+        drawInstanced();
+        break;
+    case batched:
+        drawBatched();
+        break;
+    default:
+        drawImmediate();
+        break;
+    }
+    ofPopStyle();
+}
+
+void BubbleRenderer::drawInstanced()
+{
+    // orphan last frame's storage so the upload never waits for the gpu
+    instanceBuffer.setData(maxCircles * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+    instanceBuffer.updateData(0, instances.size() * sizeof(Instance), instances.data());
+
+    shader.begin();
+    quad.drawInstanced(GL_TRIANGLE_STRIP, 0, 4, (int)instances.size());
+    shader.end();
+}
+
+void BubbleRenderer::drawBatched()
+{
+    std::vector<glm::vec3>& vertices = mesh.getVertices();
+    std::vector<glm::vec2>& texCoords = mesh.getTexCoords();
+    std::vector<ofFloatColor>& colors = mesh.getColors();
+    std::vector<glm::vec3>& normals = mesh.getNormals();
+    vertices.clear();
+    texCoords.clear();
+    colors.clear();
+    normals.clear();
+
+    const glm::vec2 corners[6] = { { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    for (const Instance& instance : instances)
+    {
+        float extent = instance.radius + 1;
+        ofFloatColor color(instance.r, instance.g, instance.b, instance.a);
+        glm::vec3 shape(instance.radius, instance.innerRadius, instance.arc);
+        for (const glm::vec2& corner : corners)
+        {
+            vertices.push_back(glm::vec3(instance.x + corner.x * extent, instance.y + corner.y * extent, 0));
+            texCoords.push_back(corner * extent);
+            colors.push_back(color);
+            normals.push_back(shape);
+        }
+    }
+
+    shader.begin();
+    mesh.draw();
+    shader.end();
+}
+
+void BubbleRenderer::drawImmediate()
+{
+    for (const Instance& instance : instances)
+    {
+        ofSetColor(ofFloatColor(instance.r, instance.g, instance.b, instance.a));
+        if (instance.innerRadius <= 0 && instance.arc >= 1)
+        {
+            ofDrawCircle(instance.x, instance.y, instance.radius);
+            continue;
+        }
+
+        // rings and arcs as a path, only used without shaders
+        ofPath path;
+        path.setCircleResolution(64);
+        path.setFillColor(ofFloatColor(instance.r, instance.g, instance.b, instance.a));
+        float end = -90 + 360 * std::min(instance.arc, 1.0f);
+        path.arc(instance.x, instance.y, instance.radius, instance.radius, -90, end);
+        path.arcNegative(instance.x, instance.y, instance.innerRadius, instance.innerRadius, end, -90);
+        path.close();
+        path.draw();
+    }
+}
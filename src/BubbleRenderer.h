@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <vector>
+
+// Draws filled circles and rings as signed distance fields, all added since
+// begin() in a single draw call with antialiased edges.
+//
+// On the programmable renderer (GL 3.2+) every circle is one instance of a
+// shared quad, on the default GL 2.1 renderer (and Mesa's software GL) the
+// quads are batched into one streamed mesh instead. If neither shader
+// compiles it falls back to ofDrawCircle() per circle.
+class BubbleRenderer {
+public:
+    enum Mode
+    {
+        instanced = 0,
+        batched = 1,
+        immediate = 2
+    };
+
+    void setup(int maxCircles = 1024);
+    Mode getMode() const;
+    const char* getModeName() const;
+
+    void begin();
+    void addCircle(float x, float y, float radius, const ofColor& color);
+    // only the part within innerRadius..radius is drawn, arc is the share of
+    // the ring drawn clockwise from twelve o'clock (1 = closed ring)
+    void addRing(float x, float y, float radius, float innerRadius, const ofColor& color, float arc = 1);
+    void draw();
+
+    int getNumCircles() const;
+
+private:
+    // laid out for the instance attributes, 48 bytes
+    struct Instance {
+        float x, y, radius, innerRadius;
+        float r, g, b, a;
+        float arc;
+        float padding[3];
+    };
+
+    bool setupInstanced();
+    bool setupBatched();
+    void drawInstanced();
+    void drawBatched();
+    void drawImmediate();
+
+    Mode mode = immediate;
+    int maxCircles = 0;
+    std::vector<Instance> instances;
+
+    ofShader shader;
+
+    // instanced: one unit quad plus a buffer with one Instance per circle
+    ofVbo quad;
+    ofBufferObject instanceBuffer;
+
+    // batched: two triangles per circle, the shape parameters ride in the normal
+    ofVboMesh mesh;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// refers to one bubble of one layout, stale as soon as the layout is replaced
+struct BubbleHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0; // 0 is never a valid generation
+};
+
+// Bubbles of the current layout (menu, round or end screen) in fixed storage
+// that lives as long as the game. What the occupancy test reads every tick
+// (center and squared radius) and the counts it writes sit in their own
+// contiguous arrays, radius and expected amount, only needed for drawing and
+// once per tick, are kept apart from them. reset() starts a new generation
+// instead of freeing anything, handles of the old layout then stop resolving.
+class BubbleStore {
+public:
+    static const int capacity = 32; // a round has at most one bubble per player, the menu nine
+
+    // drops all bubbles and invalidates their handles
+    void reset()
+    {
+        count = 0;
+        generation++;
+    }
+
+    // returns a default (invalid) handle when the store is full
+    BubbleHandle add(float x_, float y_, float radius_, int expectedAmount_)
+    {
+        BubbleHandle handle;
+        if (count >= capacity)
+        {
+            return handle;
+        }
+        x[count] = x_;
+        y[count] = y_;
+        radiusSquared[count] = radius_ * radius_;
+        counts[count] = 0;
+        radius[count] = radius_;
+        expectedAmount[count] = expectedAmount_;
+        handle.index = (uint32_t)count;
+        handle.generation = generation;
+        count++;
+        return handle;
+    }
+
+    // index of the bubble or -1 if the handle belongs to an older layout
+    int find(BubbleHandle handle) const
+    {
+        return handle.generation == generation && (int)handle.index < count ? (int)handle.index : -1;
+    }
+
+    bool contains(int i, float px, float py) const
+    {
+        float dx = px - x[i];
+        float dy = py - y[i];
+        return dx * dx + dy * dy <= radiusSquared[i];
+    }
+
+    // occupancy is recounted from zero every tick
+    void clearCounts()
+    {
+        std::memset(counts.data(), 0, sizeof(int) * count);
+    }
+
+    int* getCounts()
+    {
+        return counts.data();
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    uint32_t getGeneration() const
+    {
+        return generation;
+    }
+
+    float getX(int i) const
+    {
+        return x[i];
+    }
+
+    float getY(int i) const
+    {
+        return y[i];
+    }
+
+    float getRadius(int i) const
+    {
+        return radius[i];
+    }
+
+    int getExpectedAmount(int i) const // players needed, -2 is the start button, -3 play again
+    {
+        return expectedAmount[i];
+    }
+
+    int getCurrentAmount(int i) const
+    {
+        return counts[i];
+    }
+
+private:
+    // hot, read or written every tick
+    std::array<float, capacity> x;
+    std::array<float, capacity> y;
+    std::array<float, capacity> radiusSquared;
+    std::array<int, capacity> counts;
+
+    // cold
+    std::array<float, capacity> radius;
+    std::array<int, capacity> expectedAmount;
+
+    int count = 0;
+    uint32_t generation = 1;
+};
@@ -0,0 +1,156 @@
+#include "CircleGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void CircleGrid::clear()
+{
+    circleX.clear();
+    circleY.clear();
+    circleRadius.clear();
+    circleRadiusSquared.clear();
+    cellStart.clear();
+    cellItems.clear();
+    columns = 0;
+    rows = 0;
+}
+
+void CircleGrid::addCircle(float x, float y, float radius)
+{
+    circleX.push_back(x);
+    circleY.push_back(y);
+    circleRadius.push_back(radius);
+    circleRadiusSquared.push_back(radius * radius);
+}
+
+int CircleGrid::getNumCircles() const
+{
+    return (int)circleX.size();
+}
+
+void CircleGrid::build(float cellSize_)
+{
+    cellStart.clear();
+    cellItems.clear();
+    columns = 0;
+    rows = 0;
+    if (circleX.empty())
+    {
+        return;
+    }
+
+    // the grid only has to cover the circles, points outside of it hit nothing
+    float minX = circleX[0] - circleRadius[0];
+    float minY = circleY[0] - circleRadius[0];
+    float maxX = circleX[0] + circleRadius[0];
+    float maxY = circleY[0] + circleRadius[0];
+    for (int i = 1; i < getNumCircles(); i++)
+    {
+        minX = std::min(minX, circleX[i] - circleRadius[i]);
+        minY = std::min(minY, circleY[i] - circleRadius[i]);
+        maxX = std::max(maxX, circleX[i] + circleRadius[i]);
+        maxY = std::max(maxY, circleY[i] + circleRadius[i]);
+    }
+
+    cellSize = std::max(cellSize_, 1.0f);
+    inverseCellSize = 1.0f / cellSize;
+    originX = minX;
+    originY = minY;
+    columns = std::max(1, (int)std::ceil((maxX - minX) * inverseCellSize));
+    rows = std::max(1, (int)std::ceil((maxY - minY) * inverseCellSize));
+
+    // two passes: count the circles per cell, then fill the lists
+    cellStart.assign(columns * rows + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        std::vector<int> fill;
+        if (pass == 1)
+        {
+            for (int i = 0; i < columns * rows; i++)
+            {
+                cellStart[i + 1] += cellStart[i];
+            }
+            cellItems.assign(cellStart.back(), 0);
+            fill.assign(cellStart.begin(), cellStart.end() - 1);
+        }
+        for (int circle = 0; circle < getNumCircles(); circle++)
+        {
+            int firstColumn = std::max(0, (int)((circleX[circle] - circleRadius[circle] - originX) * inverseCellSize));
+            int lastColumn = std::min(columns - 1, (int)((circleX[circle] + circleRadius[circle] - originX) * inverseCellSize));
+            int firstRow = std::max(0, (int)((circleY[circle] - circleRadius[circle] - originY) * inverseCellSize));
+            int lastRow = std::min(rows - 1, (int)((circleY[circle] + circleRadius[circle] - originY) * inverseCellSize));
+            for (int row = firstRow; row <= lastRow; row++)
+            {
+                for (int column = firstColumn; column <= lastColumn; column++)
+                {
+                    int cell = row * columns + column;
+                    if (pass == 0)
+                    {
+                        cellStart[cell + 1]++;
+                    }
+                    else
+                    {
+                        cellItems[fill[cell]++] = circle;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int CircleGrid::cellIndex(float x, float y) const
+{
+    float column = (x - originX) * inverseCellSize;
+    float row = (y - originY) * inverseCellSize;
+    if (column < 0 || row < 0 || column >= columns || row >= rows)
+    {
+        return -1;
+    }
+    return (int)row * columns + (int)column;
+}
+
+bool CircleGrid::contains(int circle, float x, float y) const
+{
+    float dx = x - circleX[circle];
+    float dy = y - circleY[circle];
+    return dx * dx + dy * dy <= circleRadiusSquared[circle];
+}
+
+void CircleGrid::countPointsInCircles(TrackedPointSpan points, int* counts) const
+{
+    for (int i = 0; i < points.size(); i++)
+    {
+        int cell = cellIndex(points.x[i], points.y[i]);
+        if (cell < 0)
+        {
+            continue;
+        }
+        for (int item = cellStart[cell]; item < cellStart[cell + 1]; item++)
+        {
+            int circle = cellItems[item];
+            if (contains(circle, points.x[i], points.y[i]))
+            {
+                counts[circle]++;
+            }
+        }
+    }
+}
+
+int CircleGrid::findCircle(float x, float y) const
+{
+    int cell = cellIndex(x, y);
+    if (cell < 0)
+    {
+        return -1;
+    }
+    int found = -1;
+    for (int item = cellStart[cell]; item < cellStart[cell + 1]; item++)
+    {
+        int circle = cellItems[item];
+        if (contains(circle, x, y) && (found < 0 || circle < found))
+        {
+            found = circle;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "TrackedPoints.h"
+
+#include <vector>
+
+// Uniform grid over the bubbles of one round, rebuilt only when the bubbles
+// change. Every cell lists the circles whose bounding box touches it, so a
+// point is only tested against the few circles around it.
+class CircleGrid {
+public:
+    void clear();
+    void addCircle(float x, float y, float radius);
+    // call once after all circles were added
+    void build(float cellSize = 128);
+
+    int getNumCircles() const;
+
+    // adds the number of points inside each circle to counts[circle], in insertion order
+    void countPointsInCircles(TrackedPointSpan points, int* counts) const;
+    // index of the first circle containing the point or -1
+    int findCircle(float x, float y) const;
+
+private:
+    int cellIndex(float x, float y) const;
+    bool contains(int circle, float x, float y) const;
+
+    std::vector<float> circleX;
+    std::vector<float> circleY;
+    std::vector<float> circleRadius;
+    std::vector<float> circleRadiusSquared;
+
+    float originX = 0;
+    float originY = 0;
+    float cellSize = 128;
+    float inverseCellSize = 1.0f / 128;
+    int columns = 0;
+    int rows = 0;
+
+    // compressed cell lists: circles of cell i are cellItems[cellStart[i] .. cellStart[i + 1])
+    std::vector<int> cellStart;
+    std::vector<int> cellItems;
+};
@@ -0,0 +1,203 @@
+#include "DepthDebugView.h"
+
+#include <cstring>
+
+namespace {
+
+const char* programmableVertexShader = R"(#version 150
+uniform mat4 modelViewProjectionMatrix;
+in vec4 position;
+in vec2 texcoord;
+out vec2 uv;
+void main()
+{
+    uv = texcoord;
+    gl_Position = modelViewProjectionMatrix * position;
+}
+)";
+
+const char* programmableFragmentShader = R"(#version 150
+uniform sampler2D depth;
+uniform float nearThreshold;
+uniform float farThreshold;
+in vec2 uv;
+out vec4 outputColor;
+void main()
+{
+    // same rule as DepthThreshold: far < d <= near
+    float d = floor(texture(depth, uv).r * 255.0 + 0.5);
+    float keep = d > farThreshold && d <= nearThreshold ? 1.0 : 0.0;
+    outputColor = vec4(vec3(keep), 1.0);
+}
+)";
+
+const char* fixedVertexShader = R"(#version 120
+varying vec2 uv;
+void main()
+{
+    uv = gl_MultiTexCoord0.xy;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+}
+)";
+
+const char* fixedFragmentShader = R"(#version 120
+uniform sampler2D depth;
+uniform float nearThreshold;
+uniform float farThreshold;
+varying vec2 uv;
+void main()
+{
+    float d = floor(texture2D(depth, uv).r * 255.0 + 0.5);
+    float keep = d > farThreshold && d <= nearThreshold ? 1.0 : 0.0;
+    gl_FragColor = vec4(vec3(keep), 1.0);
+}
+)";
+
+} // namespace
+
+void StreamingTexture::setup(int width, int height, int glInternalFormat)
+{
+    // normalized coordinates so the threshold shader can use a plain sampler2D
+    texture.allocate(width, height, glInternalFormat, false);
+    glFormat = ofGetGLFormatFromInternal(glInternalFormat);
+    bytes = (size_t)width * height * (glInternalFormat == GL_RGB ? 3 : 1);
+    buffer.allocate(bytes, GL_STREAM_DRAW);
+    loaded = false;
+}
+
+void StreamingTexture::load(const ofPixels& pixels)
+{
+    if (pixels.getTotalBytes() != bytes)
+    {
+        return;
+    }
+
+    // orphan the old storage, the driver keeps it alive until the last upload from it is done
+    buffer.setData(bytes, nullptr, GL_STREAM_DRAW);
+    unsigned char* data = buffer.map<unsigned char>(GL_WRITE_ONLY);
+    if (data == nullptr)
+    {
+        return;
+    }
+    std::memcpy(data, pixels.getData(), bytes);
+    buffer.unmap();
+    texture.loadData(buffer, glFormat, GL_UNSIGNED_BYTE);
+    loaded = true;
+}
+
+bool StreamingTexture::isLoaded() const
+{
+    return loaded;
+}
+
+const ofTexture& StreamingTexture::getTexture() const
+{
+    return texture;
+}
+
+void StreamingTexture::draw(float x, float y, float width, float height) const
+{
+    if (loaded)
+    {
+        texture.draw(x, y, width, height);
+    }
+}
+
+//--------------------------------------------------------------
+void DepthDebugView::setup(int depthWidth_, int depthHeight_, int colorWidth, int colorHeight)
+{
+    depthWidth = depthWidth_;
+    depthHeight = depthHeight_;
+    depthTexture.setup(depthWidth, depthHeight, GL_LUMINANCE);
+    colorTexture.setup(colorWidth, colorHeight, GL_RGB);
+
+    bool programmable = ofIsGLProgrammableRenderer();
+    thresholdShaderLoaded = thresholdShader.setupShaderFromSource(GL_VERTEX_SHADER, programmable ? programmableVertexShader : fixedVertexShader)
+        && thresholdShader.setupShaderFromSource(GL_FRAGMENT_SHADER, programmable ? programmableFragmentShader : fixedFragmentShader);
+    if (thresholdShaderLoaded && programmable)
+    {
+        thresholdShader.bindDefaults();
+    }
+    thresholdShaderLoaded = thresholdShaderLoaded && thresholdShader.linkProgram();
+    if (!thresholdShaderLoaded)
+    {
+        ofLogWarning("DepthDebugView") << "threshold shader did not compile, the mask panel stays empty";
+    }
+
+    contourMesh.setMode(OF_PRIMITIVE_LINES);
+    contourMesh.setUsage(GL_DYNAMIC_DRAW);
+}
+
+void DepthDebugView::updateDepth(const ofPixels& depth)
+{
+    depthTexture.load(depth);
+}
+
+void DepthDebugView::updateColor(const ofPixels& color)
+{
+    colorTexture.load(color);
+}
+
+void DepthDebugView::updateContours(const VisionSnapshot& snapshot)
+{
+    std::vector<glm::vec3>& vertices = contourMesh.getVertices();
+    std::vector<ofFloatColor>& colors = contourMesh.getColors();
+    vertices.clear();
+    colors.clear();
+
+    const ofFloatColor contourColor(0, 1, 1);
+    const ofFloatColor boxColor(1, 0, 0);
+    const ofPixels& mask = snapshot.mask;
+    for (const VisionBlob& blob : snapshot.blobs)
+    {
+        // the vision worker only labels blobs, their outline is traced here and only while this view is shown
+        BlobLabeler::traceContour(mask.getData(), (int)mask.getWidth(), (int)mask.getWidth(), (int)mask.getHeight(), blob.seed.x, blob.seed.y, contourPoints);
+
+        // closed outline as line segments
+        int numPoints = (int)contourPoints.size() / 2;
+        for (int i = 0; i < numPoints; i++)
+        {
+            int next = (i + 1) % numPoints;
+            vertices.push_back(glm::vec3(contourPoints[i * 2], contourPoints[i * 2 + 1], 0));
+            vertices.push_back(glm::vec3(contourPoints[next * 2], contourPoints[next * 2 + 1], 0));
+            colors.push_back(contourColor);
+            colors.push_back(contourColor);
+        }
+
+        const ofRectangle& box = blob.boundingRect;
+        const glm::vec3 corners[4] = {
+            { box.getLeft(), box.getTop(), 0 }, { box.getRight(), box.getTop(), 0 },
+            { box.getRight(), box.getBottom(), 0 }, { box.getLeft(), box.getBottom(), 0 } };
+        for (int i = 0; i < 4; i++)
+        {
+            vertices.push_back(corners[i]);
+            vertices.push_back(corners[(i + 1) % 4]);
+            colors.push_back(boxColor);
+            colors.push_back(boxColor);
+        }
+    }
+}
+
+void DepthDebugView::draw(int nearThreshold, int farThreshold)
+{
+    ofSetColor(255, 255, 255);
+    depthTexture.draw(10, 10, 800, 600);
+    colorTexture.draw(820, 10, 800, 600);
+
+    if (thresholdShaderLoaded && depthTexture.isLoaded())
+    {
+        thresholdShader.begin();
+        thresholdShader.setUniformTexture("depth", depthTexture.getTexture(), 0);
+        thresholdShader.setUniform1f("nearThreshold", (float)nearThreshold);
+        thresholdShader.setUniform1f("farThreshold", (float)farThreshold);
+        depthTexture.draw(10, 620, 800, 600);
+        thresholdShader.end();
+    }
+
+    // contours of the latest vision snapshot, scaled like the images above
+    ofPushMatrix();
+    ofTranslate(820, 620);
+    ofScale(800.0 / depthWidth, 600.0 / depthHeight);
+    contourMesh.draw();
+    ofPopMatrix();
+}
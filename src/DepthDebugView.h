@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ofMain.h"
+#include "VisionWorker.h"
+
+// texture that is filled through a pixel buffer object, so the upload runs
+// asynchronously instead of stalling the render thread
+class StreamingTexture {
+public:
+    // glInternalFormat is GL_LUMINANCE or GL_RGB
+    void setup(int width, int height, int glInternalFormat);
+    void load(const ofPixels& pixels);
+    bool isLoaded() const;
+
+    const ofTexture& getTexture() const;
+    void draw(float x, float y, float width, float height) const;
+
+private:
+    ofTexture texture;
+    ofBufferObject buffer;
+    int glFormat = 0;
+    size_t bytes = 0;
+    bool loaded = false;
+};
+
+// The calibration view: depth, color, threshold mask and contours. Textures
+// are only touched when a new frame arrives, the mask is computed on the gpu
+// from the depth texture so moving the near/far sliders shows up at once.
+class DepthDebugView {
+public:
+    void setup(int depthWidth, int depthHeight, int colorWidth, int colorHeight);
+
+    // call only for new frames
+    void updateDepth(const ofPixels& depth);
+    void updateColor(const ofPixels& color);
+    void updateContours(const VisionSnapshot& snapshot);
+
+    // four 800x600 panels: depth, color, mask, contours
+    void draw(int nearThreshold, int farThreshold);
+
+private:
+    int depthWidth = 0;
+    int depthHeight = 0;
+
+    StreamingTexture depthTexture;
+    StreamingTexture colorTexture;
+    ofShader thresholdShader;
+    bool thresholdShaderLoaded = false;
+
+    // contours and bounding boxes of the newest snapshot as one line mesh
+    ofVboMesh contourMesh;
+    std::vector<int> contourPoints; // one traced contour, x y pairs
+};
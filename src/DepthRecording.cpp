@@ -0,0 +1,518 @@
+#include "DepthRecording.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(DepthRecordingHeader) == 32, "header is written as is");
+static_assert(sizeof(DepthRecordingFrame) == 24, "index entries are written as is");
+
+namespace {
+
+enum Op
+{
+    opCopy = 0,
+    opFill = 1,
+    opLiteral = 2
+};
+
+// shorter runs are cheaper as part of a literal
+const size_t minRun = 4;
+
+void writeOp(std::vector<unsigned char>& out, Op op, uint64_t count)
+{
+    uint64_t value = (count << 2) | op;
+    while (value >= 0x80)
+    {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
+}
+
+bool readOp(const unsigned char* in, size_t size, size_t& pos, Op& op, uint64_t& count)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= size)
+        {
+            return false;
+        }
+        unsigned char byte = in[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            op = (Op)(value & 3);
+            count = value >> 2;
+            return true;
+        }
+    }
+    return false;
+}
+
+void flushLiteral(const unsigned char* current, size_t& literalStart, size_t end, std::vector<unsigned char>& out)
+{
+    if (literalStart < end)
+    {
+        writeOp(out, opLiteral, end - literalStart);
+        out.insert(out.end(), current + literalStart, current + end);
+    }
+    literalStart = end;
+}
+
+void encodeFrame(const unsigned char* current, const unsigned char* reference, size_t count, std::vector<unsigned char>& out)
+{
+    out.clear();
+    size_t literalStart = 0;
+    size_t i = 0;
+    while (i < count)
+    {
+        size_t copy = 0;
+        while (i + copy < count && current[i + copy] == reference[i + copy])
+        {
+            copy++;
+        }
+        size_t fill = 1;
+        while (i + fill < count && current[i + fill] == current[i])
+        {
+            fill++;
+        }
+
+        if (copy >= minRun || fill >= minRun)
+        {
+            flushLiteral(current, literalStart, i, out);
+            if (copy >= fill)
+            {
+                writeOp(out, opCopy, copy);
+                i += copy;
+            }
+            else
+            {
+                writeOp(out, opFill, fill);
+                out.push_back(current[i]);
+                i += fill;
+            }
+            literalStart = i;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    flushLiteral(current, literalStart, count, out);
+}
+
+// decodes in place, pixels must hold the previous frame unless this is a keyframe
+bool decodePayload(const unsigned char* in, size_t size, unsigned char* pixels, size_t count, bool keyframe)
+{
+    size_t pos = 0;
+    size_t written = 0;
+    while (pos < size)
+    {
+        Op op;
+        uint64_t length;
+        if (!readOp(in, size, pos, op, length) || length > count - written)
+        {
+            return false;
+        }
+        switch (op)
+        {
+        case opCopy:
+            if (keyframe)
+            {
+                std::memset(pixels + written, 0, length);
+            }
+            break;
+        case opFill:
+            if (pos >= size)
+            {
+                return false;
+            }
+            std::memset(pixels + written, in[pos++], length);
+            break;
+        case opLiteral:
+            if (length > size - pos)
+            {
+                return false;
+            }
+            std::memcpy(pixels + written, in + pos, length);
+            pos += length;
+            break;
+        default:
+            return false;
+        }
+        written += length;
+    }
+    return written == count;
+}
+
+} // namespace
+
+//--------------------------------------------------------------
+DepthRecorder::~DepthRecorder()
+{
+    close();
+}
+
+bool DepthRecorder::open(const std::string& path_, int width, int height, int keyframeInterval)
+{
+    close();
+    path = path_;
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        ofLogError("DepthRecorder") << "could not open " << path;
+        return false;
+    }
+
+    header = DepthRecordingHeader();
+    header.width = width;
+    header.height = height;
+    header.keyframeInterval = std::max(keyframeInterval, 1);
+    index.clear();
+    previous.assign((size_t)width * height, 0);
+    bytesWritten = sizeof(header);
+
+    // rewritten with the final counts on close()
+    file.write((const char*)&header, sizeof(header));
+    return true;
+}
+
+void DepthRecorder::close()
+{
+    if (!file.is_open())
+    {
+        return;
+    }
+
+    // the index is read straight from the mapping, keep it 8 byte aligned
+    while (bytesWritten % 8 != 0)
+    {
+        file.put(0);
+        bytesWritten++;
+    }
+    header.frameCount = (uint32_t)index.size();
+    header.indexOffset = bytesWritten;
+    file.write((const char*)index.data(), index.size() * sizeof(DepthRecordingFrame));
+    bytesWritten += index.size() * sizeof(DepthRecordingFrame);
+    file.seekp(0);
+    file.write((const char*)&header, sizeof(header));
+    file.close();
+
+    ofLogNotice("DepthRecorder") << "wrote " << index.size() << " frames, " << bytesWritten / 1024 << " kB to " << path;
+}
+
+bool DepthRecorder::isOpen() const
+{
+    return file.is_open();
+}
+
+void DepthRecorder::addFrame(const ofPixels& depth, uint64_t timestampMicros)
+{
+    if (!file.is_open())
+    {
+        return;
+    }
+    if (depth.getWidth() != header.width || depth.getHeight() != header.height || depth.getNumChannels() != 1)
+    {
+        ofLogError("DepthRecorder") << "depth frame has the wrong size: " << depth.getWidth() << "x" << depth.getHeight();
+        return;
+    }
+
+    DepthRecordingFrame frame;
+    frame.keyframe = index.size() % header.keyframeInterval == 0 ? 1 : 0;
+    if (frame.keyframe)
+    {
+        std::fill(previous.begin(), previous.end(), 0);
+    }
+    encodeFrame(depth.getData(), previous.data(), previous.size(), payload);
+    std::memcpy(previous.data(), depth.getData(), previous.size());
+
+    frame.offset = bytesWritten;
+    frame.timestampMicros = timestampMicros;
+    frame.size = (uint32_t)payload.size();
+    file.write((const char*)payload.data(), payload.size());
+    bytesWritten += payload.size();
+    index.push_back(frame);
+}
+
+int DepthRecorder::getNumFrames() const
+{
+    return (int)index.size();
+}
+
+uint64_t DepthRecorder::getBytesWritten() const
+{
+    return bytesWritten;
+}
+
+//--------------------------------------------------------------
+DepthReplay::~DepthReplay()
+{
+    close();
+}
+
+bool DepthReplay::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        ofLogError("DepthReplay") << "could not open " << path;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (view == NULL)
+    {
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        ofLogError("DepthReplay") << "could not map " << path;
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const unsigned char*)view;
+    dataSize = (size_t)size.QuadPart;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        ofLogError("DepthReplay") << "could not open " << path;
+        return false;
+    }
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    ::close(file); // the mapping keeps the file alive
+    if (view == MAP_FAILED)
+    {
+        ofLogError("DepthReplay") << "could not map " << path;
+        return false;
+    }
+    data = (const unsigned char*)view;
+    dataSize = (size_t)info.st_size;
+#endif
+
+    // never trust the file, every offset is checked once here
+    bool valid = dataSize >= sizeof(header);
+    if (valid)
+    {
+        std::memcpy(&header, data, sizeof(header));
+        valid = std::memcmp(header.magic, "CBDR", 4) == 0 && header.version == 1
+            && header.width > 0 && header.height > 0 && header.keyframeInterval > 0
+            && header.indexOffset % 8 == 0 && header.indexOffset <= dataSize
+            && header.frameCount <= (dataSize - header.indexOffset) / sizeof(DepthRecordingFrame);
+    }
+    if (valid)
+    {
+        index = (const DepthRecordingFrame*)(data + header.indexOffset);
+        for (uint32_t i = 0; i < header.frameCount && valid; i++)
+        {
+            valid = index[i].offset <= header.indexOffset && index[i].size <= header.indexOffset - index[i].offset
+                && (i % header.keyframeInterval != 0 || index[i].keyframe)
+                && (i == 0 || index[i].timestampMicros >= index[i - 1].timestampMicros);
+        }
+    }
+    if (!valid || header.frameCount == 0)
+    {
+        ofLogError("DepthReplay") << path << " is not a depth recording or is empty";
+        close();
+        return false;
+    }
+
+    pixels.allocate(header.width, header.height, OF_IMAGE_GRAYSCALE);
+    pixels.set(0);
+    currentFrame = -1;
+    frameNew = false;
+    ofLogNotice("DepthReplay") << "opened " << path << ": " << header.frameCount << " frames, " << header.width << "x" << header.height;
+    return true;
+}
+
+void DepthReplay::close()
+{
+    if (data != nullptr)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle((HANDLE)mappingHandle);
+        CloseHandle((HANDLE)fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap((void*)data, dataSize);
+#endif
+    }
+    data = nullptr;
+    dataSize = 0;
+    index = nullptr;
+    header = DepthRecordingHeader();
+    currentFrame = -1;
+    frameNew = false;
+}
+
+void DepthReplay::setSpeed(double speed_)
+{
+    speed = std::max(speed_, 0.0);
+    // keep the current position when the speed changes mid playback
+    if (currentFrame >= 0 && speed > 0)
+    {
+        uint64_t played = index[currentFrame].timestampMicros - index[0].timestampMicros;
+        playStartMicros = ofGetElapsedTimeMicros() - (uint64_t)(played / speed);
+    }
+}
+
+void DepthReplay::setLoop(bool loop_)
+{
+    loop = loop_;
+}
+
+bool DepthReplay::isFinished() const
+{
+    return data == nullptr || (!loop && currentFrame == (int)header.frameCount - 1);
+}
+
+bool DepthReplay::readFrame(int frame)
+{
+    if (data == nullptr || frame < 0 || frame >= (int)header.frameCount)
+    {
+        return false;
+    }
+    if (frame == currentFrame)
+    {
+        return true;
+    }
+
+    // continue from the current frame if possible, otherwise from the keyframe before
+    int start = frame - frame % header.keyframeInterval;
+    if (currentFrame >= start && currentFrame < frame)
+    {
+        start = currentFrame + 1;
+    }
+    for (int i = start; i <= frame; i++)
+    {
+        if (!decodeFrame(i))
+        {
+            ofLogError("DepthReplay") << "frame " << i << " is corrupt";
+            currentFrame = -1;
+            return false;
+        }
+        currentFrame = i;
+    }
+    return true;
+}
+
+bool DepthReplay::decodeFrame(int frame)
+{
+    const DepthRecordingFrame& entry = index[frame];
+    return decodePayload(data + entry.offset, entry.size, pixels.getData(), (size_t)header.width * header.height, entry.keyframe != 0);
+}
+
+int DepthReplay::getNumFrames() const
+{
+    return header.frameCount;
+}
+
+int DepthReplay::getCurrentFrame() const
+{
+    return currentFrame;
+}
+
+void DepthReplay::update()
+{
+    frameNew = false;
+    if (data == nullptr)
+    {
+        return;
+    }
+
+    uint64_t now = ofGetElapsedTimeMicros();
+    int target;
+    if (currentFrame < 0)
+    {
+        playStartMicros = now;
+        target = 0;
+    }
+    else if (speed == 0)
+    {
+        target = currentFrame + 1;
+    }
+    else
+    {
+        // newest frame whose recording time has been reached
+        uint64_t played = (uint64_t)((now - playStartMicros) * speed) + index[0].timestampMicros;
+        const DepthRecordingFrame* end = index + header.frameCount;
+        const DepthRecordingFrame* next = std::upper_bound(index, end, played,
+            [](uint64_t time, const DepthRecordingFrame& frame) { return time < frame.timestampMicros; });
+        target = (int)(next - index) - 1;
+        if (next == end && currentFrame == (int)header.frameCount - 1)
+        {
+            target = header.frameCount; // past the end
+        }
+    }
+
+    if (target >= (int)header.frameCount)
+    {
+        if (!loop)
+        {
+            return;
+        }
+        target = 0;
+        playStartMicros = now;
+    }
+    if (target != currentFrame)
+    {
+        frameNew = readFrame(target);
+    }
+}
+
+bool DepthReplay::isFrameNew() const
+{
+    return frameNew;
+}
+
+bool DepthReplay::isConnected() const
+{
+    return data != nullptr;
+}
+
+const ofPixels& DepthReplay::getDepthPixels() const
+{
+    return pixels;
+}
+
+uint64_t DepthReplay::getFrameTimestampMicros() const
+{
+    return currentFrame >= 0 ? index[currentFrame].timestampMicros : 0;
+}
+
+int DepthReplay::getWidth() const
+{
+    return header.width;
+}
+
+int DepthReplay::getHeight() const
+{
+    return header.height;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "DepthSource.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// File format of a depth recording (.cbd), little endian:
+//
+//   header   DepthRecordingHeader
+//   frames   one encoded payload per frame, back to back
+//   index    frameCount x DepthRecordingFrame, at header.indexOffset
+//
+// A payload is a list of ops, each a varint (count << 2 | op) followed by
+// its data: copy takes count pixels from the reference, fill repeats the
+// next byte count times, literal copies the next count bytes. The reference
+// is the previous frame, or all zero for keyframes so playback can start
+// there. Most of the floor does not change, so a frame is mostly copy ops.
+// The whole file is memory mapped on playback, nothing is read up front.
+struct DepthRecordingHeader {
+    char magic[4] = { 'C', 'B', 'D', 'R' };
+    uint32_t version = 1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t frameCount = 0;
+    uint32_t keyframeInterval = 0;
+    uint64_t indexOffset = 0;
+};
+
+struct DepthRecordingFrame {
+    uint64_t offset = 0; // of the payload, from the start of the file
+    uint64_t timestampMicros = 0;
+    uint32_t size = 0;   // of the payload in bytes
+    uint32_t keyframe = 0;
+};
+
+// appends depth frames to a recording, writes the index on close()
+class DepthRecorder {
+public:
+    ~DepthRecorder();
+
+    bool open(const std::string& path, int width, int height, int keyframeInterval = 60);
+    void close();
+    bool isOpen() const;
+
+    void addFrame(const ofPixels& depth, uint64_t timestampMicros);
+    int getNumFrames() const;
+    uint64_t getBytesWritten() const;
+
+private:
+    std::ofstream file;
+    std::string path;
+    DepthRecordingHeader header;
+    std::vector<DepthRecordingFrame> index;
+    std::vector<unsigned char> previous;
+    std::vector<unsigned char> payload;
+    uint64_t bytesWritten = 0;
+};
+
+// plays a recording back as a depth source, in real time, faster or as fast as frames decode
+class DepthReplay : public DepthSource {
+public:
+    ~DepthReplay();
+
+    bool open(const std::string& path);
+    void close();
+
+    // 1 plays in real time, 4 four times as fast, 0 delivers the next frame on every update()
+    void setSpeed(double speed);
+    void setLoop(bool loop);
+    bool isFinished() const;
+
+    // decode one frame into getDepthPixels(), seeks over the nearest keyframe if needed
+    bool readFrame(int frame);
+    int getNumFrames() const;
+    int getCurrentFrame() const;
+
+    void update() override;
+    bool isFrameNew() const override;
+    bool isConnected() const override;
+    const ofPixels& getDepthPixels() const override;
+    uint64_t getFrameTimestampMicros() const override;
+    int getWidth() const override;
+    int getHeight() const override;
+
+private:
+    bool decodeFrame(int frame);
+
+    // read only mapping of the whole file
+    const unsigned char* data = nullptr;
+    size_t dataSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    DepthRecordingHeader header;
+    const DepthRecordingFrame* index = nullptr;
+    ofPixels pixels;
+
+    double speed = 1;
+    bool loop = true;
+    bool frameNew = false;
+    int currentFrame = -1;
+    uint64_t playStartMicros = 0;
+};
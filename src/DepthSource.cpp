@@ -0,0 +1,95 @@
+#include "DepthSource.h"
+
+void KinectDepthSource::setup(ofxKinect& kinect_)
+{
+    kinect = &kinect_;
+}
+
+void KinectDepthSource::update()
+{
+    kinect->update();
+    if (kinect->isFrameNew())
+    {
+        frameTimestampMicros = ofGetElapsedTimeMicros();
+    }
+}
+
+bool KinectDepthSource::isFrameNew() const
+{
+    return kinect->isFrameNew();
+}
+
+bool KinectDepthSource::isConnected() const
+{
+    return kinect->isConnected();
+}
+
+const ofPixels& KinectDepthSource::getDepthPixels() const
+{
+    return kinect->getDepthPixels();
+}
+
+uint64_t KinectDepthSource::getFrameTimestampMicros() const
+{
+    return frameTimestampMicros;
+}
+
+int KinectDepthSource::getWidth() const
+{
+    return kinect->width;
+}
+
+int KinectDepthSource::getHeight() const
+{
+    return kinect->height;
+}
+
+//--------------------------------------------------------------
+void SyntheticDepthSource::setup(SyntheticCrowd& crowd_, int width, int height, double frameRate)
+{
+    crowd = &crowd_;
+    pixels.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    frameMicros = (uint64_t)(1000000.0 / frameRate);
+    frameTimestampMicros = 0;
+}
+
+void SyntheticDepthSource::update()
+{
+    uint64_t now = ofGetElapsedTimeMicros();
+    frameNew = now - frameTimestampMicros >= frameMicros;
+    if (frameNew)
+    {
+        crowd->renderDepth(pixels.getData(), getWidth(), getHeight(), getWidth());
+        frameTimestampMicros = now;
+    }
+}
+
+bool SyntheticDepthSource::isFrameNew() const
+{
+    return frameNew;
+}
+
+bool SyntheticDepthSource::isConnected() const
+{
+    return true;
+}
+
+const ofPixels& SyntheticDepthSource::getDepthPixels() const
+{
+    return pixels;
+}
+
+uint64_t SyntheticDepthSource::getFrameTimestampMicros() const
+{
+    return frameTimestampMicros;
+}
+
+int SyntheticDepthSource::getWidth() const
+{
+    return (int)pixels.getWidth();
+}
+
+int SyntheticDepthSource::getHeight() const
+{
+    return (int)pixels.getHeight();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxKinect.h"
+#include "SyntheticCrowd.h"
+
+// Where depth frames come from. updateKinect() only talks to this, so a
+// recording can stand in for the live sensor.
+class DepthSource {
+public:
+    virtual ~DepthSource() {}
+
+    virtual void update() = 0;
+    virtual bool isFrameNew() const = 0;
+    virtual bool isConnected() const = 0;
+
+    // 8 bit depth image of the newest frame, same layout as ofxKinect::getDepthPixels()
+    virtual const ofPixels& getDepthPixels() const = 0;
+
+    // when the newest frame was captured, in micros on the source's own clock
+    virtual uint64_t getFrameTimestampMicros() const = 0;
+
+    virtual int getWidth() const = 0;
+    virtual int getHeight() const = 0;
+};
+
+// the live sensor, the kinect itself stays owned by SensorManager for tilt and the debug view
+class KinectDepthSource : public DepthSource {
+public:
+    void setup(ofxKinect& kinect);
+
+    void update() override;
+    bool isFrameNew() const override;
+    bool isConnected() const override;
+    const ofPixels& getDepthPixels() const override;
+    uint64_t getFrameTimestampMicros() const override;
+    int getWidth() const override;
+    int getHeight() const override;
+
+private:
+    ofxKinect* kinect = nullptr;
+    uint64_t frameTimestampMicros = 0;
+};
+
+// a SyntheticCrowd filmed from above at a kinect's resolution and frame rate,
+// the crowd itself is moved on by whoever owns it
+class SyntheticDepthSource : public DepthSource {
+public:
+    void setup(SyntheticCrowd& crowd, int width = 640, int height = 480, double frameRate = 30);
+
+    void update() override;
+    bool isFrameNew() const override;
+    bool isConnected() const override;
+    const ofPixels& getDepthPixels() const override;
+    uint64_t getFrameTimestampMicros() const override;
+    int getWidth() const override;
+    int getHeight() const override;
+
+private:
+    SyntheticCrowd* crowd = nullptr;
+    ofPixels pixels;
+    uint64_t frameMicros = 33333;
+    uint64_t frameTimestampMicros = 0;
+    bool frameNew = false;
+};
@@ -0,0 +1,162 @@
+#include "DepthThreshold.h"
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CB_THRESHOLD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CB_THRESHOLD_SSE2 1
+#endif
+
+namespace {
+
+// far < d <= near, using saturating subtraction so unsigned bytes compare correctly:
+// (d - near) saturates to 0 exactly when d <= near
+void thresholdRow(const uint8_t* src, uint8_t* dst, int width, uint8_t nearValue, uint8_t farValue)
+{
+    int x = 0;
+#if defined(CB_THRESHOLD_AVX2)
+    const __m256i nearVec = _mm256_set1_epi8((char)nearValue);
+    const __m256i farVec = _mm256_set1_epi8((char)farValue);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + x));
+        __m256i belowNear = _mm256_cmpeq_epi8(_mm256_subs_epu8(d, nearVec), zero);
+        __m256i belowFar = _mm256_cmpeq_epi8(_mm256_subs_epu8(d, farVec), zero);
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_andnot_si256(belowFar, belowNear));
+    }
+#endif
+#if defined(CB_THRESHOLD_AVX2) || defined(CB_THRESHOLD_SSE2)
+    const __m128i nearVec128 = _mm_set1_epi8((char)nearValue);
+    const __m128i farVec128 = _mm_set1_epi8((char)farValue);
+    const __m128i zero128 = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i belowNear = _mm_cmpeq_epi8(_mm_subs_epu8(d, nearVec128), zero128);
+        __m128i belowFar = _mm_cmpeq_epi8(_mm_subs_epu8(d, farVec128), zero128);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_andnot_si128(belowFar, belowNear));
+    }
+#endif
+    for (; x < width; x++)
+    {
+        dst[x] = (src[x] > farValue && src[x] <= nearValue) ? 255 : 0;
+    }
+}
+
+// dst = min or max of three rows
+void combineRows(const uint8_t* a, const uint8_t* b, const uint8_t* c, uint8_t* dst, int width, bool takeMax)
+{
+    int x = 0;
+#if defined(CB_THRESHOLD_AVX2) || defined(CB_THRESHOLD_SSE2)
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + x));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + x));
+        __m128i vc = _mm_loadu_si128((const __m128i*)(c + x));
+        __m128i r = takeMax ? _mm_max_epu8(_mm_max_epu8(va, vb), vc) : _mm_min_epu8(_mm_min_epu8(va, vb), vc);
+        _mm_storeu_si128((__m128i*)(dst + x), r);
+    }
+#endif
+    for (; x < width; x++)
+    {
+        dst[x] = takeMax ? std::max(std::max(a[x], b[x]), c[x]) : std::min(std::min(a[x], b[x]), c[x]);
+    }
+}
+
+} // namespace
+
+void DepthThreshold::setup(int width_, int height_)
+{
+    width = width_;
+    height = height_;
+    thresholdRows.assign(3 * width, 0);
+    firstPassRows.assign(3 * width, 0);
+    verticalRow.assign(width, 0);
+}
+
+int DepthThreshold::getWidth() const
+{
+    return width;
+}
+
+int DepthThreshold::getHeight() const
+{
+    return height;
+}
+
+const char* DepthThreshold::getInstructionSet()
+{
+#if defined(CB_THRESHOLD_AVX2)
+    return "avx2";
+#elif defined(CB_THRESHOLD_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void DepthThreshold::apply(const uint8_t* depth, int depthStride, uint8_t* mask, int maskStride, int nearThreshold, int farThreshold, Morphology morphology)
+{
+    applyRegion(depth, depthStride, mask, maskStride, width, height, nearThreshold, farThreshold, morphology);
+}
+
+void DepthThreshold::applyRegion(const uint8_t* depth, int depthStride, uint8_t* mask, int maskStride, int regionWidth, int regionHeight,
+    int nearThreshold, int farThreshold, Morphology morphology)
+{
+    regionWidth = std::min(regionWidth, width);
+    regionHeight = std::min(regionHeight, height);
+    uint8_t nearValue = (uint8_t)std::min(std::max(nearThreshold, 0), 255);
+    uint8_t farValue = (uint8_t)std::min(std::max(farThreshold, 0), 255);
+
+    if (morphology == none || regionWidth < 3 || regionHeight < 3)
+    {
+        for (int y = 0; y < regionHeight; y++)
+        {
+            thresholdRow(depth + y * depthStride, mask + y * maskStride, regionWidth, nearValue, farValue);
+        }
+        return;
+    }
+
+    FilterOp firstOp = morphology == open ? erodeOp : dilateOp;
+    FilterOp secondOp = morphology == open ? dilateOp : erodeOp;
+
+    // three stage row pipeline: threshold row y, first filter on row y - 1,
+    // second filter on row y - 2 straight into the output
+    for (int y = 0; y < regionHeight + 2; y++)
+    {
+        if (y < regionHeight)
+        {
+            thresholdRow(depth + y * depthStride, &thresholdRows[(y % 3) * width], regionWidth, nearValue, farValue);
+        }
+        int firstRow = y - 1;
+        if (firstRow >= 0 && firstRow < regionHeight)
+        {
+            filterRow(thresholdRows, firstRow, &firstPassRows[(firstRow % 3) * width], firstOp, regionWidth, regionHeight);
+        }
+        int secondRow = y - 2;
+        if (secondRow >= 0)
+        {
+            filterRow(firstPassRows, secondRow, mask + secondRow * maskStride, secondOp, regionWidth, regionHeight);
+        }
+    }
+}
+
+void DepthThreshold::filterRow(const std::vector<uint8_t>& ring, int row, uint8_t* dst, FilterOp op, int regionWidth, int regionHeight)
+{
+    // rows outside the image repeat the border, which leaves min and max unaffected
+    int above = std::max(row - 1, 0);
+    int below = std::min(row + 1, regionHeight - 1);
+    bool takeMax = op == dilateOp;
+
+    combineRows(&ring[(above % 3) * width], &ring[(row % 3) * width], &ring[(below % 3) * width], verticalRow.data(), regionWidth, takeMax);
+
+    const uint8_t* v = verticalRow.data();
+    const int last = regionWidth - 1;
+    dst[0] = takeMax ? std::max(v[0], v[1]) : std::min(v[0], v[1]);
+    combineRows(v, v + 1, v + 2, dst + 1, regionWidth - 2, takeMax);
+    dst[last] = takeMax ? std::max(v[last - 1], v[last]) : std::min(v[last - 1], v[last]);
+}
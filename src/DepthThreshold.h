@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Single pass replacement for the copy / threshold / threshold / cvAnd chain.
+// A pixel ends up 255 when farThreshold < depth <= nearThreshold, exactly like
+// the two cvThreshold calls followed by cvAnd, and 0 otherwise. An optional
+// 3x3 open or close is streamed over the rows while they are produced, so the
+// depth image is read once and the mask is written once.
+class DepthThreshold {
+public:
+    enum Morphology
+    {
+        none = 0,
+        open = 1, // erode then dilate, removes speckles
+        close = 2 // dilate then erode, fills small holes
+    };
+
+    void setup(int width, int height);
+
+    // strides are in bytes, pass the width for tightly packed images
+    void apply(const uint8_t* depth, int depthStride, uint8_t* mask, int maskStride, int nearThreshold, int farThreshold, Morphology morphology = none);
+
+    // same for a region of at most the setup size, depth and mask point at its
+    // top left pixel. The morphology treats the region border like the image border
+    void applyRegion(const uint8_t* depth, int depthStride, uint8_t* mask, int maskStride, int regionWidth, int regionHeight,
+        int nearThreshold, int farThreshold, Morphology morphology = none);
+
+    int getWidth() const;
+    int getHeight() const;
+
+    // name of the code path that was compiled in, "avx2", "sse2" or "scalar"
+    static const char* getInstructionSet();
+
+private:
+    enum FilterOp
+    {
+        erodeOp = 0,
+        dilateOp = 1
+    };
+
+    // ring rows are setup width apart, regionWidth and regionHeight bound the filter
+    void filterRow(const std::vector<uint8_t>& ring, int row, uint8_t* dst, FilterOp op, int regionWidth, int regionHeight);
+
+    int width = 0;
+    int height = 0;
+
+    // three row ring buffers for the two morphology stages, allocated once
+    std::vector<uint8_t> thresholdRows;
+    std::vector<uint8_t> firstPassRows;
+    std::vector<uint8_t> verticalRow;
+};
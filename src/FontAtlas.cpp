@@ -0,0 +1,469 @@
+#include "FontAtlas.h"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const int dpi = 96; // what ofTrueTypeFont uses unless told otherwise
+const uint32_t firstCodepoint = 32;
+const uint32_t lastCodepoint = 255;
+const char cacheMagic[4] = { 'C', 'B', 'F', 'A' };
+const uint32_t cacheVersion = 1;
+const int border = 1; // empty pixels around every glyph so filtering doesn't bleed
+
+uint64_t hashBytes(const char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    // FNV-1a
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+template<typename T>
+void put(std::vector<char>& out, const T& value)
+{
+    const char* bytes = (const char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+bool get(const char* data, size_t size, size_t& pos, T& value)
+{
+    if (size - pos < sizeof(T))
+    {
+        return false;
+    }
+    std::memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+uint64_t kerningKey(uint32_t first, uint32_t second)
+{
+    return ((uint64_t)first << 32) | second;
+}
+
+} // namespace
+
+//--------------------------------------------------------------
+bool FontAtlas::build(const std::string& path, int size, const std::string& cacheDirectory, Data& data)
+{
+    ofBuffer file = ofBufferFromFile(path, true);
+    if (file.size() == 0)
+    {
+        ofLogError("FontAtlas") << "could not read " << path;
+        return false;
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx_%d.atlas", (unsigned long long)hashBytes(file.getData(), file.size()), size);
+    std::string cachePath = ofFilePath::join(cacheDirectory, name);
+    if (readCache(cachePath, size, data))
+    {
+        data.fromCache = true;
+        return true;
+    }
+
+    if (!rasterize(path, size, data))
+    {
+        return false;
+    }
+    data.fromCache = false;
+    ofDirectory::createDirectory(cacheDirectory, false, true);
+    writeCache(cachePath, data);
+    return true;
+}
+
+bool FontAtlas::rasterize(const std::string& path, int size, Data& data)
+{
+    // one library per call, so several fonts can rasterize on different threads
+    FT_Library library;
+    if (FT_Init_FreeType(&library) != 0)
+    {
+        ofLogError("FontAtlas") << "could not initialize FreeType";
+        return false;
+    }
+    FT_Face face;
+    if (FT_New_Face(library, path.c_str(), 0, &face) != 0)
+    {
+        ofLogError("FontAtlas") << "could not load " << path;
+        FT_Done_FreeType(library);
+        return false;
+    }
+    FT_Set_Char_Size(face, size << 6, size << 6, dpi, dpi);
+
+    data.size = size;
+    data.lineHeight = face->size->metrics.height / 64.f;
+    data.glyphs.clear();
+    data.kerning.clear();
+
+    std::vector<std::vector<unsigned char>> bitmaps;
+    std::vector<FT_UInt> indices;
+    for (uint32_t codepoint = firstCodepoint; codepoint <= lastCodepoint; codepoint++)
+    {
+        FT_UInt index = FT_Get_Char_Index(face, codepoint);
+        if ((index == 0 && codepoint != ' ') || (codepoint >= 127 && codepoint < 160))
+        {
+            continue;
+        }
+        if (FT_Load_Glyph(face, index, FT_LOAD_DEFAULT) != 0 || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL) != 0)
+        {
+            continue;
+        }
+
+        const FT_Bitmap& bitmap = face->glyph->bitmap;
+        Glyph glyph;
+        glyph.codepoint = codepoint;
+        glyph.advance = face->glyph->advance.x / 64.f;
+        glyph.left = (float)face->glyph->bitmap_left;
+        glyph.top = (float)face->glyph->bitmap_top;
+        glyph.width = (float)bitmap.width;
+        glyph.height = (float)bitmap.rows;
+
+        std::vector<unsigned char> alpha(bitmap.width * bitmap.rows);
+        for (unsigned int row = 0; row < bitmap.rows; row++)
+        {
+            std::memcpy(alpha.data() + row * bitmap.width, bitmap.buffer + row * bitmap.pitch, bitmap.width);
+        }
+        data.glyphs.push_back(glyph);
+        bitmaps.push_back(std::move(alpha));
+        indices.push_back(index);
+    }
+
+    if (FT_HAS_KERNING(face))
+    {
+        for (size_t a = 0; a < data.glyphs.size(); a++)
+        {
+            for (size_t b = 0; b < data.glyphs.size(); b++)
+            {
+                FT_Vector delta;
+                if (FT_Get_Kerning(face, indices[a], indices[b], FT_KERNING_DEFAULT, &delta) == 0 && delta.x != 0)
+                {
+                    data.kerning.push_back({ data.glyphs[a].codepoint, data.glyphs[b].codepoint, delta.x / 64.f });
+                }
+            }
+        }
+    }
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+
+    // shelf packing, tallest glyphs first
+    std::vector<size_t> order(data.glyphs.size());
+    float area = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+        area += (data.glyphs[i].width + border * 2) * (data.glyphs[i].height + border * 2);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return data.glyphs[a].height > data.glyphs[b].height; });
+
+    int atlasWidth = 64;
+    while (atlasWidth * atlasWidth < area * 1.2f)
+    {
+        atlasWidth *= 2;
+    }
+    std::vector<glm::ivec2> positions(data.glyphs.size());
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (size_t i : order)
+    {
+        int width = (int)data.glyphs[i].width + border * 2;
+        int height = (int)data.glyphs[i].height + border * 2;
+        if (x + width > atlasWidth)
+        {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        positions[i] = glm::ivec2(x + border, y + border);
+        x += width;
+        shelfHeight = std::max(shelfHeight, height);
+    }
+    int atlasHeight = std::max(y + shelfHeight, 1);
+
+    data.pixels.allocate(atlasWidth, atlasHeight, 2);
+    unsigned char* pixels = data.pixels.getData();
+    for (size_t i = 0; i < (size_t)atlasWidth * atlasHeight; i++)
+    {
+        pixels[i * 2] = 255;
+        pixels[i * 2 + 1] = 0;
+    }
+    for (size_t i = 0; i < data.glyphs.size(); i++)
+    {
+        Glyph& glyph = data.glyphs[i];
+        int width = (int)glyph.width;
+        for (int row = 0; row < (int)glyph.height; row++)
+        {
+            unsigned char* out = pixels + ((size_t)(positions[i].y + row) * atlasWidth + positions[i].x) * 2;
+            const unsigned char* in = bitmaps[i].data() + row * width;
+            for (int column = 0; column < width; column++)
+            {
+                out[column * 2 + 1] = in[column];
+            }
+        }
+        glyph.u0 = positions[i].x / (float)atlasWidth;
+        glyph.v0 = positions[i].y / (float)atlasHeight;
+        glyph.u1 = (positions[i].x + glyph.width) / (float)atlasWidth;
+        glyph.v1 = (positions[i].y + glyph.height) / (float)atlasHeight;
+    }
+    return true;
+}
+
+bool FontAtlas::readCache(const std::string& cachePath, int size, Data& data)
+{
+    if (!ofFile::doesFileExist(cachePath, false))
+    {
+        return false;
+    }
+    ofBuffer file = ofBufferFromFile(cachePath, true);
+    const char* bytes = file.getData();
+    size_t fileSize = file.size();
+    uint64_t storedHash = 0;
+    if (fileSize >= sizeof(uint64_t))
+    {
+        std::memcpy(&storedHash, bytes + fileSize - sizeof(uint64_t), sizeof(uint64_t));
+    }
+    if (fileSize < sizeof(uint64_t) || hashBytes(bytes, fileSize - sizeof(uint64_t)) != storedHash)
+    {
+        ofLogWarning("FontAtlas") << cachePath << " is damaged, rasterizing again";
+        return false;
+    }
+    fileSize -= sizeof(uint64_t);
+
+    size_t pos = 0;
+    char magic[4];
+    uint32_t version;
+    uint32_t atlasWidth;
+    uint32_t atlasHeight;
+    uint32_t numGlyphs;
+    uint32_t numKerning;
+    if (!get(bytes, fileSize, pos, magic) || std::memcmp(magic, cacheMagic, 4) != 0
+        || !get(bytes, fileSize, pos, version) || version != cacheVersion
+        || !get(bytes, fileSize, pos, data.size) || data.size != size
+        || !get(bytes, fileSize, pos, data.lineHeight)
+        || !get(bytes, fileSize, pos, atlasWidth) || !get(bytes, fileSize, pos, atlasHeight)
+        || !get(bytes, fileSize, pos, numGlyphs) || numGlyphs > (fileSize - pos) / sizeof(Glyph))
+    {
+        return false;
+    }
+    data.glyphs.resize(numGlyphs);
+    std::memcpy(data.glyphs.data(), bytes + pos, numGlyphs * sizeof(Glyph));
+    pos += numGlyphs * sizeof(Glyph);
+    if (!get(bytes, fileSize, pos, numKerning) || numKerning > (fileSize - pos) / sizeof(Kerning))
+    {
+        return false;
+    }
+    data.kerning.resize(numKerning);
+    std::memcpy(data.kerning.data(), bytes + pos, numKerning * sizeof(Kerning));
+    pos += numKerning * sizeof(Kerning);
+    if (fileSize - pos != (size_t)atlasWidth * atlasHeight)
+    {
+        return false;
+    }
+
+    // only the alpha channel is stored
+    data.pixels.allocate(atlasWidth, atlasHeight, 2);
+    unsigned char* pixels = data.pixels.getData();
+    const unsigned char* alpha = (const unsigned char*)bytes + pos;
+    for (size_t i = 0; i < (size_t)atlasWidth * atlasHeight; i++)
+    {
+        pixels[i * 2] = 255;
+        pixels[i * 2 + 1] = alpha[i];
+    }
+    return true;
+}
+
+void FontAtlas::writeCache(const std::string& cachePath, const Data& data)
+{
+    std::vector<char> out;
+    out.insert(out.end(), cacheMagic, cacheMagic + 4);
+    put<uint32_t>(out, cacheVersion);
+    put<int32_t>(out, data.size);
+    put<float>(out, data.lineHeight);
+    put<uint32_t>(out, (uint32_t)data.pixels.getWidth());
+    put<uint32_t>(out, (uint32_t)data.pixels.getHeight());
+    put<uint32_t>(out, (uint32_t)data.glyphs.size());
+    for (const Glyph& glyph : data.glyphs)
+    {
+        put(out, glyph);
+    }
+    put<uint32_t>(out, (uint32_t)data.kerning.size());
+    for (const Kerning& kerning : data.kerning)
+    {
+        put(out, kerning);
+    }
+    const unsigned char* pixels = data.pixels.getData();
+    for (size_t i = 0; i < data.pixels.getWidth() * data.pixels.getHeight(); i++)
+    {
+        out.push_back((char)pixels[i * 2 + 1]);
+    }
+    put<uint64_t>(out, hashBytes(out.data(), out.size()));
+
+    // another instance may be starting at the same time, never leave a half written atlas
+    std::string temporaryPath = cachePath + ".tmp";
+    FILE* file = std::fopen(temporaryPath.c_str(), "wb");
+    bool written = file != nullptr && std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    if (file != nullptr)
+    {
+        std::fclose(file);
+    }
+    if (!written || std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+    {
+        ofLogWarning("FontAtlas") << "could not write " << cachePath;
+        std::remove(temporaryPath.c_str());
+    }
+}
+
+//--------------------------------------------------------------
+void FontAtlas::load(Data& data)
+{
+    if (data.glyphs.empty() || !data.pixels.isAllocated())
+    {
+        ofLogError("FontAtlas") << "nothing to load, the font failed to build";
+        return;
+    }
+    size = data.size;
+    lineHeight = data.lineHeight;
+    glyphs = data.glyphs;
+    glyphIndex.assign(lastCodepoint + 1, -1);
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        glyphIndex[glyphs[i].codepoint] = (int)i;
+    }
+    kerning.clear();
+    for (const Kerning& pair : data.kerning)
+    {
+        kerning[kerningKey(pair.first, pair.second)] = pair.amount;
+    }
+
+    // like ofTrueTypeFont: non-arb texture, linear filtering
+    texture.allocate(data.pixels, false);
+    texture.setTextureMinMagFilter(GL_LINEAR, GL_LINEAR);
+    texture.loadData(data.pixels);
+    data.pixels.clear();
+    loaded = true;
+}
+
+bool FontAtlas::isLoaded() const
+{
+    return loaded;
+}
+
+template<typename Visitor>
+void FontAtlas::iterate(const std::string& text, float x, float y, bool vFlipped, Visitor visit) const
+{
+    float penX = x;
+    float penY = y;
+    uint32_t previous = 0;
+    for (uint32_t codepoint : ofUTF8Iterator(text))
+    {
+        if (codepoint == '\n')
+        {
+            penX = x;
+            penY += vFlipped ? lineHeight : -lineHeight;
+            previous = 0;
+            continue;
+        }
+        if (codepoint >= glyphIndex.size() || glyphIndex[codepoint] < 0)
+        {
+            continue;
+        }
+        if (previous != 0 && !kerning.empty())
+        {
+            auto found = kerning.find(kerningKey(previous, codepoint));
+            if (found != kerning.end())
+            {
+                penX += found->second;
+            }
+        }
+        const Glyph& glyph = glyphs[glyphIndex[codepoint]];
+        visit(glyph, penX, penY);
+        penX += glyph.advance;
+        previous = codepoint;
+    }
+}
+
+ofMesh FontAtlas::getStringMesh(const std::string& text, float x, float y, bool vFlipped) const
+{
+    ofMesh mesh;
+    mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+    iterate(text, x, y, vFlipped, [&](const Glyph& glyph, float penX, float penY)
+    {
+        if (glyph.width == 0 || glyph.height == 0)
+        {
+            return;
+        }
+        float x0 = penX + glyph.left;
+        float x1 = x0 + glyph.width;
+        float y0 = vFlipped ? penY - glyph.top : penY + glyph.top;
+        float y1 = vFlipped ? y0 + glyph.height : y0 - glyph.height;
+
+        unsigned int first = (unsigned int)mesh.getNumVertices();
+        mesh.addVertex(glm::vec3(x0, y0, 0));
+        mesh.addVertex(glm::vec3(x1, y0, 0));
+        mesh.addVertex(glm::vec3(x1, y1, 0));
+        mesh.addVertex(glm::vec3(x0, y1, 0));
+        mesh.addTexCoord(glm::vec2(glyph.u0, glyph.v0));
+        mesh.addTexCoord(glm::vec2(glyph.u1, glyph.v0));
+        mesh.addTexCoord(glm::vec2(glyph.u1, glyph.v1));
+        mesh.addTexCoord(glm::vec2(glyph.u0, glyph.v1));
+        mesh.addIndex(first);
+        mesh.addIndex(first + 1);
+        mesh.addIndex(first + 2);
+        mesh.addIndex(first + 2);
+        mesh.addIndex(first + 3);
+        mesh.addIndex(first);
+    });
+    return mesh;
+}
+
+ofRectangle FontAtlas::getStringBoundingBox(const std::string& text, float x, float y, bool vFlipped) const
+{
+    bool empty = true;
+    float minX = x, minY = y, maxX = x, maxY = y;
+    iterate(text, x, y, vFlipped, [&](const Glyph& glyph, float penX, float penY)
+    {
+        float x0 = penX + glyph.left;
+        float y0 = vFlipped ? penY - glyph.top : penY + glyph.top - glyph.height;
+        if (empty)
+        {
+            minX = x0;
+            minY = y0;
+            maxX = x0 + glyph.width;
+            maxY = y0 + glyph.height;
+            empty = false;
+        }
+        else
+        {
+            minX = std::min(minX, x0);
+            minY = std::min(minY, y0);
+            maxX = std::max(maxX, x0 + glyph.width);
+            maxY = std::max(maxY, y0 + glyph.height);
+        }
+    });
+    return ofRectangle(minX, minY, maxX - minX, maxY - minY);
+}
+
+const ofTexture& FontAtlas::getFontTexture() const
+{
+    return texture;
+}
+
+int FontAtlas::getSize() const
+{
+    return size;
+}
+
+float FontAtlas::getLineHeight() const
+{
+    return lineHeight;
+}
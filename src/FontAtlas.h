@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// A TrueType font rasterized once into a glyph atlas, laid out like
+// ofTrueTypeFont (Latin-1, 96 dpi, kerning) but split in two halves:
+// build() does the FreeType work and may run on any thread, load() only
+// uploads the atlas and has to run on the render thread.
+//
+// Atlases are cached as <font hash>_<size>.atlas in the cache directory,
+// a later build() of the same font file and size skips FreeType entirely.
+class FontAtlas {
+public:
+    struct Glyph {
+        uint32_t codepoint = 0;
+        float advance = 0;
+        float left = 0; // bearing from the pen position to the bitmap
+        float top = 0;
+        float width = 0;
+        float height = 0;
+        float u0 = 0, v0 = 0, u1 = 0, v1 = 0; // normalized atlas coordinates
+    };
+
+    struct Kerning {
+        uint32_t first = 0;
+        uint32_t second = 0;
+        float amount = 0;
+    };
+
+    // cpu side of an atlas, what build() produces and load() consumes
+    struct Data {
+        int size = 0;
+        float lineHeight = 0;
+        std::vector<Glyph> glyphs;
+        std::vector<Kerning> kerning;
+        ofPixels pixels; // luminance alpha, like ofTrueTypeFont's atlas
+        bool fromCache = false;
+    };
+
+    static bool build(const std::string& path, int size, const std::string& cacheDirectory, Data& data);
+
+    void load(Data& data);
+    bool isLoaded() const;
+
+    // same geometry as the ofTrueTypeFont functions of the same name
+    ofMesh getStringMesh(const std::string& text, float x, float y, bool vFlipped = true) const;
+    ofRectangle getStringBoundingBox(const std::string& text, float x, float y, bool vFlipped = true) const;
+
+    const ofTexture& getFontTexture() const;
+    int getSize() const;
+    float getLineHeight() const;
+
+private:
+    static bool rasterize(const std::string& path, int size, Data& data);
+    static bool readCache(const std::string& cachePath, int size, Data& data);
+    static void writeCache(const std::string& cachePath, const Data& data);
+
+    template<typename Visitor>
+    void iterate(const std::string& text, float x, float y, bool vFlipped, Visitor visit) const;
+
+    int size = 0;
+    float lineHeight = 0;
+    std::vector<Glyph> glyphs;
+    std::vector<int> glyphIndex; // by codepoint, -1 if the font has none
+    std::map<uint64_t, float> kerning; // first << 32 | second
+    ofTexture texture;
+    bool loaded = false;
+};
@@ -0,0 +1,63 @@
+#include "GameFlow.h"
+
+void GameFlow::setup(gameStateEnum initialState, const std::vector<GameTransition>& transitions_, double now)
+{
+    transitions = transitions_;
+    state = initialState;
+    stateStart = now;
+    hasDeadline = false;
+}
+
+const GameTransition* GameFlow::handle(GameEvent event, double now)
+{
+    for (const GameTransition& transition : transitions)
+    {
+        if (transition.from == state && transition.event == event)
+        {
+            state = transition.to;
+            stateStart = now;
+            hasDeadline = transition.timeoutSeconds > 0;
+            if (hasDeadline)
+            {
+                deadline = now + transition.timeoutSeconds;
+            }
+            return &transition;
+        }
+    }
+    return nullptr;
+}
+
+const GameTransition* GameFlow::update(double now)
+{
+    if (hasDeadline && now >= deadline)
+    {
+        hasDeadline = false;
+        return handle(GameEvent::timeout, now);
+    }
+    return nullptr;
+}
+
+gameStateEnum GameFlow::getState() const
+{
+    return state;
+}
+
+double GameFlow::getStateStart() const
+{
+    return stateStart;
+}
+
+std::vector<GameTransition> GameFlow::getDefaultTransitions(double cooldownSeconds)
+{
+    return {
+        { mainMenu, GameEvent::start, gameLoop, 0 },
+        { gameLoop, GameEvent::roundWon, cooldown, cooldownSeconds },
+        { gameLoop, GameEvent::roundLost, cooldown, cooldownSeconds },
+        { cooldown, GameEvent::timeout, gameLoop, 0 },
+        { gameLoop, GameEvent::gameOver, endScreen, 0 },
+        { endScreen, GameEvent::playAgain, mainMenu, 0 },
+        { mainMenu, GameEvent::skipToEnd, endScreen, 0 },
+        { gameLoop, GameEvent::skipToEnd, endScreen, 0 },
+        { cooldown, GameEvent::skipToEnd, endScreen, 0 },
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+enum gameStateEnum
+{
+    mainMenu = 0,
+    gameLoop = 1,
+    endScreen = 2,
+    cooldown = 3 // pause between two rounds, shows the result of the last one
+};
+
+enum class GameEvent
+{
+    start,     // players stood in the start bubble
+    roundWon,  // every bubble holds the right amount of players
+    roundLost, // round time ran out
+    timeout,   // raised by GameFlow when a state's time is up
+    gameOver,  // all rounds played
+    playAgain, // players stood in the play again bubble
+    skipToEnd  // debug key
+};
+
+struct GameTransition {
+    gameStateEnum from;
+    GameEvent event;
+    gameStateEnum to;
+    double timeoutSeconds; // if > 0 the new state raises GameEvent::timeout after this long
+};
+
+// Game flow as a transition table. Events are raised by the simulation,
+// never from draw(), and timed states are driven by deadlines on the
+// simulation clock (in seconds) instead of sleeping, so rendering and vision
+// keep running during transitions.
+class GameFlow {
+public:
+    void setup(gameStateEnum initialState, const std::vector<GameTransition>& transitions, double now);
+
+    // returns the transition that was taken, or nullptr if the event means nothing in the current state
+    const GameTransition* handle(GameEvent event, double now);
+
+    // raises GameEvent::timeout once the deadline of the current state has passed
+    const GameTransition* update(double now);
+
+    gameStateEnum getState() const;
+    double getStateStart() const;
+
+    static std::vector<GameTransition> getDefaultTransitions(double cooldownSeconds);
+
+private:
+    std::vector<GameTransition> transitions;
+    gameStateEnum state = mainMenu;
+    double stateStart = 0;
+    double deadline = 0;
+    bool hasDeadline = false;
+};
@@ -0,0 +1,484 @@
+#include "GameSimulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+void GameSimulation::setup(const GameSettings& settings_, double startTime_)
+{
+    settings = settings_;
+    startTime = startTime_;
+    tickLength = 1.0 / settings.tickRate;
+    tickCount = 0;
+    now = startTime;
+
+    amountOfPlayers = settings.amountOfPlayers;
+    bubblePlacer.setup(BubblePlacer::Settings(), settings.seed);
+    clicks.reserve(16);
+    events.reserve(16);
+    tickClicks.reserve(16);
+    outputs.reserve(16);
+
+    flow.setup(mainMenu, GameFlow::getDefaultTransitions(settings.cooldownTime), now);
+    setupMainMenu();
+}
+
+//--------------------------------------------------------------
+void GameSimulation::pushPeople(double time, TrackedPointSpan points)
+{
+    // people is a state, not an event: when the queue is full the oldest entry is overwritten
+    int slot = (peopleHead + peopleCount) % (int)peopleQueue.size();
+    if (peopleCount == (int)peopleQueue.size())
+    {
+        peopleHead = (peopleHead + 1) % (int)peopleQueue.size();
+    }
+    else
+    {
+        peopleCount++;
+    }
+    PeopleInput& input = peopleQueue[slot];
+    input.time = time;
+    input.points.clear();
+    for (int i = 0; i < points.size(); i++)
+    {
+        input.points.push(points.x[i], points.y[i], points.area[i], points.id[i]);
+    }
+}
+
+void GameSimulation::pushClick(double time, float x, float y)
+{
+    clicks.push_back({ time, x, y });
+}
+
+void GameSimulation::pushEvent(double time, GameEvent event)
+{
+    events.push_back({ time, event });
+}
+
+int GameSimulation::advance(double time)
+{
+    // after a long stall jump ahead instead of replaying every missed tick
+    double behind = time - now;
+    if (behind > settings.maxCatchUp)
+    {
+        uint64_t skipped = (uint64_t)((behind - settings.maxCatchUp) / tickLength);
+        tickCount += skipped;
+        now = startTime + tickCount * tickLength;
+    }
+
+    int ticks = 0;
+    while (startTime + (tickCount + 1) * tickLength <= time)
+    {
+        tickCount++;
+        now = startTime + tickCount * tickLength;
+        tick(now);
+        ticks++;
+    }
+    return ticks;
+}
+
+void GameSimulation::applyInputs(double tickTime)
+{
+    previousPeople = people;
+    while (peopleCount > 0 && peopleQueue[peopleHead].time <= tickTime)
+    {
+        people = peopleQueue[peopleHead].points;
+        peopleHead = (peopleHead + 1) % (int)peopleQueue.size();
+        peopleCount--;
+    }
+
+    tickClicks.clear();
+    for (int i = 0; i < (int)clicks.size();)
+    {
+        if (clicks[i].time <= tickTime)
+        {
+            tickClicks.push_back(clicks[i]);
+            clicks.erase(clicks.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // a click counts as a person standing there for one tick
+    tickPoints = people;
+    for (const ClickInput& click : tickClicks)
+    {
+        tickPoints.push(click.x, click.y, 0, 0);
+    }
+}
+
+void GameSimulation::tick(double tickTime)
+{
+    applyInputs(tickTime);
+
+    for (int i = 0; i < (int)events.size();)
+    {
+        if (events[i].time <= tickTime)
+        {
+            GameEvent event = events[i].event;
+            events.erase(events.begin() + i);
+            raise(event);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // timed transitions, e.g. the end of the pause between two rounds
+    applyTransition(flow.update(tickTime));
+
+    switch (flow.getState())
+    {
+    case gameLoop:
+        updateCircles();
+        updateGameLoop();
+        break;
+    case cooldown:
+        // the next round is placed while the result of the last one is shown
+        updateCircles();
+        break;
+    case mainMenu:
+        updateMainMenu();
+        break;
+    case endScreen:
+        updateEndScreen();
+        break;
+    }
+}
+
+//--------------------------------------------------------------
+void GameSimulation::raise(GameEvent event)
+{
+    applyTransition(flow.handle(event, now));
+}
+
+void GameSimulation::applyTransition(const GameTransition* transition)
+{
+    if (transition == nullptr)
+    {
+        return;
+    }
+
+    switch (transition->event)
+    {
+    case GameEvent::start:
+        startGame();
+        outputs.push_back(GameOutput::gameStarted);
+        break;
+    case GameEvent::roundWon:
+        lastRoundWon = true;
+        setupNewRound();
+        outputs.push_back(GameOutput::roundWon);
+        break;
+    case GameEvent::roundLost:
+        lastRoundWon = false;
+        setupNewRound();
+        outputs.push_back(GameOutput::roundLost);
+        break;
+    case GameEvent::timeout:
+        // cooldown is over, next round
+        roundStart = now;
+        rounds++;
+        outputs.push_back(GameOutput::roundStarted);
+        break;
+    case GameEvent::gameOver:
+    case GameEvent::skipToEnd:
+        setupEndScreen();
+        outputs.push_back(GameOutput::gameEnded);
+        break;
+    case GameEvent::playAgain:
+        setupMainMenu();
+        outputs.push_back(GameOutput::menuEntered);
+        break;
+    }
+}
+
+void GameSimulation::startGame()
+{
+    bubbles.reset();
+    rebuildCircleGrid();
+    amountCorrect = 0;
+    score = 0;
+    amountOfCircles = 0;
+    rounds = 1;
+    numberOfPeople = amountOfPlayers;
+    newRound = true;
+    roundStart = now;
+    outputs.push_back(GameOutput::layoutChanged);
+}
+
+void GameSimulation::setupMainMenu()
+{
+    framesInCircle = 0;
+    bubbles.reset();
+    startButton = bubbles.add(settings.width / 2, settings.height / 2 - 100, 400, -2);
+
+    int numCircles = 8;
+    float circleDiameter = 200;
+    float spacing = 50;
+    float totalWidth = numCircles * circleDiameter + (numCircles - 3) * spacing;
+    float startX = (settings.width - totalWidth) / 2;
+
+    for (int i = 0; i < numCircles; i++) {
+        float x = startX + i * (circleDiameter + spacing);
+        float y = settings.height - 200;
+        bubbles.add(x, y, circleDiameter / 2, i + 1);
+    }
+    rebuildCircleGrid();
+    outputs.push_back(GameOutput::layoutChanged);
+}
+
+void GameSimulation::setupEndScreen()
+{
+    framesInCircle = 0;
+    bubbles.reset();
+    playAgainButton = bubbles.add(settings.width / 2, settings.height - 650, 360, -3);
+    rebuildCircleGrid();
+    outputs.push_back(GameOutput::layoutChanged);
+}
+
+void GameSimulation::setupNewRound()
+{
+    bubbles.reset();
+    rebuildCircleGrid();
+    newRound = true;
+    amountOfCircles = 0;
+    amountCorrect = 0;
+    numberOfPeople = amountOfPlayers;
+    outputs.push_back(GameOutput::layoutChanged);
+}
+
+//--------------------------------------------------------------
+void GameSimulation::updateEndScreen()
+{
+    int button = bubbles.find(playAgainButton);
+    if (button >= 0)
+    {
+        for (const ClickInput& click : tickClicks)
+        {
+            if (bubbles.contains(button, click.x, click.y))
+            {
+                framesInCircle++;
+                if (framesInCircle >= settings.waitTime)
+                {
+                    raise(GameEvent::playAgain);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void GameSimulation::updateMainMenu()
+{
+    int button = bubbles.find(startButton);
+    if (button >= 0)
+    {
+        for (const ClickInput& click : tickClicks)
+        {
+            // the player count buttons follow the start button
+            for (int j = button + 1; j < bubbles.size(); j++)
+            {
+                if (bubbles.contains(j, click.x, click.y))
+                {
+                    amountOfPlayers = bubbles.getExpectedAmount(j);
+                    outputs.push_back(GameOutput::playersChanged);
+                }
+            }
+
+            if (bubbles.contains(button, click.x, click.y))
+            {
+                framesInCircle++;
+                if (framesInCircle >= settings.waitTime)
+                {
+                    raise(GameEvent::start);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void GameSimulation::updateGameLoop()
+{
+    if (rounds > settings.roundAmount)
+    { // game is over
+        raise(GameEvent::gameOver);
+        return;
+    }
+
+    // occupancy is counted from scratch every tick
+    bubbles.clearCounts();
+    amountCorrect = 0;
+    updateContours();
+
+    int elapsedSeconds = (int)std::floor(now - roundStart);
+    if (amountCorrect == amountOfCircles && amountOfCircles != 0)
+    {
+        score += 50 * ((int)settings.roundTime - elapsedSeconds);
+        raise(GameEvent::roundWon);
+    }
+    else if (now - roundStart >= settings.roundTime)
+    {
+        raise(GameEvent::roundLost);
+    }
+}
+
+void GameSimulation::updateCircles()
+{
+    if (newRound)
+    {
+        newRound = false;
+
+        // bounded time placement, never stalls even if the player count can't fit the floor
+        lastPlacementResult = bubblePlacer.place(numberOfPeople, settings.width, settings.height, placedBubbles);
+        placementCount++;
+        for (const PlacedBubble& bubble : placedBubbles)
+        {
+            bubbles.add(bubble.x, bubble.y, bubble.radius, bubble.amount);
+        }
+        numberOfPeople = 0;
+        amountOfCircles = bubbles.size();
+        rebuildCircleGrid();
+        outputs.push_back(GameOutput::layoutChanged);
+    }
+}
+
+void GameSimulation::updateContours()
+{
+    // count all points of this tick in one pass over the grid, straight into the store
+    const int* counts = bubbles.getCounts();
+    circleGrid.countPointsInCircles(tickPoints.getSpan(), bubbles.getCounts());
+
+    for (int i = 0; i < bubbles.size(); i++)
+    {
+        if (counts[i] >= bubbles.getExpectedAmount(i))
+        {
+            amountCorrect++;
+        }
+    }
+}
+
+void GameSimulation::rebuildCircleGrid()
+{
+    circleGrid.clear();
+    for (int i = 0; i < bubbles.size(); i++)
+    {
+        circleGrid.addCircle(bubbles.getX(i), bubbles.getY(i), bubbles.getRadius(i));
+    }
+    circleGrid.build();
+}
+
+//--------------------------------------------------------------
+const std::vector<GameOutput>& GameSimulation::getOutputs() const
+{
+    return outputs;
+}
+
+void GameSimulation::clearOutputs()
+{
+    outputs.clear();
+}
+
+gameStateEnum GameSimulation::getState() const
+{
+    return flow.getState();
+}
+
+void GameSimulation::getSnapshot(GameSnapshot& snapshot) const
+{
+    snapshot.state = flow.getState();
+    snapshot.score = score;
+    snapshot.round = rounds;
+    snapshot.roundAmount = settings.roundAmount;
+    snapshot.amountOfPlayers = amountOfPlayers;
+    snapshot.remainingSeconds = getRemainingSeconds();
+    snapshot.lastRoundWon = lastRoundWon;
+    snapshot.layout = bubbles.getGeneration();
+    snapshot.bubbles = bubbles;
+}
+
+const BubbleStore& GameSimulation::getBubbles() const
+{
+    return bubbles;
+}
+
+int GameSimulation::getScore() const
+{
+    return score;
+}
+
+int GameSimulation::getRound() const
+{
+    return rounds;
+}
+
+int GameSimulation::getRoundAmount() const
+{
+    return settings.roundAmount;
+}
+
+int GameSimulation::getAmountOfPlayers() const
+{
+    return amountOfPlayers;
+}
+
+int GameSimulation::getRemainingSeconds() const
+{
+    int elapsedSeconds = (int)std::floor(now - roundStart);
+    return std::max((int)settings.roundTime - elapsedSeconds, 0);
+}
+
+bool GameSimulation::wasLastRoundWon() const
+{
+    return lastRoundWon;
+}
+
+double GameSimulation::getTime() const
+{
+    return now;
+}
+
+uint64_t GameSimulation::getTick() const
+{
+    return tickCount;
+}
+
+uint64_t GameSimulation::getPlacementCount() const
+{
+    return placementCount;
+}
+
+BubblePlacer::Result GameSimulation::getLastPlacementResult() const
+{
+    return lastPlacementResult;
+}
+
+float GameSimulation::getInterpolationAlpha(double time) const
+{
+    return (float)std::min(std::max((time - now) / tickLength, 0.0), 1.0);
+}
+
+void GameSimulation::getInterpolatedPeople(double time, TrackedPointBuffer& out) const
+{
+    float alpha = getInterpolationAlpha(time);
+    out.clear();
+    for (int i = 0; i < people.size(); i++)
+    {
+        TrackedPoint current = people[i];
+        TrackedPoint blended = current;
+        for (int j = 0; j < previousPeople.size(); j++)
+        {
+            if (previousPeople[j].id == current.id)
+            {
+                TrackedPoint previous = previousPeople[j];
+                blended.x = previous.x + (current.x - previous.x) * alpha;
+                blended.y = previous.y + (current.y - previous.y) * alpha;
+                break;
+            }
+        }
+        out.push(blended.x, blended.y, blended.area, blended.id);
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "GameFlow.h"
+#include "BubblePlacer.h"
+#include "BubbleStore.h"
+#include "CircleGrid.h"
+#include "TrackedPoints.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct GameSettings {
+    int roundAmount = 5;
+    double roundTime = 3;     // in seconds
+    double cooldownTime = 2;  // in seconds, pause between two rounds
+    int waitTime = 2;         // clicks inside a button before it triggers
+    int amountOfPlayers = 4;  // preselected in the main menu
+    float width = 1920;
+    float height = 1080;
+    double tickRate = 120;    // simulation steps per second
+    double maxCatchUp = 0.25; // in seconds, longer stalls are skipped instead of replayed
+    uint32_t seed = 1;
+};
+
+// things the presentation layer (sound, colors, score files) reacts to
+enum class GameOutput
+{
+    menuEntered,
+    gameStarted,
+    roundWon,
+    roundLost,
+    roundStarted,
+    gameEnded,
+    layoutChanged, // circles were replaced
+    playersChanged
+};
+
+// what the presentation layer draws, taken from the local simulation or
+// received from the sensing box on a render node
+struct GameSnapshot {
+    gameStateEnum state = mainMenu;
+    int score = 0;
+    int round = 1;
+    int roundAmount = 5;
+    int amountOfPlayers = 4;
+    int remainingSeconds = 0;
+    bool lastRoundWon = false;
+    uint32_t layout = 0; // changes whenever the bubbles are replaced
+    BubbleStore bubbles;
+};
+
+// The complete game logic, stepped at a fixed rate and independent of the
+// render frame rate. Inputs are timestamped and applied at the first tick at
+// or after their timestamp, so the same inputs always give the same game no
+// matter how often advance() is called. Nothing in here touches openFrameworks,
+// it runs headless.
+class GameSimulation {
+public:
+    void setup(const GameSettings& settings, double startTime);
+
+    // input, timestamps in seconds on the same clock that is passed to advance()
+    void pushPeople(double time, TrackedPointSpan people);
+    void pushClick(double time, float x, float y);
+    void pushEvent(double time, GameEvent event);
+
+    // runs all ticks up to time, returns how many ran
+    int advance(double time);
+
+    // presentation events raised by the ticks since the last clearOutputs()
+    const std::vector<GameOutput>& getOutputs() const;
+    void clearOutputs();
+
+    gameStateEnum getState() const;
+    void getSnapshot(GameSnapshot& snapshot) const;
+    const BubbleStore& getBubbles() const; // indices stay valid until the next layoutChanged
+    int getScore() const;
+    int getRound() const;
+    int getRoundAmount() const;
+    int getAmountOfPlayers() const;
+    int getRemainingSeconds() const;
+    bool wasLastRoundWon() const;
+    double getTime() const; // time of the last tick
+    uint64_t getTick() const;
+
+    // round layouts placed so far and how the last one went, for soak tests
+    uint64_t getPlacementCount() const;
+    BubblePlacer::Result getLastPlacementResult() const;
+
+    // rendering helpers: how far time is between the last tick and the next one,
+    // and the people of the last two ticks blended accordingly
+    float getInterpolationAlpha(double time) const;
+    void getInterpolatedPeople(double time, TrackedPointBuffer& people) const;
+
+private:
+    struct PeopleInput {
+        double time = 0;
+        TrackedPointBuffer points;
+    };
+
+    struct ClickInput {
+        double time;
+        float x;
+        float y;
+    };
+
+    struct EventInput {
+        double time;
+        GameEvent event;
+    };
+
+    void tick(double now);
+    void applyInputs(double now);
+
+    void raise(GameEvent event);
+    void applyTransition(const GameTransition* transition);
+
+    void startGame();
+    void setupMainMenu();
+    void setupEndScreen();
+    void setupNewRound();
+    void updateMainMenu();
+    void updateEndScreen();
+    void updateGameLoop();
+    void updateCircles();
+    void updateContours();
+    void rebuildCircleGrid();
+
+    GameSettings settings;
+    double startTime = 0;
+    double tickLength = 1.0 / 120;
+    uint64_t tickCount = 0;
+    double now = 0;
+
+    GameFlow flow;
+    BubblePlacer bubblePlacer;
+    std::vector<PlacedBubble> placedBubbles;
+    uint64_t placementCount = 0;
+    BubblePlacer::Result lastPlacementResult = BubblePlacer::placed;
+    BubbleStore bubbles;
+    BubbleHandle startButton;     // main menu
+    BubbleHandle playAgainButton; // end screen
+    CircleGrid circleGrid;
+
+    int amountOfPlayers = 4;
+    int amountCorrect = 0;
+    int amountOfCircles = 0;
+    int numberOfPeople = 0;
+    int score = 0;
+    int rounds = 1;
+    bool newRound = false;
+    bool lastRoundWon = false;
+    double roundStart = 0;
+    int framesInCircle = 0;
+
+    // pending inputs, people is a state so only the newest few are kept
+    std::array<PeopleInput, 4> peopleQueue;
+    int peopleHead = 0;
+    int peopleCount = 0;
+    std::vector<ClickInput> clicks;
+    std::vector<EventInput> events;
+
+    // inputs as seen by the current tick
+    TrackedPointBuffer people;
+    TrackedPointBuffer previousPeople;
+    TrackedPointBuffer tickPoints;  // people plus this tick's clicks
+    std::vector<ClickInput> tickClicks;
+
+    std::vector<GameOutput> outputs;
+};
@@ -0,0 +1,249 @@
+#include "HomographyCalibration.h"
+
+#include <cmath>
+
+namespace {
+
+const double holdSeconds = 1.5;
+const float holdRadius = 6;       // sensor pixels the blob may wander while held
+const float minSeparation = 20;   // sensor pixels between two captured targets
+
+// moves the points' centroid to the origin and scales their mean distance to
+// sqrt(2), keeps the least squares system well conditioned
+glm::mat3 normalization(const std::vector<glm::vec2>& points)
+{
+    double cx = 0;
+    double cy = 0;
+    for (const glm::vec2& point : points)
+    {
+        cx += point.x;
+        cy += point.y;
+    }
+    cx /= points.size();
+    cy /= points.size();
+    double distance = 0;
+    for (const glm::vec2& point : points)
+    {
+        distance += std::sqrt((point.x - cx) * (point.x - cx) + (point.y - cy) * (point.y - cy));
+    }
+    distance /= points.size();
+    float scale = distance > 0 ? (float)(std::sqrt(2.0) / distance) : 1.0f;
+
+    // glm matrices are column major
+    glm::mat3 matrix(1.0);
+    matrix[0] = glm::vec3(scale, 0, 0);
+    matrix[1] = glm::vec3(0, scale, 0);
+    matrix[2] = glm::vec3((float)(-cx * scale), (float)(-cy * scale), 1);
+    return matrix;
+}
+
+// gaussian elimination with partial pivoting, false if singular
+bool solveLinear(double a[8][8], double b[8], double x[8])
+{
+    for (int column = 0; column < 8; column++)
+    {
+        int pivot = column;
+        for (int row = column + 1; row < 8; row++)
+        {
+            if (std::abs(a[row][column]) > std::abs(a[pivot][column]))
+            {
+                pivot = row;
+            }
+        }
+        if (std::abs(a[pivot][column]) < 1e-12)
+        {
+            return false;
+        }
+        if (pivot != column)
+        {
+            std::swap(a[pivot], a[column]);
+            std::swap(b[pivot], b[column]);
+        }
+        for (int row = column + 1; row < 8; row++)
+        {
+            double factor = a[row][column] / a[column][column];
+            for (int k = column; k < 8; k++)
+            {
+                a[row][k] -= factor * a[column][k];
+            }
+            b[row] -= factor * b[column];
+        }
+    }
+    for (int row = 7; row >= 0; row--)
+    {
+        double sum = b[row];
+        for (int k = row + 1; k < 8; k++)
+        {
+            sum -= a[row][k] * x[k];
+        }
+        x[row] = sum / a[row][row];
+    }
+    return true;
+}
+
+} // namespace
+
+bool findHomography(const std::vector<glm::vec2>& from, const std::vector<glm::vec2>& to, glm::mat3& homography)
+{
+    if (from.size() < 4 || from.size() != to.size())
+    {
+        return false;
+    }
+
+    glm::mat3 fromNormalization = normalization(from);
+    glm::mat3 toNormalization = normalization(to);
+
+    // with h33 = 1 every pair gives two linear equations in the other eight
+    // entries, solved in the least squares sense through the normal equations
+    double ata[8][8] = {};
+    double atb[8] = {};
+    for (size_t i = 0; i < from.size(); i++)
+    {
+        glm::vec3 p = fromNormalization * glm::vec3(from[i].x, from[i].y, 1);
+        glm::vec3 q = toNormalization * glm::vec3(to[i].x, to[i].y, 1);
+        double rows[2][8] = {
+            { p.x, p.y, 1, 0, 0, 0, -q.x * p.x, -q.x * p.y },
+            { 0, 0, 0, p.x, p.y, 1, -q.y * p.x, -q.y * p.y }
+        };
+        double rhs[2] = { q.x, q.y };
+        for (int r = 0; r < 2; r++)
+        {
+            for (int j = 0; j < 8; j++)
+            {
+                for (int k = 0; k < 8; k++)
+                {
+                    ata[j][k] += rows[r][j] * rows[r][k];
+                }
+                atb[j] += rows[r][j] * rhs[r];
+            }
+        }
+    }
+
+    double h[8];
+    if (!solveLinear(ata, atb, h))
+    {
+        return false;
+    }
+
+    glm::mat3 normalized;
+    normalized[0] = glm::vec3((float)h[0], (float)h[3], (float)h[6]);
+    normalized[1] = glm::vec3((float)h[1], (float)h[4], (float)h[7]);
+    normalized[2] = glm::vec3((float)h[2], (float)h[5], 1);
+    homography = glm::inverse(toNormalization) * normalized * fromNormalization;
+    if (std::abs(homography[2][2]) < 1e-9f)
+    {
+        return false;
+    }
+    float scale = 1 / homography[2][2];
+    homography[0] = homography[0] * scale;
+    homography[1] = homography[1] * scale;
+    homography[2] = homography[2] * scale;
+    return true;
+}
+
+//--------------------------------------------------------------
+void HomographyCalibration::start(const std::vector<glm::vec2>& floorTargets)
+{
+    targets = floorTargets;
+    captured.clear();
+    active = true;
+    holding = false;
+}
+
+void HomographyCalibration::cancel()
+{
+    active = false;
+    holding = false;
+}
+
+void HomographyCalibration::addFrame(const std::vector<glm::vec2>& centroids, double time)
+{
+    lastTime = time;
+    if (!active || isComplete())
+    {
+        return;
+    }
+    if (centroids.size() != 1)
+    {
+        holding = false;
+        return;
+    }
+
+    // still standing on the target that was just captured
+    glm::vec2 position = centroids[0];
+    if (!captured.empty())
+    {
+        glm::vec2 offset = position - captured.back();
+        if (offset.x * offset.x + offset.y * offset.y < minSeparation * minSeparation)
+        {
+            holding = false;
+            return;
+        }
+    }
+
+    if (holding)
+    {
+        glm::vec2 offset = position - holdSum * (1.0f / holdFrames);
+        if (offset.x * offset.x + offset.y * offset.y > holdRadius * holdRadius)
+        {
+            holding = false;
+        }
+    }
+    if (!holding)
+    {
+        holding = true;
+        holdStart = time;
+        holdSum = glm::vec2(0, 0);
+        holdFrames = 0;
+    }
+    holdSum = holdSum + position;
+    holdFrames++;
+
+    if (time - holdStart >= holdSeconds)
+    {
+        captured.push_back(holdSum * (1.0f / holdFrames));
+        holding = false;
+        ofLogNotice("HomographyCalibration") << "target " << captured.size() << " of " << targets.size() << " captured";
+    }
+}
+
+bool HomographyCalibration::isActive() const
+{
+    return active;
+}
+
+bool HomographyCalibration::isComplete() const
+{
+    return active && captured.size() == targets.size();
+}
+
+int HomographyCalibration::getCurrentTarget() const
+{
+    return (int)captured.size();
+}
+
+const std::vector<glm::vec2>& HomographyCalibration::getTargets() const
+{
+    return targets;
+}
+
+float HomographyCalibration::getHoldProgress() const
+{
+    return holding ? (float)std::min((lastTime - holdStart) / holdSeconds, 1.0) : 0.0f;
+}
+
+bool HomographyCalibration::solve(glm::mat3& homography, float& rmsError) const
+{
+    if (!isComplete() || !findHomography(captured, targets, homography))
+    {
+        return false;
+    }
+    double sum = 0;
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        glm::vec2 offset = applyHomography(homography, captured[i]) - targets[i];
+        sum += offset.x * offset.x + offset.y * offset.y;
+    }
+    rmsError = (float)std::sqrt(sum / targets.size());
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <vector>
+
+// Least squares homography taking every from[i] to to[i], at least 4 pairs
+// and no three of them on a line. Returns false if the points don't fix one.
+bool findHomography(const std::vector<glm::vec2>& from, const std::vector<glm::vec2>& to, glm::mat3& homography);
+
+// one 3x3 multiply and a divide
+inline glm::vec2 applyHomography(const glm::mat3& homography, glm::vec2 point)
+{
+    glm::vec3 mapped = homography * glm::vec3(point.x, point.y, 1);
+    return glm::vec2(mapped.x / mapped.z, mapped.y / mapped.z);
+}
+
+// Collects sensor positions for targets projected onto the floor. Someone
+// stands on the highlighted target until their blob has held still for a
+// moment, then the next target lights up. Once all are captured solve()
+// fits the sensor to floor homography.
+class HomographyCalibration {
+public:
+    void start(const std::vector<glm::vec2>& floorTargets);
+    void cancel();
+
+    // blob centroids of the sensor being calibrated, in sensor pixels.
+    // only frames with exactly one blob count
+    void addFrame(const std::vector<glm::vec2>& centroids, double time);
+
+    bool isActive() const;
+    bool isComplete() const;
+    int getCurrentTarget() const;
+    const std::vector<glm::vec2>& getTargets() const;
+    float getHoldProgress() const; // 0..1 for the current target
+
+    // homography and its rms reprojection error in floor pixels
+    bool solve(glm::mat3& homography, float& rmsError) const;
+
+private:
+    std::vector<glm::vec2> targets;
+    std::vector<glm::vec2> captured; // sensor position per captured target
+
+    bool active = false;
+    bool holding = false;
+    double holdStart = 0;
+    double lastTime = 0;
+    glm::vec2 holdSum;
+    int holdFrames = 0;
+};
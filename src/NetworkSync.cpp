@@ -0,0 +1,288 @@
+#include "NetworkSync.h"
+
+#include "osc/OscOutboundPacketStream.h"
+#include "ip/UdpSocket.h"
+
+#include <cstring>
+
+namespace {
+
+const char* frameAddress = "/crazybubbles/frame";
+const int numHeaderArgs = 12;
+const size_t bubbleRecordSize = 24; // x y radius, expected current, rgba
+const size_t peopleRecordSize = 16; // x y area id
+const size_t headerSize = 256;      // bundle, address, type tags and the int arguments
+
+// the blobs are big endian like the rest of OSC
+void putU32(uint8_t*& out, uint32_t value)
+{
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+    out += 4;
+}
+
+void putFloat(uint8_t*& out, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    putU32(out, bits);
+}
+
+uint32_t getU32(const uint8_t*& in)
+{
+    uint32_t value = ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+    in += 4;
+    return value;
+}
+
+float getFloat(const uint8_t*& in)
+{
+    uint32_t bits = getU32(in);
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+} // namespace
+
+// the socket type is only complete in here
+NetworkPublisher::NetworkPublisher() = default;
+
+NetworkPublisher::~NetworkPublisher()
+{
+    close();
+}
+
+bool NetworkPublisher::setup(const std::string& host, int port)
+{
+    close();
+    try
+    {
+        socket.reset(new UdpTransmitSocket(IpEndpointName(host.c_str(), port)));
+    }
+    catch (const std::exception& e)
+    {
+        ofLogError("NetworkPublisher") << "can't send to " << host << ":" << port << ": " << e.what();
+        return false;
+    }
+
+    // a restarted sensing box is told apart from a late packet of the old one
+    session = (uint32_t)ofRandom(1, 4294967295.0);
+    sequence = 0;
+    bubbleBlob.resize(BubbleStore::capacity * bubbleRecordSize);
+    peopleBlob.resize(TrackedPointBuffer::capacity * peopleRecordSize);
+    packet.resize(headerSize + bubbleBlob.size() + peopleBlob.size());
+    ofLogNotice("NetworkPublisher") << "publishing to " << host << ":" << port;
+    return true;
+}
+
+void NetworkPublisher::close()
+{
+    socket.reset();
+}
+
+bool NetworkPublisher::isOpen() const
+{
+    return socket != nullptr;
+}
+
+void NetworkPublisher::publish(NetworkFrame& frame)
+{
+    if (!socket)
+    {
+        return;
+    }
+    frame.session = session;
+    frame.sequence = ++sequence;
+
+    const BubbleStore& bubbles = frame.game.bubbles;
+    uint8_t* out = bubbleBlob.data();
+    for (int i = 0; i < bubbles.size(); i++)
+    {
+        const ofColor& color = frame.bubbleColors[i];
+        putFloat(out, bubbles.getX(i));
+        putFloat(out, bubbles.getY(i));
+        putFloat(out, bubbles.getRadius(i));
+        putU32(out, (uint32_t)bubbles.getExpectedAmount(i));
+        putU32(out, (uint32_t)bubbles.getCurrentAmount(i));
+        putU32(out, ((uint32_t)color.r << 24) | ((uint32_t)color.g << 16) | ((uint32_t)color.b << 8) | color.a);
+    }
+    size_t bubbleBytes = out - bubbleBlob.data();
+
+    out = peopleBlob.data();
+    TrackedPointSpan people = frame.people.getSpan();
+    for (int i = 0; i < people.size(); i++)
+    {
+        putFloat(out, people.x[i]);
+        putFloat(out, people.y[i]);
+        putFloat(out, people.area[i]);
+        putU32(out, people.id[i]);
+    }
+    size_t peopleBytes = out - peopleBlob.data();
+
+    // the stream writes straight into the packet buffer
+    const GameSnapshot& game = frame.game;
+    try
+    {
+        osc::OutboundPacketStream stream(packet.data(), packet.size());
+        stream << osc::BeginBundleImmediate << osc::BeginMessage(frameAddress)
+            << (osc::int32)frame.session << (osc::int64)frame.sequence << (osc::int64)frame.timestampMicros
+            << (osc::int32)game.state << (osc::int32)game.score << (osc::int32)game.round << (osc::int32)game.roundAmount
+            << (osc::int32)game.amountOfPlayers << (osc::int32)game.remainingSeconds << (osc::int32)game.lastRoundWon
+            << (osc::int32)game.layout << (osc::int32)frame.highscore
+            << osc::Blob(bubbleBlob.data(), (osc::osc_bundle_element_size_t)bubbleBytes)
+            << osc::Blob(peopleBlob.data(), (osc::osc_bundle_element_size_t)peopleBytes)
+            << osc::EndMessage << osc::EndBundle;
+        socket->Send(stream.Data(), stream.Size());
+        lastPacketSize = stream.Size();
+    }
+    catch (const std::exception& e)
+    {
+        ofLogError("NetworkPublisher") << "frame " << frame.sequence << " not sent: " << e.what();
+    }
+}
+
+uint64_t NetworkPublisher::getSequence() const
+{
+    return sequence;
+}
+
+size_t NetworkPublisher::getLastPacketSize() const
+{
+    return lastPacketSize;
+}
+
+//--------------------------------------------------------------
+bool NetworkReceiver::setup(int port)
+{
+    if (!receiver.setup(port))
+    {
+        ofLogError("NetworkReceiver") << "can't listen on port " << port;
+        return false;
+    }
+    received = false;
+    lostFrames = 0;
+    staleFrames = 0;
+    ofLogNotice("NetworkReceiver") << "listening on port " << port;
+    return true;
+}
+
+void NetworkReceiver::close()
+{
+    receiver.stop();
+}
+
+bool NetworkReceiver::update()
+{
+    // latest wins: everything waiting is looked at, only the newest frame is kept
+    bool changed = false;
+    while (receiver.hasWaitingMessages())
+    {
+        receiver.getNextMessage(message);
+        if (message.getAddress() != frameAddress || !decode(message, incoming))
+        {
+            continue;
+        }
+        if (received && incoming.session == frame.session && incoming.sequence <= frame.sequence)
+        {
+            staleFrames++;
+            continue;
+        }
+        if (received && incoming.session == frame.session)
+        {
+            lostFrames += incoming.sequence - frame.sequence - 1;
+        }
+        else if (received)
+        {
+            ofLogNotice("NetworkReceiver") << "new publisher session";
+        }
+        std::swap(frame, incoming);
+        received = true;
+        changed = true;
+    }
+    return changed;
+}
+
+bool NetworkReceiver::decode(const ofxOscMessage& message, NetworkFrame& out) const
+{
+    if (message.getNumArgs() != numHeaderArgs + 2)
+    {
+        return false;
+    }
+    out.session = (uint32_t)message.getArgAsInt32(0);
+    out.sequence = (uint64_t)message.getArgAsInt64(1);
+    out.timestampMicros = (uint64_t)message.getArgAsInt64(2);
+    int state = message.getArgAsInt32(3);
+    if (state < mainMenu || state > cooldown)
+    {
+        return false;
+    }
+    GameSnapshot& game = out.game;
+    game.state = (gameStateEnum)state;
+    game.score = message.getArgAsInt32(4);
+    game.round = message.getArgAsInt32(5);
+    game.roundAmount = message.getArgAsInt32(6);
+    game.amountOfPlayers = message.getArgAsInt32(7);
+    game.remainingSeconds = message.getArgAsInt32(8);
+    game.lastRoundWon = message.getArgAsInt32(9) != 0;
+    game.layout = (uint32_t)message.getArgAsInt32(10);
+    out.highscore = message.getArgAsInt32(11);
+
+    ofBuffer bubbleBlob = message.getArgAsBlob(numHeaderArgs);
+    ofBuffer peopleBlob = message.getArgAsBlob(numHeaderArgs + 1);
+    if (bubbleBlob.size() % bubbleRecordSize != 0 || peopleBlob.size() % peopleRecordSize != 0)
+    {
+        return false;
+    }
+
+    game.bubbles.reset();
+    const uint8_t* in = (const uint8_t*)bubbleBlob.getData();
+    int numBubbles = std::min((int)(bubbleBlob.size() / bubbleRecordSize), (int)BubbleStore::capacity);
+    for (int i = 0; i < numBubbles; i++)
+    {
+        float x = getFloat(in);
+        float y = getFloat(in);
+        float radius = getFloat(in);
+        int expected = (int)getU32(in);
+        int current = (int)getU32(in);
+        uint32_t color = getU32(in);
+        game.bubbles.add(x, y, radius, expected);
+        game.bubbles.getCounts()[i] = current;
+        out.bubbleColors[i].set(color >> 24, (color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff);
+    }
+
+    out.people.clear();
+    in = (const uint8_t*)peopleBlob.getData();
+    int numPeople = (int)(peopleBlob.size() / peopleRecordSize);
+    for (int i = 0; i < numPeople; i++)
+    {
+        float x = getFloat(in);
+        float y = getFloat(in);
+        float area = getFloat(in);
+        uint32_t id = getU32(in);
+        out.people.push(x, y, area, id);
+    }
+    return true;
+}
+
+const NetworkFrame& NetworkReceiver::getFrame() const
+{
+    return frame;
+}
+
+bool NetworkReceiver::hasFrame() const
+{
+    return received;
+}
+
+uint64_t NetworkReceiver::getLostFrames() const
+{
+    return lostFrames;
+}
+
+uint64_t NetworkReceiver::getStaleFrames() const
+{
+    return staleFrames;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "GameSimulation.h"
+#include "TrackedPoints.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+class UdpTransmitSocket;
+
+// everything a render node needs to draw one frame of the sensing box
+struct NetworkFrame {
+    uint32_t session = 0;         // picked at random when the publisher starts
+    uint64_t sequence = 0;        // one per published frame
+    uint64_t timestampMicros = 0; // capture time of the newest depth frame on the sensing box
+    GameSnapshot game;
+    int highscore = -1;           // shown on the end screen, -1 if the score beat it
+    std::array<ofColor, BubbleStore::capacity> bubbleColors;
+    TrackedPointBuffer people;    // projector coordinates
+};
+
+// Sends one OSC bundle per vision frame to a render node (or a broadcast
+// address). The bundle holds a single message, people and bubbles are packed
+// into two blobs, so the whole frame is one datagram and arrives complete or
+// not at all. Packing writes into buffers allocated in setup().
+class NetworkPublisher {
+public:
+    NetworkPublisher();
+    ~NetworkPublisher();
+
+    bool setup(const std::string& host, int port);
+    void close();
+    bool isOpen() const;
+
+    // sequence and session are filled in here
+    void publish(NetworkFrame& frame);
+
+    uint64_t getSequence() const;
+    size_t getLastPacketSize() const;
+
+private:
+    std::unique_ptr<UdpTransmitSocket> socket;
+    uint32_t session = 0;
+    uint64_t sequence = 0;
+    std::vector<char> packet;
+    std::vector<uint8_t> bubbleBlob;
+    std::vector<uint8_t> peopleBlob;
+    size_t lastPacketSize = 0;
+};
+
+// Receives what a NetworkPublisher sends. Frames that arrive late or twice
+// are dropped, of all frames that arrived since the last update() only the
+// newest is kept. A new publisher session (the sensing box restarted) starts over.
+class NetworkReceiver {
+public:
+    bool setup(int port);
+    void close();
+
+    // returns true if a newer frame than the last one arrived
+    bool update();
+    const NetworkFrame& getFrame() const;
+    bool hasFrame() const;
+
+    uint64_t getLostFrames() const;  // sequence numbers skipped, a frame that comes late counts here and as stale
+    uint64_t getStaleFrames() const; // arrived after a newer one or twice, dropped
+
+private:
+    bool decode(const ofxOscMessage& message, NetworkFrame& frame) const;
+
+    ofxOscReceiver receiver;
+    ofxOscMessage message;
+    NetworkFrame frame;
+    NetworkFrame incoming;
+    bool received = false;
+    uint64_t lostFrames = 0;
+    uint64_t staleFrames = 0;
+};
@@ -0,0 +1,201 @@
+#include "PersonTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+void PersonTracker::AxisFilter::reset(float position_, float positionVariance, float velocityVariance)
+{
+    position = position_;
+    velocity = 0;
+    p00 = positionVariance;
+    p01 = 0;
+    p11 = velocityVariance;
+}
+
+void PersonTracker::AxisFilter::predict(float dt, float accelerationVariance)
+{
+    // x = F x, P = F P F^T + Q with F = [1 dt; 0 1] and white noise acceleration Q
+    position += velocity * dt;
+    float dt2 = dt * dt;
+    float newP00 = p00 + 2 * dt * p01 + dt2 * p11 + accelerationVariance * dt2 * dt2 * 0.25f;
+    float newP01 = p01 + dt * p11 + accelerationVariance * dt2 * dt * 0.5f;
+    float newP11 = p11 + accelerationVariance * dt2;
+    p00 = newP00;
+    p01 = newP01;
+    p11 = newP11;
+}
+
+void PersonTracker::AxisFilter::correct(float measurement, float measurementVariance)
+{
+    float s = p00 + measurementVariance;
+    float k0 = p00 / s;
+    float k1 = p01 / s;
+    float residual = measurement - position;
+    position += k0 * residual;
+    velocity += k1 * residual;
+    float newP00 = (1 - k0) * p00;
+    float newP01 = (1 - k0) * p01;
+    float newP11 = p11 - k1 * p01;
+    p00 = newP00;
+    p01 = newP01;
+    p11 = newP11;
+}
+
+void PersonTracker::setup(const TrackerSettings& settings_)
+{
+    settings = settings_;
+    clear();
+    tracks.reserve(TrackedPointBuffer::capacity);
+    candidates.reserve(TrackedPointBuffer::capacity * 4);
+}
+
+void PersonTracker::clear()
+{
+    tracks.clear();
+}
+
+int PersonTracker::getNumTracks() const
+{
+    return (int)tracks.size();
+}
+
+const TrackerSettings& PersonTracker::getSettings() const
+{
+    return settings;
+}
+
+void PersonTracker::mergeSplitDetections(TrackedPointSpan detections)
+{
+    // a person whose depth blob broke apart shows up as several close contours,
+    // fold them into one area weighted centroid
+    merged.clear();
+    float mergeSquared = settings.mergeDistance * settings.mergeDistance;
+    for (int i = 0; i < detections.size(); i++)
+    {
+        TrackedPoint detection = detections[i];
+        float area = std::max(detection.area, 1.0f);
+        bool absorbed = false;
+        for (int j = 0; j < merged.size(); j++)
+        {
+            TrackedPoint existing = merged[j];
+            float dx = detection.x - existing.x;
+            float dy = detection.y - existing.y;
+            if (dx * dx + dy * dy < mergeSquared)
+            {
+                float existingArea = std::max(existing.area, 1.0f);
+                float total = existingArea + area;
+                merged.set(j, (existing.x * existingArea + detection.x * area) / total, (existing.y * existingArea + detection.y * area) / total, existing.area + detection.area, existing.id);
+                absorbed = true;
+                break;
+            }
+        }
+        if (!absorbed)
+        {
+            merged.push(detection.x, detection.y, detection.area, detection.id);
+        }
+    }
+}
+
+void PersonTracker::update(TrackedPointSpan detections, double time)
+{
+    mergeSplitDetections(detections);
+
+    float accelerationVariance = settings.accelerationNoise * settings.accelerationNoise;
+    float measurementVariance = settings.measurementNoise * settings.measurementNoise;
+
+    // bring every track to the time of this frame
+    for (Track& track : tracks)
+    {
+        float dt = (float)std::max(time - track.lastUpdate, 0.0);
+        track.x.predict(dt, accelerationVariance);
+        track.y.predict(dt, accelerationVariance);
+        track.lastUpdate = time;
+    }
+
+    // greedy nearest neighbour association inside the gate
+    float gateSquared = settings.gateDistance * settings.gateDistance;
+    candidates.clear();
+    for (int t = 0; t < (int)tracks.size(); t++)
+    {
+        for (int d = 0; d < merged.size(); d++)
+        {
+            float dx = merged[d].x - tracks[t].x.position;
+            float dy = merged[d].y - tracks[t].y.position;
+            float distanceSquared = dx * dx + dy * dy;
+            if (distanceSquared < gateSquared)
+            {
+                candidates.push_back({ distanceSquared, t, d });
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.distanceSquared < b.distanceSquared;
+    });
+
+    trackMatch.assign(tracks.size(), -1);
+    detectionMatch.assign(merged.size(), -1);
+    for (const Candidate& candidate : candidates)
+    {
+        if (trackMatch[candidate.track] < 0 && detectionMatch[candidate.detection] < 0)
+        {
+            trackMatch[candidate.track] = candidate.detection;
+            detectionMatch[candidate.detection] = candidate.track;
+        }
+    }
+
+    for (int t = 0; t < (int)tracks.size(); t++)
+    {
+        int d = trackMatch[t];
+        if (d < 0)
+        {
+            continue;
+        }
+        Track& track = tracks[t];
+        track.x.correct(merged[d].x, measurementVariance);
+        track.y.correct(merged[d].y, measurementVariance);
+        track.area = merged[d].area;
+        track.hits++;
+        track.lastSeen = time;
+    }
+
+    // drop tracks that coasted for too long, swap-remove keeps this allocation free
+    for (int t = (int)tracks.size() - 1; t >= 0; t--)
+    {
+        if (time - tracks[t].lastSeen > settings.maxCoastSeconds)
+        {
+            tracks[t] = tracks.back();
+            tracks.pop_back();
+        }
+    }
+
+    // everything left over starts a new tentative track
+    for (int d = 0; d < merged.size(); d++)
+    {
+        if (detectionMatch[d] >= 0 || (int)tracks.size() >= TrackedPointBuffer::capacity)
+        {
+            continue;
+        }
+        Track track;
+        track.id = nextId++;
+        track.x.reset(merged[d].x, measurementVariance, accelerationVariance);
+        track.y.reset(merged[d].y, measurementVariance, accelerationVariance);
+        track.area = merged[d].area;
+        track.lastUpdate = time;
+        track.lastSeen = time;
+        track.hits = 1;
+        tracks.push_back(track);
+    }
+}
+
+void PersonTracker::predict(double time, TrackedPointBuffer& points) const
+{
+    for (const Track& track : tracks)
+    {
+        if (track.hits < settings.minHits)
+        {
+            continue;
+        }
+        float dt = (float)std::min(std::max(time - track.lastUpdate, 0.0), settings.maxPredictionSeconds);
+        points.push(track.x.position + track.x.velocity * dt, track.y.position + track.y.velocity * dt, track.area, track.id);
+    }
+}
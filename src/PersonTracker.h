@@ -0,0 +1,74 @@
+#pragma once
+
+#include "TrackedPoints.h"
+
+#include <cstdint>
+#include <vector>
+
+struct TrackerSettings {
+    float gateDistance = 250;       // px, detections further away never match a track
+    float mergeDistance = 100;      // px, closer detections are one person split into several contours
+    int minHits = 3;                // detections before a track counts as a person
+    double maxCoastSeconds = 0.5;   // how long a track survives without detections
+    double maxPredictionSeconds = 0.25; // never extrapolate further than this
+    float accelerationNoise = 1000; // px/s^2, how quickly people change direction
+    float measurementNoise = 15;    // px, centroid jitter of the depth camera
+};
+
+// Frame to frame association of detections with stable ids. Each track runs a
+// constant velocity Kalman filter per axis, so positions can be predicted
+// between (or in place of) vision frames.
+class PersonTracker {
+public:
+    void setup(const TrackerSettings& settings);
+    void clear();
+
+    // feed the detections of one vision frame, time in seconds
+    void update(TrackedPointSpan detections, double time);
+
+    // writes the confirmed tracks, extrapolated to time, into points
+    void predict(double time, TrackedPointBuffer& points) const;
+
+    int getNumTracks() const;
+    const TrackerSettings& getSettings() const;
+
+private:
+    // constant velocity Kalman filter for one axis
+    struct AxisFilter {
+        float position = 0;
+        float velocity = 0;
+        float p00 = 0, p01 = 0, p11 = 0; // symmetric covariance
+
+        void reset(float position, float positionVariance, float velocityVariance);
+        void predict(float dt, float accelerationVariance);
+        void correct(float measurement, float measurementVariance);
+    };
+
+    struct Track {
+        uint32_t id;
+        AxisFilter x;
+        AxisFilter y;
+        float area;
+        double lastUpdate; // time the filter state refers to
+        double lastSeen;   // time of the last matched detection
+        int hits;
+    };
+
+    struct Candidate {
+        float distanceSquared;
+        int track;
+        int detection;
+    };
+
+    void mergeSplitDetections(TrackedPointSpan detections);
+
+    TrackerSettings settings;
+    std::vector<Track> tracks;
+    uint32_t nextId = 1;
+
+    // scratch buffers reused every frame
+    TrackedPointBuffer merged;
+    std::vector<Candidate> candidates;
+    std::vector<int> trackMatch;
+    std::vector<int> detectionMatch;
+};
@@ -0,0 +1,127 @@
+#include "PipelineStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+void PipelineStats::setup(const std::vector<std::string>& stageNames, int maxFrames_)
+{
+    names = stageNames;
+    maxFrames = maxFrames_;
+    samples.assign(names.size(), std::vector<double>());
+    for (std::vector<double>& stage : samples)
+    {
+        stage.reserve(maxFrames);
+    }
+    allocations.reserve(maxFrames);
+    clear();
+}
+
+void PipelineStats::clear()
+{
+    for (std::vector<double>& stage : samples)
+    {
+        stage.clear();
+    }
+    allocations.clear();
+}
+
+void PipelineStats::addSample(int stage, double micros)
+{
+    // the capacity is never exceeded, so recording never allocates
+    if (samples[stage].size() < samples[stage].capacity())
+    {
+        samples[stage].push_back(micros);
+    }
+}
+
+void PipelineStats::endFrame(uint64_t frameAllocations)
+{
+    if (allocations.size() < allocations.capacity())
+    {
+        allocations.push_back((double)frameAllocations);
+    }
+}
+
+int PipelineStats::getNumFrames() const
+{
+    return (int)allocations.size();
+}
+
+bool PipelineStats::isFull() const
+{
+    return getNumFrames() >= maxFrames;
+}
+
+PipelineStats::Summary PipelineStats::getSummary(int stage) const
+{
+    return summarize(samples[stage]);
+}
+
+PipelineStats::Summary PipelineStats::getAllocationSummary() const
+{
+    return summarize(allocations);
+}
+
+PipelineStats::Summary PipelineStats::summarize(std::vector<double> values)
+{
+    Summary summary;
+    summary.count = (int)values.size();
+    if (values.empty())
+    {
+        return summary;
+    }
+
+    std::sort(values.begin(), values.end());
+    double total = 0;
+    for (double value : values)
+    {
+        total += value;
+    }
+    // nearest rank
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)std::ceil(p / 100.0 * values.size());
+        return values[std::min(std::max(rank, (size_t)1), values.size()) - 1];
+    };
+    summary.mean = total / values.size();
+    summary.p50 = percentile(50);
+    summary.p95 = percentile(95);
+    summary.p99 = percentile(99);
+    summary.max = values.back();
+    return summary;
+}
+
+ofJson PipelineStats::toJson(const Summary& summary)
+{
+    ofJson json;
+    json["count"] = summary.count;
+    json["mean"] = summary.mean;
+    json["p50"] = summary.p50;
+    json["p95"] = summary.p95;
+    json["p99"] = summary.p99;
+    json["max"] = summary.max;
+    return json;
+}
+
+ofJson PipelineStats::toJson() const
+{
+    ofJson json;
+    json["frames"] = getNumFrames();
+    for (int i = 0; i < (int)names.size(); i++)
+    {
+        json["stages"][names[i]] = toJson(getSummary(i));
+    }
+    json["allocationsPerFrame"] = toJson(getAllocationSummary());
+    return json;
+}
+
+void PipelineStats::log(const std::string& name) const
+{
+    for (int i = 0; i < (int)names.size(); i++)
+    {
+        Summary summary = getSummary(i);
+        ofLogNotice("Benchmark") << name << " " << names[i] << ": p50 " << summary.p50 << " us, p95 " << summary.p95
+            << " us, p99 " << summary.p99 << " us, max " << summary.max << " us (" << summary.count << " samples)";
+    }
+    Summary summary = getAllocationSummary();
+    ofLogNotice("Benchmark") << name << " allocations per frame: p50 " << summary.p50 << ", p99 " << summary.p99 << ", max " << summary.max;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <string>
+#include <vector>
+
+// Latency samples per pipeline stage for benchmarks. Samples go into memory
+// reserved up front, percentiles are only computed when the report is made.
+class PipelineStats {
+public:
+    struct Summary {
+        int count = 0;
+        double mean = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    // stages are addressed by their index in stageNames
+    void setup(const std::vector<std::string>& stageNames, int maxFrames);
+    void clear();
+
+    void addSample(int stage, double micros);
+    void endFrame(uint64_t allocations); // allocations made during the frame
+    int getNumFrames() const;
+    bool isFull() const;
+
+    Summary getSummary(int stage) const;
+    Summary getAllocationSummary() const;
+
+    // {"frames": n, "stages": {name: summary}, "allocationsPerFrame": summary}, times in micros
+    ofJson toJson() const;
+    void log(const std::string& name) const;
+
+private:
+    static Summary summarize(std::vector<double> samples);
+    static ofJson toJson(const Summary& summary);
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> samples;
+    std::vector<double> allocations;
+    int maxFrames = 0;
+};
@@ -0,0 +1,208 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// single producer ring, the owning thread writes, any thread may read.
+// fields are relaxed atomics so a reader racing the writer sees a torn
+// event at worst, which it detects from head and drops
+struct ThreadRing {
+    static const uint64_t capacity = 8192; // power of two
+    struct Slot {
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<uint64_t> startMicros{ 0 };
+        std::atomic<uint64_t> endMicros{ 0 };
+    };
+
+    std::array<Slot, capacity> slots;
+    std::atomic<uint64_t> head{ 0 };
+    std::string name;
+    int thread = 0;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadRing>> registry; // rings live until exit, threads may outlive their use
+const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+
+ThreadRing& getThreadRing()
+{
+    thread_local ThreadRing* ring = nullptr;
+    if (ring == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.emplace_back(new ThreadRing());
+        ring = registry.back().get();
+        ring->thread = (int)registry.size();
+        ring->name = "thread " + std::to_string(ring->thread);
+    }
+    return *ring;
+}
+
+void collectRing(const ThreadRing& ring, uint64_t sinceMicros, std::vector<ProfileEvent>& events)
+{
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t first = head > ThreadRing::capacity ? head - ThreadRing::capacity : 0;
+    size_t firstCopied = events.size();
+    for (uint64_t i = first; i < head; i++)
+    {
+        const ThreadRing::Slot& slot = ring.slots[i & (ThreadRing::capacity - 1)];
+        ProfileEvent event;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.startMicros = slot.startMicros.load(std::memory_order_relaxed);
+        event.endMicros = slot.endMicros.load(std::memory_order_relaxed);
+        event.thread = ring.thread;
+        events.push_back(event);
+    }
+
+    // slots the writer reached while we were copying may be torn,
+    // including the one it is writing right now
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t headAfter = ring.head.load(std::memory_order_relaxed) + 1;
+    uint64_t overwritten = headAfter > ThreadRing::capacity ? headAfter - ThreadRing::capacity : 0;
+    size_t keepFrom = firstCopied + (size_t)(overwritten > first ? std::min(overwritten - first, head - first) : 0);
+
+    size_t out = firstCopied;
+    for (size_t i = keepFrom; i < events.size(); i++)
+    {
+        if (events[i].endMicros >= sinceMicros && events[i].name != nullptr)
+        {
+            events[out++] = events[i];
+        }
+    }
+    events.resize(out);
+}
+
+void writeEscaped(std::ofstream& file, const std::string& text)
+{
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            file << '\\';
+        }
+        file << c;
+    }
+}
+
+} // namespace
+
+uint64_t Profiler::now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+void Profiler::setThreadName(const char* name)
+{
+#if CRAZYBUBBLES_PROFILER
+    ThreadRing& ring = getThreadRing();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    ring.name = name;
+#endif
+}
+
+std::string Profiler::getThreadName(int thread)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (thread < 1 || thread > (int)registry.size())
+    {
+        return "";
+    }
+    return registry[thread - 1]->name;
+}
+
+void Profiler::record(const char* name, uint64_t startMicros, uint64_t endMicros)
+{
+    ThreadRing& ring = getThreadRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ThreadRing::Slot& slot = ring.slots[head & (ThreadRing::capacity - 1)];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startMicros.store(startMicros, std::memory_order_relaxed);
+    slot.endMicros.store(endMicros, std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::collect(uint64_t sinceMicros, std::vector<ProfileEvent>& events)
+{
+    events.clear();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::unique_ptr<ThreadRing>& ring : registry)
+    {
+        collectRing(*ring, sinceMicros, events);
+    }
+}
+
+void Profiler::summarize(uint64_t sinceMicros, std::vector<ProfileZone>& zones)
+{
+    std::vector<ProfileEvent> events;
+    collect(sinceMicros, events);
+
+    zones.clear();
+    for (const ProfileEvent& event : events)
+    {
+        // a handful of scopes, a linear search beats a map
+        ProfileZone* zone = nullptr;
+        for (ProfileZone& existing : zones)
+        {
+            if (existing.name == event.name && existing.thread == event.thread)
+            {
+                zone = &existing;
+                break;
+            }
+        }
+        if (zone == nullptr)
+        {
+            zones.push_back(ProfileZone());
+            zone = &zones.back();
+            zone->name = event.name;
+            zone->thread = event.thread;
+        }
+        double micros = (double)(event.endMicros - event.startMicros);
+        zone->count++;
+        zone->totalMicros += micros;
+        zone->maxMicros = std::max(zone->maxMicros, micros);
+    }
+}
+
+bool Profiler::exportChromeTrace(const std::string& path)
+{
+    std::vector<ProfileEvent> events;
+    collect(0, events);
+
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    int threads;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threads = (int)registry.size();
+    }
+    for (int thread = 1; thread <= threads; thread++)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":\"";
+        writeEscaped(file, getThreadName(thread));
+        file << "\"}}";
+        first = false;
+    }
+    for (const ProfileEvent& event : events)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"";
+        writeEscaped(file, event.name);
+        file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << event.startMicros << ",\"dur\":" << event.endMicros - event.startMicros << "}";
+        first = false;
+    }
+    file << "\n]}\n";
+    return file.good();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hot path instrumentation. PROFILE_SCOPE("name") times the rest of the
+// enclosing block into a ring buffer owned by the calling thread, no locks and
+// no allocations after the first event of a thread. Names must be string
+// literals, only the pointer is stored.
+//
+// Build with CRAZYBUBBLES_PROFILER=0 to compile every scope out.
+#ifndef CRAZYBUBBLES_PROFILER
+#define CRAZYBUBBLES_PROFILER 1
+#endif
+
+struct ProfileEvent {
+    const char* name = nullptr;
+    uint64_t startMicros = 0;
+    uint64_t endMicros = 0;
+    int thread = 0;
+};
+
+// time spent in one scope name over a window, see Profiler::summarize()
+struct ProfileZone {
+    const char* name = nullptr;
+    int thread = 0;
+    int count = 0;
+    double totalMicros = 0;
+    double maxMicros = 0;
+};
+
+class Profiler {
+public:
+    // micros on the profiler clock, shared by all threads
+    static uint64_t now();
+
+    // name shown for the calling thread in traces and the overlay
+    static void setThreadName(const char* name);
+    static std::string getThreadName(int thread);
+
+    // copy the events of all threads that ended at or after sinceMicros
+    static void collect(uint64_t sinceMicros, std::vector<ProfileEvent>& events);
+
+    // per scope totals of the events that ended at or after sinceMicros
+    static void summarize(uint64_t sinceMicros, std::vector<ProfileZone>& zones);
+
+    // everything still in the rings as Chrome trace events (chrome://tracing, ui.perfetto.dev)
+    static bool exportChromeTrace(const std::string& path);
+
+    static void record(const char* name, uint64_t startMicros, uint64_t endMicros);
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name_) : name(name_), startMicros(Profiler::now()) {}
+    ~ProfileScope() { Profiler::record(name, startMicros, Profiler::now()); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t startMicros;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if CRAZYBUBBLES_PROFILER
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
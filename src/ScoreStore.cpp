@@ -0,0 +1,521 @@
+#include "ScoreStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(ScoreRecord) == 32, "records are written as is");
+
+namespace {
+
+const char snapshotMagic[4] = { 'C', 'B', 'S', 'S' };
+const uint32_t snapshotVersion = 1;
+const uint64_t syncIntervalMillis = 500; // records arriving within this share one fsync
+const uint64_t compactAfterRecords = 256;
+const uint32_t maxBuckets = 4096;
+
+uint32_t checksum(const void* data, size_t size)
+{
+    // FNV-1a
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t recordChecksum(const ScoreRecord& record)
+{
+    return checksum(&record, offsetof(ScoreRecord, checksum));
+}
+
+template<typename T>
+void put(std::vector<unsigned char>& out, T value)
+{
+    const unsigned char* bytes = (const unsigned char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+bool get(const unsigned char* data, size_t size, size_t& pos, T& value)
+{
+    if (size - pos < sizeof(T))
+    {
+        return false;
+    }
+    std::memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+void syncFile(FILE* file)
+{
+    fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+// atomically replaces to with from
+bool replaceFile(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+} // namespace
+
+//--------------------------------------------------------------
+void ScoreTable::setup(int topCount_)
+{
+    topCount = std::max(topCount_, 1);
+    categories.clear();
+}
+
+uint32_t ScoreTable::key(int players, int rounds)
+{
+    return ((uint32_t)(uint16_t)players << 16) | (uint16_t)rounds;
+}
+
+void ScoreTable::add(int players, int rounds, int score)
+{
+    Category& category = categories[key(players, rounds)];
+    category.max = category.count == 0 ? score : std::max(category.max, score);
+    category.count++;
+
+    auto position = std::upper_bound(category.top.begin(), category.top.end(), score, std::greater<int32_t>());
+    if (position - category.top.begin() < topCount)
+    {
+        category.top.insert(position, score);
+        if ((int)category.top.size() > topCount)
+        {
+            category.top.pop_back();
+        }
+    }
+
+    uint32_t bucket = std::min((uint32_t)std::max(score, 0) / bucketWidth, maxBuckets - 1);
+    if (category.histogram.size() <= bucket)
+    {
+        category.histogram.resize(bucket + 1, 0);
+    }
+    category.histogram[bucket]++;
+}
+
+const ScoreTable::Category* ScoreTable::find(int players, int rounds) const
+{
+    auto found = categories.find(key(players, rounds));
+    return found == categories.end() ? nullptr : &found->second;
+}
+
+const std::map<uint32_t, ScoreTable::Category>& ScoreTable::getCategories() const
+{
+    return categories;
+}
+
+void ScoreTable::serialize(std::vector<unsigned char>& out) const
+{
+    out.clear();
+    put<uint32_t>(out, (uint32_t)categories.size());
+    for (const auto& entry : categories)
+    {
+        const Category& category = entry.second;
+        put<uint32_t>(out, entry.first);
+        put<uint32_t>(out, category.count);
+        put<int32_t>(out, category.max);
+        put<uint32_t>(out, (uint32_t)category.top.size());
+        for (int32_t score : category.top)
+        {
+            put<int32_t>(out, score);
+        }
+        put<uint32_t>(out, (uint32_t)category.histogram.size());
+        for (uint32_t games : category.histogram)
+        {
+            put<uint32_t>(out, games);
+        }
+    }
+}
+
+bool ScoreTable::deserialize(const unsigned char* data, size_t size)
+{
+    categories.clear();
+    size_t pos = 0;
+    uint32_t count;
+    if (!get(data, size, pos, count))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t categoryKey;
+        uint32_t topSize;
+        uint32_t histogramSize;
+        Category category;
+        if (!get(data, size, pos, categoryKey) || !get(data, size, pos, category.count)
+            || !get(data, size, pos, category.max) || !get(data, size, pos, topSize)
+            || topSize > (size - pos) / sizeof(int32_t))
+        {
+            return false;
+        }
+        category.top.resize(topSize);
+        for (int32_t& score : category.top)
+        {
+            get(data, size, pos, score);
+        }
+        if ((int)category.top.size() > topCount)
+        {
+            category.top.resize(topCount);
+        }
+        if (!get(data, size, pos, histogramSize) || histogramSize > maxBuckets
+            || histogramSize > (size - pos) / sizeof(uint32_t))
+        {
+            return false;
+        }
+        category.histogram.resize(histogramSize);
+        for (uint32_t& games : category.histogram)
+        {
+            get(data, size, pos, games);
+        }
+        categories[categoryKey] = category;
+    }
+    return pos == size;
+}
+
+//--------------------------------------------------------------
+ScoreStore::~ScoreStore()
+{
+    close();
+}
+
+bool ScoreStore::setup(const std::string& directory_, int topCount)
+{
+    directory = directory_;
+    snapshotPath = ofFilePath::join(directory, "scores.snapshot");
+    logPath = ofFilePath::join(directory, "scores.log");
+    table.setup(topCount);
+    diskTable.setup(topCount);
+    ofDirectory::createDirectory(directory, false, true);
+
+    bool haveSnapshot = ofFile::doesFileExist(snapshotPath, false);
+    bool haveLog = ofFile::doesFileExist(logPath, false);
+    bool needsCompaction = false;
+    if (!haveSnapshot && !haveLog)
+    {
+        importTextFiles();
+        needsCompaction = true;
+    }
+    else
+    {
+        if (haveSnapshot && !loadSnapshot())
+        {
+            ofLogError("ScoreStore") << snapshotPath << " is corrupt, only the log is used";
+            table.setup(topCount);
+            snapshotSequence = 0;
+        }
+        // a torn record at the end is dropped by writing a fresh snapshot and log
+        needsCompaction = haveLog && !replayLog();
+    }
+
+    diskTable = table;
+    bool ok = true;
+    if (needsCompaction)
+    {
+        compact();
+        ok = log != nullptr;
+    }
+    else
+    {
+        ok = openLog(false);
+    }
+
+    startThread();
+    ofLogNotice("ScoreStore") << "loaded " << table.getCategories().size() << " score tables from " << directory;
+    return ok;
+}
+
+void ScoreStore::close()
+{
+    if (isThreadRunning())
+    {
+        stopThread();
+        waitForThread(false);
+
+        // the thread is gone, whatever was sent before close() is written from here,
+        // ahead of the compaction below
+        ScoreRecord record;
+        while (pending.tryReceive(record))
+        {
+            appendRecord(record);
+        }
+        pending.close();
+        sync();
+    }
+    if (log != nullptr)
+    {
+        if (lastSequence > snapshotSequence)
+        {
+            compact();
+        }
+        if (log != nullptr)
+        {
+            fclose(log);
+            log = nullptr;
+        }
+    }
+}
+
+void ScoreStore::addScore(int players, int rounds, int score)
+{
+    table.add(players, rounds, score);
+
+    ScoreRecord record;
+    record.timestamp = (int64_t)std::time(nullptr);
+    record.score = score;
+    record.players = (uint16_t)players;
+    record.rounds = (uint16_t)rounds;
+    pending.send(record);
+}
+
+int ScoreStore::getHighScore(int players, int rounds) const
+{
+    const ScoreTable::Category* category = table.find(players, rounds);
+    return category == nullptr ? 0 : category->max;
+}
+
+int ScoreStore::getNumScores(int players, int rounds) const
+{
+    const ScoreTable::Category* category = table.find(players, rounds);
+    return category == nullptr ? 0 : (int)category->count;
+}
+
+std::vector<int> ScoreStore::getTopScores(int players, int rounds) const
+{
+    const ScoreTable::Category* category = table.find(players, rounds);
+    return category == nullptr ? std::vector<int>() : std::vector<int>(category->top.begin(), category->top.end());
+}
+
+std::vector<uint32_t> ScoreStore::getHistogram(int players, int rounds) const
+{
+    const ScoreTable::Category* category = table.find(players, rounds);
+    return category == nullptr ? std::vector<uint32_t>() : category->histogram;
+}
+
+//--------------------------------------------------------------
+void ScoreStore::threadedFunction()
+{
+    ScoreRecord record;
+    while (isThreadRunning())
+    {
+        if (pending.tryReceive(record, 100))
+        {
+            appendRecord(record);
+        }
+        if (syncPending && ofGetElapsedTimeMillis() - lastSyncMillis >= syncIntervalMillis)
+        {
+            sync();
+        }
+        if (lastSequence - snapshotSequence >= compactAfterRecords)
+        {
+            compact();
+        }
+    }
+}
+
+void ScoreStore::importTextFiles()
+{
+    ofDirectory dataDirectory(ofToDataPath(""));
+    dataDirectory.allowExt("txt");
+    dataDirectory.listDir();
+    int imported = 0;
+    for (size_t i = 0; i < dataDirectory.size(); i++)
+    {
+        int players;
+        int rounds;
+        char end;
+        if (std::sscanf(dataDirectory.getName(i).c_str(), "scores_%d_%d.tx%c", &players, &rounds, &end) != 3)
+        {
+            continue;
+        }
+
+        std::ifstream inputFile(dataDirectory.getPath(i));
+        std::string line;
+        while (std::getline(inputFile, line))
+        {
+            try {
+                table.add(players, rounds, std::stoi(line));
+                imported++;
+            }
+            catch (const std::invalid_argument&) {
+                ofLogError() << "Ungueltige Zeile in der Datei: " << line;
+            }
+            catch (const std::out_of_range&) {
+                ofLogError() << "Wert ausserhalb des gueltigen Bereichs in der Datei: " << line;
+            }
+        }
+    }
+    if (imported > 0)
+    {
+        ofLogNotice("ScoreStore") << "imported " << imported << " scores from text files";
+    }
+}
+
+bool ScoreStore::loadSnapshot()
+{
+    ofBuffer buffer = ofBufferFromFile(snapshotPath, true);
+    const unsigned char* data = (const unsigned char*)buffer.getData();
+    size_t size = buffer.size();
+    size_t pos = 0;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t payloadSize;
+    uint32_t payloadChecksum;
+    if (!get(data, size, pos, magic) || std::memcmp(magic, snapshotMagic, 4) != 0
+        || !get(data, size, pos, version) || version != snapshotVersion
+        || !get(data, size, pos, snapshotSequence) || !get(data, size, pos, payloadSize)
+        || !get(data, size, pos, payloadChecksum) || payloadSize != size - pos
+        || checksum(data + pos, payloadSize) != payloadChecksum)
+    {
+        return false;
+    }
+    lastSequence = snapshotSequence;
+    return table.deserialize(data + pos, payloadSize);
+}
+
+bool ScoreStore::replayLog()
+{
+    FILE* file = std::fopen(logPath.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    ScoreRecord record;
+    bool clean = true;
+    size_t read;
+    while ((read = std::fread(&record, 1, sizeof(record), file)) == sizeof(record))
+    {
+        if (record.checksum != recordChecksum(record))
+        {
+            clean = false;
+            break;
+        }
+        // records up to the snapshot are already in it
+        if (record.sequence > lastSequence)
+        {
+            table.add(record.players, record.rounds, record.score);
+            lastSequence = record.sequence;
+        }
+    }
+    clean = clean && read == 0;
+    std::fclose(file);
+    if (!clean)
+    {
+        ofLogWarning("ScoreStore") << logPath << " ends in a damaged record, it is dropped";
+    }
+    return clean;
+}
+
+bool ScoreStore::openLog(bool truncate)
+{
+    if (log != nullptr)
+    {
+        std::fclose(log);
+    }
+    log = std::fopen(logPath.c_str(), truncate ? "wb" : "ab");
+    if (log == nullptr)
+    {
+        ofLogError("ScoreStore") << "could not open " << logPath << ", scores are only kept until exit";
+        return false;
+    }
+    return true;
+}
+
+void ScoreStore::appendRecord(ScoreRecord record)
+{
+    record.sequence = ++lastSequence;
+    record.checksum = recordChecksum(record);
+    diskTable.add(record.players, record.rounds, record.score);
+    if (log != nullptr)
+    {
+        std::fwrite(&record, sizeof(record), 1, log);
+        std::fflush(log);
+        syncPending = true;
+    }
+}
+
+void ScoreStore::sync()
+{
+    if (syncPending && log != nullptr)
+    {
+        syncFile(log);
+    }
+    syncPending = false;
+    lastSyncMillis = ofGetElapsedTimeMillis();
+}
+
+bool ScoreStore::writeSnapshot()
+{
+    std::vector<unsigned char> payload;
+    diskTable.serialize(payload);
+
+    std::vector<unsigned char> file;
+    put(file, snapshotMagic[0]);
+    put(file, snapshotMagic[1]);
+    put(file, snapshotMagic[2]);
+    put(file, snapshotMagic[3]);
+    put<uint32_t>(file, snapshotVersion);
+    put<uint64_t>(file, lastSequence);
+    put<uint32_t>(file, (uint32_t)payload.size());
+    put<uint32_t>(file, checksum(payload.data(), payload.size()));
+    file.insert(file.end(), payload.begin(), payload.end());
+
+    // write next to it, make it durable, then swap it in
+    std::string temporaryPath = snapshotPath + ".tmp";
+    FILE* out = std::fopen(temporaryPath.c_str(), "wb");
+    if (out == nullptr)
+    {
+        ofLogError("ScoreStore") << "could not write " << temporaryPath;
+        return false;
+    }
+    bool written = std::fwrite(file.data(), 1, file.size(), out) == file.size();
+    syncFile(out);
+    std::fclose(out);
+    if (!written || !replaceFile(temporaryPath, snapshotPath))
+    {
+        ofLogError("ScoreStore") << "could not replace " << snapshotPath;
+        return false;
+    }
+    snapshotSequence = lastSequence;
+    return true;
+}
+
+void ScoreStore::compact()
+{
+    // the log may only be emptied once the snapshot holds everything in it
+    sync();
+    if (writeSnapshot())
+    {
+        openLog(true);
+    }
+    else if (log == nullptr)
+    {
+        openLog(false);
+    }
+}
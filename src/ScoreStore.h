@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// one finished game as it is written to the log, 32 bytes
+struct ScoreRecord {
+    uint64_t sequence = 0;  // given out by the writer, increases by one per record
+    int64_t timestamp = 0;  // unix seconds, 0 for imported scores
+    int32_t score = 0;
+    uint16_t players = 0;
+    uint16_t rounds = 0;
+    uint32_t checksum = 0;  // over the fields above, catches torn writes
+    uint32_t padding = 0;
+};
+
+// max, best scores and score histogram per (players, rounds)
+class ScoreTable {
+public:
+    struct Category {
+        uint32_t count = 0;
+        int32_t max = 0;
+        std::vector<int32_t> top;       // best first
+        std::vector<uint32_t> histogram; // games per bucket of bucketWidth points
+    };
+
+    static const int bucketWidth = 50; // a round is worth a multiple of 50
+
+    void setup(int topCount);
+    void add(int players, int rounds, int score);
+    const Category* find(int players, int rounds) const;
+    const std::map<uint32_t, Category>& getCategories() const;
+
+    // compact form for the snapshot file
+    void serialize(std::vector<unsigned char>& out) const;
+    bool deserialize(const unsigned char* data, size_t size);
+
+private:
+    static uint32_t key(int players, int rounds);
+
+    int topCount = 10;
+    std::map<uint32_t, Category> categories;
+};
+
+// High scores kept in memory, loaded once at setup. New scores are visible
+// right away, a background thread appends them to a binary log, fsyncs in
+// batches and compacts the log into a snapshot now and then. Nothing on the
+// render thread waits for the disk after setup().
+//
+// Files in the directory: scores.snapshot (ScoreTable plus the sequence of
+// the last record it contains, replaced atomically) and scores.log (records
+// after that). The scores_<players>_<rounds>.txt files of older versions
+// are imported once when neither exists.
+class ScoreStore : public ofThread {
+public:
+    ~ScoreStore();
+
+    bool setup(const std::string& directory, int topCount = 10);
+    void close(); // flushes and compacts, blocks
+
+    void addScore(int players, int rounds, int score);
+
+    int getHighScore(int players, int rounds) const; // 0 without games
+    int getNumScores(int players, int rounds) const;
+    std::vector<int> getTopScores(int players, int rounds) const;
+    std::vector<uint32_t> getHistogram(int players, int rounds) const;
+
+private:
+    void threadedFunction() override;
+    void importTextFiles();
+    bool loadSnapshot();
+    bool replayLog(); // false if the log ended in a torn or corrupt record
+    bool openLog(bool truncate);
+    void appendRecord(ScoreRecord record);
+    void sync();
+    bool writeSnapshot();
+    void compact();
+
+    std::string directory;
+    std::string snapshotPath;
+    std::string logPath;
+
+    // render thread
+    ScoreTable table;
+
+    // writer thread, after setup()
+    ofThreadChannel<ScoreRecord> pending;
+    ScoreTable diskTable;
+    FILE* log = nullptr;
+    uint64_t lastSequence = 0;         // newest record written
+    uint64_t snapshotSequence = 0;     // newest record inside the snapshot
+    bool syncPending = false;
+    uint64_t lastSyncMillis = 0;
+};
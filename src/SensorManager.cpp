@@ -0,0 +1,385 @@
+#include "SensorManager.h"
+
+#include <thread>
+
+namespace {
+
+const int regionMargin = 24; // sensor pixels around a bubble, someone standing on its edge reaches over it
+
+} // namespace
+
+glm::mat3 SensorCalibration::getMatrix(int sensorWidth, int sensorHeight, int floorWidth, int floorHeight) const
+{
+    if (useHomography)
+    {
+        return homography;
+    }
+
+    // scale the sensor image up to the floor, apply the slider scale,
+    // translate and finally rotate around the origin, all in one matrix
+    float sensorToFloorX = (float)floorWidth / sensorWidth;
+    float sensorToFloorY = (float)floorHeight / sensorHeight;
+    float c = cos(ofDegToRad(rotateAngle));
+    float s = sin(ofDegToRad(rotateAngle));
+    float sx = scaleX * sensorToFloorX;
+    float sy = scaleY * sensorToFloorY;
+
+    // glm matrices are column major
+    glm::mat3 matrix;
+    matrix[0] = glm::vec3(c * sx, s * sx, 0);
+    matrix[1] = glm::vec3(-s * sy, c * sy, 0);
+    matrix[2] = glm::vec3(c * translateX - s * translateY, s * translateX + c * translateY, 1);
+    return matrix;
+}
+
+//--------------------------------------------------------------
+SensorManager::~SensorManager()
+{
+    close();
+}
+
+void SensorManager::open(const SensorSettings& settings_)
+{
+    settings = settings_;
+    sensors.clear();
+    for (int i = 0; i < settings.count; i++)
+    {
+        sensors.emplace_back(new Sensor());
+        Sensor& sensor = *sensors.back();
+        sensor.calibration = i < (int)savedCalibrations.size() ? savedCalibrations[i] : SensorCalibration();
+
+        std::string replayFile = i < (int)settings.replayFiles.size() ? settings.replayFiles[i] : "";
+        if (replayFile != "" && sensor.replay.open(ofToDataPath(replayFile)))
+        {
+            sensor.replay.setSpeed(settings.replaySpeed);
+            sensor.source = &sensor.replay;
+            continue;
+        }
+        if (settings.crowd)
+        {
+            sensor.synthetic.setup(*settings.crowd);
+            sensor.source = &sensor.synthetic;
+            continue;
+        }
+
+        sensor.kinect.reset(new ofxKinect());
+        ofxKinect& kinect = *sensor.kinect;
+        // enable depth->video image calibration
+        kinect.setRegistration(true);
+        kinect.init(false, true, false); // no textures, the debug view streams its own
+
+        // the same physical sensor keeps its calibration if it was seen before
+        bool opened = false;
+        if (i < (int)savedSerials.size() && savedSerials[i] != "")
+        {
+            opened = kinect.open(savedSerials[i]);
+        }
+        if (!opened)
+        {
+            kinect.open();
+        }
+
+        // print the intrinsic IR sensor values
+        if (kinect.isConnected())
+        {
+            sensor.serial = kinect.getSerial();
+            ofLogNotice("SensorManager") << "sensor " << i << ": " << sensor.serial;
+            ofLogNotice() << "sensor-emitter dist: " << kinect.getSensorEmitterDistance() << "cm";
+            ofLogNotice() << "sensor-camera dist:  " << kinect.getSensorCameraDistance() << "cm";
+            ofLogNotice() << "zero plane pixel size: " << kinect.getZeroPlanePixelSize() << "mm";
+            ofLogNotice() << "zero plane dist: " << kinect.getZeroPlaneDistance() << "mm";
+        }
+        else
+        {
+            ofLogWarning("SensorManager") << "sensor " << i << " is not connected";
+        }
+
+        // zero the tilt on startup
+        kinect.setCameraTiltAngle(0);
+        sensor.kinectSource.setup(kinect);
+        sensor.source = &sensor.kinectSource;
+    }
+}
+
+void SensorManager::setupVision()
+{
+    // the cores are shared between the sensors' blob labelers
+    int labelStripes = std::max((int)std::thread::hardware_concurrency() / std::max(size(), 1), 1);
+    for (int i = 0; i < size(); i++)
+    {
+        Sensor& sensor = *sensors[i];
+        std::string name = size() == 1 ? "vision" : "vision " + ofToString(i);
+        sensor.vision.setup(sensor.source->getWidth(), sensor.source->getHeight(), settings.visionMode, name, labelStripes);
+        setCalibration(i, sensor.calibration);
+    }
+    candidates.reserve(TrackedPointBuffer::capacity);
+}
+
+void SensorManager::close()
+{
+    for (auto& sensor : sensors)
+    {
+        sensor->vision.stop();
+        if (sensor->kinect)
+        {
+            sensor->kinect->setCameraTiltAngle(0); // zero the tilt on exit
+            sensor->kinect->close();
+        }
+        sensor->replay.close();
+    }
+    sensors.clear();
+}
+
+bool SensorManager::update(const VisionSettings& visionSettings)
+{
+    // the workers run in parallel, this only copies frames in and swaps results out
+    bool anyNew = false;
+    VisionSettings sensorSettings = visionSettings;
+    for (auto& sensor : sensors)
+    {
+        sensor->snapshotNew = false;
+        sensor->source->update();
+        if (sensor->source->isFrameNew())
+        {
+            sensorSettings.useRegions = sensor->useRegions;
+            sensorSettings.regions = sensor->regions;
+            sensorSettings.numRegions = sensor->numRegions;
+            sensor->vision.pushDepthFrame(sensor->source->getDepthPixels(), sensorSettings);
+        }
+
+        if (sensor->vision.updateSnapshot())
+        {
+            // sequences are given out per pushed frame, a gap means the worker skipped frames
+            uint64_t snapshotSequence = sensor->vision.getSnapshot().sequence;
+            if (sensor->visionSequence != 0 && snapshotSequence > sensor->visionSequence + 1)
+            {
+                droppedFrames += snapshotSequence - sensor->visionSequence - 1;
+            }
+            sensor->visionSequence = snapshotSequence;
+            sensor->snapshotNew = true;
+            anyNew = true;
+        }
+    }
+    if (anyNew)
+    {
+        sequence++;
+    }
+    return anyNew;
+}
+
+void SensorManager::setRegionsOfInterest(const BubbleStore& bubbles)
+{
+    for (auto& sensor : sensors)
+    {
+        const int width = sensor->source->getWidth();
+        const int height = sensor->source->getHeight();
+        // a sensor without a bubble in view only follows people and scans for newcomers,
+        // while no bubbles exist at all everything is processed
+        sensor->useRegions = !bubbles.empty();
+        sensor->numRegions = 0;
+        for (int i = 0; i < bubbles.size() && sensor->numRegions < VisionSettings::maxRegions; i++)
+        {
+            // the bubble is an ellipse or worse in sensor space, bound eight points of its outline
+            float minX = (float)width;
+            float minY = (float)height;
+            float maxX = 0;
+            float maxY = 0;
+            for (int k = 0; k < 8; k++)
+            {
+                float angle = k * TWO_PI / 8;
+                glm::vec2 floorPoint(bubbles.getX(i) + std::cos(angle) * bubbles.getRadius(i), bubbles.getY(i) + std::sin(angle) * bubbles.getRadius(i));
+                glm::vec2 pixel = applyHomography(sensor->fromFloor, floorPoint);
+                minX = std::min(minX, pixel.x);
+                minY = std::min(minY, pixel.y);
+                maxX = std::max(maxX, pixel.x);
+                maxY = std::max(maxY, pixel.y);
+            }
+            if (maxX < 0 || maxY < 0 || minX >= width || minY >= height)
+            {
+                continue; // another sensor's part of the floor
+            }
+            // the chords between the points cut the outline a little, the margin covers that
+            VisionRegion& region = sensor->regions[sensor->numRegions++];
+            region.x = (int)minX - regionMargin;
+            region.y = (int)minY - regionMargin;
+            region.width = (int)(maxX - minX) + 2 * regionMargin;
+            region.height = (int)(maxY - minY) + 2 * regionMargin;
+        }
+    }
+}
+
+void SensorManager::clearRegionsOfInterest()
+{
+    for (auto& sensor : sensors)
+    {
+        sensor->useRegions = false;
+        sensor->numRegions = 0;
+    }
+}
+
+void SensorManager::mergeDetections(TrackedPointBuffer& points, int minBlobSize, int maxBlobSize)
+{
+    candidates.clear();
+    const float maxDistanceSquared = settings.mergeDistance * settings.mergeDistance;
+    for (int s = 0; s < size(); s++)
+    {
+        const Sensor& sensor = *sensors[s];
+        const VisionSnapshot& snapshot = sensor.vision.getSnapshot();
+        for (const VisionBlob& blob : snapshot.blobs)
+        {
+            if (blob.area < minBlobSize || blob.area > maxBlobSize)
+            {
+                continue;
+            }
+            glm::vec2 position = applyHomography(sensor.toFloor, blob.centroid);
+
+            // where two sensors overlap a person shows up in both, merge with the
+            // nearest point another sensor found if this one can see it too
+            int match = -1;
+            float matchDistance = maxDistanceSquared;
+            for (int c = 0; c < (int)candidates.size(); c++)
+            {
+                const Candidate& candidate = candidates[c];
+                glm::vec2 offset = candidate.position - position;
+                float distanceSquared = offset.x * offset.x + offset.y * offset.y;
+                if ((candidate.sensors & (1u << s)) == 0 && distanceSquared < matchDistance && covers(sensor, candidate.position))
+                {
+                    match = c;
+                    matchDistance = distanceSquared;
+                }
+            }
+
+            if (match >= 0)
+            {
+                Candidate& candidate = candidates[match];
+                float weight = blob.area / std::max(candidate.area + blob.area, 1.0f);
+                candidate.position = candidate.position + (position - candidate.position) * weight;
+                candidate.area = std::max(candidate.area, blob.area);
+                candidate.sensors |= 1u << s;
+            }
+            else if ((int)candidates.size() < TrackedPointBuffer::capacity)
+            {
+                Candidate candidate;
+                candidate.position = position;
+                candidate.area = blob.area;
+                candidate.sensors = 1u << s;
+                candidates.push_back(candidate);
+            }
+        }
+    }
+
+    points.clear();
+    for (int c = 0; c < (int)candidates.size(); c++)
+    {
+        points.push(candidates[c].position.x, candidates[c].position.y, candidates[c].area, c + 1);
+    }
+}
+
+bool SensorManager::covers(const Sensor& sensor, glm::vec2 floorPosition) const
+{
+    glm::vec2 pixel = applyHomography(sensor.fromFloor, floorPosition);
+    return pixel.x >= 0 && pixel.y >= 0 && pixel.x < sensor.source->getWidth() && pixel.y < sensor.source->getHeight();
+}
+
+int SensorManager::size() const
+{
+    return (int)sensors.size();
+}
+
+SensorManager::Sensor& SensorManager::getSensor(int i)
+{
+    return *sensors[i];
+}
+
+void SensorManager::setCalibration(int i, const SensorCalibration& calibration)
+{
+    Sensor& sensor = *sensors[i];
+    sensor.calibration = calibration;
+    sensor.toFloor = calibration.getMatrix(sensor.source->getWidth(), sensor.source->getHeight(), settings.floorWidth, settings.floorHeight);
+    sensor.fromFloor = glm::inverse(sensor.toFloor);
+}
+
+bool SensorManager::loadCalibrations(const std::string& path)
+{
+    savedSerials.clear();
+    savedCalibrations.clear();
+    if (!ofFile::doesFileExist(path, false))
+    {
+        return false;
+    }
+
+    ofJson json = ofLoadJson(path);
+    if (!json.contains("sensors"))
+    {
+        return false;
+    }
+    for (const ofJson& entry : json["sensors"])
+    {
+        SensorCalibration calibration;
+        calibration.translateX = entry.value("translateX", 0.0f);
+        calibration.translateY = entry.value("translateY", 0.0f);
+        calibration.rotateAngle = entry.value("rotateAngle", 0.0f);
+        calibration.scaleX = entry.value("scaleX", 1.0f);
+        calibration.scaleY = entry.value("scaleY", 1.0f);
+        if (entry.contains("homography") && entry["homography"].size() == 9)
+        {
+            // column major like glm
+            calibration.useHomography = true;
+            for (int i = 0; i < 9; i++)
+            {
+                calibration.homography[i / 3][i % 3] = entry["homography"][i].get<float>();
+            }
+        }
+        savedCalibrations.push_back(calibration);
+        savedSerials.push_back(entry.value("serial", std::string()));
+    }
+    return true;
+}
+
+void SensorManager::saveCalibrations(const std::string& path) const
+{
+    ofJson json;
+    json["sensors"] = ofJson::array();
+    for (int i = 0; i < size(); i++)
+    {
+        const Sensor* sensor = sensors[i].get();
+        ofJson entry;
+        // a sensor that didn't open this time keeps its place
+        entry["serial"] = sensor->serial != "" || i >= (int)savedSerials.size() ? sensor->serial : savedSerials[i];
+        entry["translateX"] = sensor->calibration.translateX;
+        entry["translateY"] = sensor->calibration.translateY;
+        entry["rotateAngle"] = sensor->calibration.rotateAngle;
+        entry["scaleX"] = sensor->calibration.scaleX;
+        entry["scaleY"] = sensor->calibration.scaleY;
+        if (sensor->calibration.useHomography)
+        {
+            entry["homography"] = ofJson::array();
+            for (int i = 0; i < 9; i++)
+            {
+                entry["homography"].push_back(sensor->calibration.homography[i / 3][i % 3]);
+            }
+        }
+        json["sensors"].push_back(entry);
+    }
+    ofSavePrettyJson(path, json);
+}
+
+uint64_t SensorManager::getSequence() const
+{
+    return sequence;
+}
+
+uint64_t SensorManager::getNewestTimestampMicros() const
+{
+    uint64_t newest = 0;
+    for (const auto& sensor : sensors)
+    {
+        newest = std::max(newest, sensor->vision.getSnapshot().timestampMicros);
+    }
+    return newest;
+}
+
+uint64_t SensorManager::getDroppedFrames() const
+{
+    return droppedFrames;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxKinect.h"
+#include "DepthSource.h"
+#include "DepthRecording.h"
+#include "VisionWorker.h"
+#include "TrackedPoints.h"
+#include "HomographyCalibration.h"
+#include "BubbleStore.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// sensor image to floor (projector) transform, either what the calibration
+// sliders edit or a homography measured in the calibration mode
+struct SensorCalibration {
+    float translateX = 0;
+    float translateY = 0;
+    float rotateAngle = 0; // degrees
+    float scaleX = 1;
+    float scaleY = 1;
+
+    bool useHomography = false; // the sliders are ignored while set
+    glm::mat3 homography = glm::mat3(1.0);
+
+    glm::mat3 getMatrix(int sensorWidth, int sensorHeight, int floorWidth, int floorHeight) const;
+};
+
+struct SensorSettings {
+    int count = 1;
+    std::vector<std::string> replayFiles; // per sensor, a recording to play instead of a kinect
+    SyntheticCrowd* crowd = nullptr;      // every sensor without a recording films this crowd instead of a kinect
+    double replaySpeed = 1;
+    VisionWorker::Mode visionMode = VisionWorker::threaded;
+    int floorWidth = 1920;
+    int floorHeight = 1080;
+    float mergeDistance = 80; // floor pixels, blobs of two sensors closer than this are one person
+};
+
+// Several depth sensors covering one floor. Every sensor has its own vision
+// worker thread, so throughput grows with the number of cores. Blobs are
+// mapped to floor coordinates with the sensor's calibration, and a blob
+// seen by two sensors where their views overlap is merged into one point.
+class SensorManager {
+public:
+    struct Sensor {
+        std::unique_ptr<ofxKinect> kinect; // null when replaying
+        KinectDepthSource kinectSource;
+        DepthReplay replay;
+        SyntheticDepthSource synthetic;
+        DepthSource* source = nullptr;
+        std::string serial;
+
+        VisionWorker vision;
+        SensorCalibration calibration;
+        glm::mat3 toFloor = glm::mat3(1.0);
+        glm::mat3 fromFloor = glm::mat3(1.0);
+
+        uint64_t visionSequence = 0; // snapshot the merge last used
+        bool snapshotNew = false;    // set by update() for this frame
+
+        // bubbles as seen by this sensor, handed to the worker with every frame
+        bool useRegions = false;
+        std::array<VisionRegion, VisionSettings::maxRegions> regions;
+        int numRegions = 0;
+    };
+
+    ~SensorManager();
+
+    // blocks while the kinects open, may run on a worker thread
+    void open(const SensorSettings& settings);
+    // render thread, after open()
+    void setupVision();
+    void close();
+
+    // render thread, once per frame: hands new depth frames to the workers and
+    // picks up their results, returns true if any sensor has a new snapshot
+    bool update(const VisionSettings& visionSettings);
+
+    // the workers process the area under these bubbles in full and the rest
+    // of their view at a lower resolution, see VisionSettings
+    void setRegionsOfInterest(const BubbleStore& bubbles);
+    void clearRegionsOfInterest();
+
+    // latest blobs of all sensors in floor coordinates, duplicates in overlap zones merged
+    void mergeDetections(TrackedPointBuffer& points, int minBlobSize, int maxBlobSize);
+
+    int size() const;
+    Sensor& getSensor(int i);
+    void setCalibration(int i, const SensorCalibration& calibration);
+
+    // calibrations and kinect serials, so sensors keep their calibration across restarts
+    bool loadCalibrations(const std::string& path);
+    void saveCalibrations(const std::string& path) const;
+
+    uint64_t getSequence() const;               // bumped whenever any sensor has a new snapshot
+    uint64_t getNewestTimestampMicros() const;  // capture time of the newest snapshot
+    uint64_t getDroppedFrames() const;          // depth frames the workers skipped, all sensors
+
+private:
+    struct Candidate {
+        glm::vec2 position;
+        float area = 0;
+        uint32_t sensors = 0; // bit per sensor that saw it
+    };
+
+    bool covers(const Sensor& sensor, glm::vec2 floorPosition) const;
+
+    SensorSettings settings;
+    std::vector<std::unique_ptr<Sensor>> sensors;
+    std::vector<std::string> savedSerials; // from loadCalibrations(), opened in this order
+    std::vector<SensorCalibration> savedCalibrations;
+    std::vector<Candidate> candidates;
+    uint64_t sequence = 0;
+    uint64_t droppedFrames = 0;
+};
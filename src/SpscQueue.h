@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single producer / single consumer ring buffer of fixed capacity.
+// The producer calls push(), the consumer pop(), neither side ever blocks or
+// allocates, so the consumer can be a real-time thread. One slot stays empty
+// to tell a full ring from an empty one.
+template<typename T, size_t Capacity>
+class SpscQueue {
+public:
+    // producer side, returns false and drops the item when the ring is full
+    bool push(const T& item)
+    {
+        size_t tail = writeIndex.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % Capacity;
+        if (next == readIndex.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        items[tail] = item;
+        writeIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, returns false when there is nothing to take
+    bool pop(T& item)
+    {
+        size_t head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = items[head];
+        readIndex.store((head + 1) % Capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> items;
+    std::atomic<size_t> writeIndex{ 0 };
+    std::atomic<size_t> readIndex{ 0 };
+};
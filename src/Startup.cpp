@@ -0,0 +1,171 @@
+#include "Startup.h"
+
+#include <iomanip>
+
+Startup::~Startup()
+{
+    wait();
+}
+
+void Startup::begin()
+{
+    beginMicros = ofGetElapsedTimeMicros();
+}
+
+void Startup::addWorker(const std::string& name, std::function<void()> work)
+{
+    phases.emplace_back(new Phase());
+    Phase* phase = phases.back().get();
+    phase->name = name;
+    phase->worker = true;
+    phase->started = true;
+    phase->result = std::async(std::launch::async, [phase, work]()
+    {
+        // timed here, polling from update() would add up to a frame
+        phase->startMicros = ofGetElapsedTimeMicros();
+        work();
+        phase->endMicros = ofGetElapsedTimeMicros();
+    });
+}
+
+void Startup::addStep(const std::string& name, std::function<void()> work, const std::vector<std::string>& after)
+{
+    phases.emplace_back(new Phase());
+    Phase& phase = *phases.back();
+    phase.name = name;
+    phase.work = work;
+    phase.after = after;
+}
+
+void Startup::update()
+{
+    if (done)
+    {
+        return;
+    }
+
+    for (auto& phase : phases)
+    {
+        if (phase->worker && !phase->done && phase->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            finish(*phase);
+        }
+    }
+
+    for (auto& phase : phases)
+    {
+        if (phase->started)
+        {
+            continue;
+        }
+        bool ready = true;
+        for (const std::string& name : phase->after)
+        {
+            ready = ready && isFinished(name);
+        }
+        if (ready)
+        {
+            currentPhase = phase->name;
+            phase->started = true;
+            phase->startMicros = ofGetElapsedTimeMicros();
+            phase->work();
+            phase->endMicros = ofGetElapsedTimeMicros();
+            phase->done = true;
+            break;
+        }
+    }
+
+    for (auto& phase : phases)
+    {
+        if (!phase->done)
+        {
+            return;
+        }
+    }
+    done = true;
+    doneMicros = ofGetElapsedTimeMicros();
+    currentPhase = "";
+    logReport();
+}
+
+void Startup::wait()
+{
+    for (auto& phase : phases)
+    {
+        if (phase->worker && !phase->done)
+        {
+            finish(*phase);
+        }
+    }
+}
+
+void Startup::finish(Phase& phase)
+{
+    try {
+        phase.result.get();
+    }
+    catch (const std::exception& e) {
+        ofLogError("Startup") << phase.name << " failed: " << e.what();
+    }
+    phase.done = true;
+}
+
+bool Startup::isFinished(const std::string& name) const
+{
+    for (const auto& phase : phases)
+    {
+        if (phase->name == name)
+        {
+            return phase->done;
+        }
+    }
+    return true;
+}
+
+bool Startup::isDone() const
+{
+    return done;
+}
+
+float Startup::getProgress() const
+{
+    if (phases.empty())
+    {
+        return 1;
+    }
+    int finished = 0;
+    for (const auto& phase : phases)
+    {
+        finished += phase->done ? 1 : 0;
+    }
+    return finished / (float)phases.size();
+}
+
+const std::string& Startup::getCurrentPhase() const
+{
+    return currentPhase;
+}
+
+void Startup::frameDrawn()
+{
+    if (firstFrameMicros == 0)
+    {
+        firstFrameMicros = ofGetElapsedTimeMicros();
+    }
+}
+
+void Startup::logReport() const
+{
+    for (const auto& phase : phases)
+    {
+        ofLogNotice("Startup") << std::left << std::setw(20) << phase->name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(8) << (phase->endMicros - phase->startMicros) / 1000.0 << " ms"
+            << " (" << (phase->worker ? "worker" : "render thread") << ", from "
+            << (phase->startMicros - beginMicros) / 1000.0 << " ms)";
+    }
+    if (firstFrameMicros != 0)
+    {
+        ofLogNotice("Startup") << "first frame after " << (firstFrameMicros - beginMicros) / 1000.0 << " ms";
+    }
+    ofLogNotice("Startup") << "ready after " << (doneMicros - beginMicros) / 1000.0 << " ms";
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Startup split into timed phases so the first frame can be drawn right away.
+// Worker phases start immediately on their own threads. Render thread phases
+// (anything touching GL or the sound player) run one per update() once the
+// phases they wait for are done, so a splash keeps drawing in between.
+class Startup {
+public:
+    ~Startup();
+
+    void begin();
+
+    void addWorker(const std::string& name, std::function<void()> work);
+    void addStep(const std::string& name, std::function<void()> work, const std::vector<std::string>& after = {});
+
+    // call once per frame until isDone()
+    void update();
+    void wait(); // blocks until the workers are finished, for exit() during startup
+
+    bool isDone() const;
+    float getProgress() const;
+    const std::string& getCurrentPhase() const;
+
+    void frameDrawn(); // the first call is logged as time to first frame
+    void logReport() const;
+
+private:
+    struct Phase {
+        std::string name;
+        std::function<void()> work;
+        std::vector<std::string> after;
+        bool worker = false;
+        bool started = false;
+        bool done = false;
+        uint64_t startMicros = 0;
+        uint64_t endMicros = 0;
+        std::future<void> result;
+    };
+
+    bool isFinished(const std::string& name) const;
+    void finish(Phase& phase);
+
+    std::vector<std::unique_ptr<Phase>> phases;
+    uint64_t beginMicros = 0;
+    uint64_t firstFrameMicros = 0;
+    uint64_t doneMicros = 0;
+    std::string currentPhase;
+    bool done = false;
+};
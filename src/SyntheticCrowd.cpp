@@ -0,0 +1,465 @@
+#include "SyntheticCrowd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float twoPi = 6.28318530718f;
+const float arrivalDistance = 60;   // px, walkers slow down within this distance of their waypoint
+const float arrivedDistance = 10;   // px, close enough, somebody may be standing on the exact spot
+const float personalSpace = 2.4f;   // body radii, strangers closer than this push each other away
+const float armLength = 1.6f;       // body radii from the centre, far enough to leave a gap
+const float armRadius = 0.35f;      // body radii
+const float headRadius = 0.45f;     // body radii, the head is nearer to the sensor
+const uint8_t bodyDepth = 175;
+const uint8_t headDepth = 195;
+
+} // namespace
+
+void SyntheticCrowd::setup(const CrowdSettings& settings_)
+{
+    settings = settings_;
+    generator.seed(settings.seed);
+    noiseState = settings.seed | 1;
+    time = 0;
+    count = 0;
+}
+
+float SyntheticCrowd::random(float min, float max)
+{
+    return std::uniform_real_distribution<float>(min, max)(generator);
+}
+
+// xorshift, the depth noise needs a few hundred thousand numbers per frame
+uint32_t SyntheticCrowd::nextNoise()
+{
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return noiseState;
+}
+
+//--------------------------------------------------------------
+void SyntheticCrowd::setPeople(int people)
+{
+    people = std::max(std::min(people, maxPeople), 0);
+    int staying = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!walkers[i].leaving)
+        {
+            staying++;
+        }
+    }
+
+    // the first call fills the floor at once, later ones walk in
+    bool atEdge = count > 0 || time > 0;
+    for (; staying < people && count < maxPeople; staying++)
+    {
+        addWalker(atEdge);
+    }
+    for (int i = count - 1; i >= 0 && staying > people; i--)
+    {
+        Walker& walker = walkers[i];
+        if (walker.leaving)
+        {
+            continue;
+        }
+        // out over the nearest edge
+        float toLeft = walker.x;
+        float toRight = settings.width - walker.x;
+        float toTop = walker.y;
+        float toBottom = settings.height - walker.y;
+        float nearest = std::min(std::min(toLeft, toRight), std::min(toTop, toBottom));
+        walker.targetX = nearest == toLeft ? -4 * walker.radius : nearest == toRight ? settings.width + 4 * walker.radius : walker.x;
+        walker.targetY = nearest == toTop ? -4 * walker.radius : nearest == toBottom ? settings.height + 4 * walker.radius : walker.y;
+        walker.pauseUntil = 0;
+        walker.assigned = false;
+        walker.inBubble = false;
+        walker.leaving = true;
+        staying--;
+    }
+}
+
+int SyntheticCrowd::getNumPeople() const
+{
+    return count;
+}
+
+void SyntheticCrowd::addWalker(bool atEdge)
+{
+    Walker& walker = walkers[count];
+    walker.radius = settings.bodyRadius * random(0.8f, 1.2f);
+    walker.speed = settings.walkSpeed * random(0.7f, 1.3f);
+    walker.vx = 0;
+    walker.vy = 0;
+    walker.pauseUntil = 0;
+    walker.armUntil = 0;
+    walker.armAngle = 0;
+    walker.assigned = false;
+    walker.inBubble = false;
+    walker.leaving = false;
+    if (atEdge)
+    {
+        int edge = (int)random(0, 4);
+        float along = random(0, 1);
+        walker.x = edge == 0 ? -walker.radius : edge == 1 ? settings.width + walker.radius : along * settings.width;
+        walker.y = edge == 2 ? -walker.radius : edge == 3 ? settings.height + walker.radius : along * settings.height;
+    }
+    else
+    {
+        walker.x = random(walker.radius, settings.width - walker.radius);
+        walker.y = random(walker.radius, settings.height - walker.radius);
+    }
+
+    // a companion keeps a shoulder to shoulder offset, close enough that the two blobs often touch
+    walker.companion = -1;
+    if (count > 0 && random(0, 1) < settings.groupChance)
+    {
+        int other = (int)random(0, (float)count);
+        if (walkers[other].companion < 0 && !walkers[other].leaving)
+        {
+            walker.companion = other;
+            float angle = random(0, twoPi);
+            float distance = (walker.radius + walkers[other].radius) * random(0.9f, 1.2f);
+            walker.sideX = std::cos(angle) * distance;
+            walker.sideY = std::sin(angle) * distance;
+        }
+    }
+    pickWaypoint(walker);
+    count++;
+}
+
+void SyntheticCrowd::removeWalker(int index)
+{
+    // the last walker takes the free slot, companions follow it there
+    int last = count - 1;
+    for (int i = 0; i < count; i++)
+    {
+        if (walkers[i].companion == index)
+        {
+            walkers[i].companion = -1;
+        }
+    }
+    walkers[index] = walkers[last];
+    for (int i = 0; i < last; i++)
+    {
+        if (walkers[i].companion == last)
+        {
+            walkers[i].companion = index;
+        }
+    }
+    if (walkers[index].companion == index)
+    {
+        walkers[index].companion = -1;
+    }
+    count--;
+}
+
+void SyntheticCrowd::pickWaypoint(Walker& walker)
+{
+    walker.targetX = random(walker.radius, settings.width - walker.radius);
+    walker.targetY = random(walker.radius, settings.height - walker.radius);
+}
+
+//--------------------------------------------------------------
+void SyntheticCrowd::setTargets(const BubbleStore& bubbles)
+{
+    clearTargets();
+    for (int i = 0; i < bubbles.size(); i++)
+    {
+        for (int n = 0; n < bubbles.getExpectedAmount(i); n++)
+        {
+            // the nearest walker that isn't busy yet
+            int nearest = -1;
+            float nearestDistance = 0;
+            for (int w = 0; w < count; w++)
+            {
+                const Walker& walker = walkers[w];
+                if (walker.assigned || walker.leaving)
+                {
+                    continue;
+                }
+                float dx = walker.x - bubbles.getX(i);
+                float dy = walker.y - bubbles.getY(i);
+                float distance = dx * dx + dy * dy;
+                if (nearest < 0 || distance < nearestDistance)
+                {
+                    nearest = w;
+                    nearestDistance = distance;
+                }
+            }
+            if (nearest < 0)
+            {
+                return;
+            }
+
+            // some players don't make it and wander on, so rounds are lost as well
+            Walker& walker = walkers[nearest];
+            walker.assigned = true;
+            if (random(0, 1) >= settings.followChance)
+            {
+                continue;
+            }
+            float angle = random(0, twoPi);
+            float distance = random(0, bubbles.getRadius(i) * 0.5f);
+            walker.targetX = bubbles.getX(i) + std::cos(angle) * distance;
+            walker.targetY = bubbles.getY(i) + std::sin(angle) * distance;
+            walker.pauseUntil = 0;
+            walker.inBubble = true;
+        }
+    }
+}
+
+void SyntheticCrowd::clearTargets()
+{
+    for (int i = 0; i < count; i++)
+    {
+        walkers[i].assigned = false;
+        walkers[i].inBubble = false;
+    }
+}
+
+//--------------------------------------------------------------
+void SyntheticCrowd::update(double dt)
+{
+    time += dt;
+    for (int i = 0; i < count; i++)
+    {
+        steer(i, (float)dt);
+    }
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        Walker& walker = walkers[i];
+        walker.x += walker.vx * (float)dt;
+        walker.y += walker.vy * (float)dt;
+
+        // arms and bags come and go
+        if (walker.armUntil < time && random(0, 1) < settings.splitRate * dt)
+        {
+            walker.armUntil = time + random(0.3f, 1.5f);
+            walker.armAngle = random(0, twoPi);
+        }
+
+        float margin = 2 * walker.radius;
+        if (walker.leaving && (walker.x < -margin || walker.y < -margin || walker.x > settings.width + margin || walker.y > settings.height + margin))
+        {
+            removeWalker(i);
+        }
+    }
+}
+
+void SyntheticCrowd::steer(int index, float dt)
+{
+    Walker& walker = walkers[index];
+
+    // companions aim for their place next to the other walker, everyone else for a waypoint
+    float targetX = walker.targetX;
+    float targetY = walker.targetY;
+    bool following = walker.companion >= 0 && !walker.inBubble && !walker.leaving;
+    if (following)
+    {
+        const Walker& other = walkers[walker.companion];
+        targetX = other.x + walker.sideX;
+        targetY = other.y + walker.sideY;
+    }
+
+    float dx = targetX - walker.x;
+    float dy = targetY - walker.y;
+    float distance = std::sqrt(dx * dx + dy * dy);
+    float desiredX = 0;
+    float desiredY = 0;
+    if (walker.pauseUntil <= time && distance > (following ? 1 : arrivedDistance))
+    {
+        float speed = walker.speed * std::min(distance / arrivalDistance, 1.0f);
+        if (following)
+        {
+            speed = std::min(walker.speed * 1.3f, distance * 4);
+        }
+        desiredX = dx / distance * speed;
+        desiredY = dy / distance * speed;
+    }
+    else if (!following && !walker.inBubble && !walker.leaving && walker.pauseUntil <= time)
+    {
+        // arrived: stand for a moment, then on to the next waypoint
+        walker.pauseUntil = time + random(0, (float)settings.maxPause);
+        pickWaypoint(walker);
+    }
+
+    // strangers keep their distance, companions and people in the same bubble may touch
+    for (int j = 0; j < count; j++)
+    {
+        const Walker& other = walkers[j];
+        if (j == index || j == walker.companion || other.companion == index || (walker.inBubble && other.inBubble))
+        {
+            continue;
+        }
+        float ox = walker.x - other.x;
+        float oy = walker.y - other.y;
+        float space = (walker.radius + other.radius) * personalSpace * 0.5f;
+        float squared = ox * ox + oy * oy;
+        if (squared < space * space && squared > 0.0001f)
+        {
+            float d = std::sqrt(squared);
+            float push = walker.speed * (space - d) / space;
+            desiredX += ox / d * push;
+            desiredY += oy / d * push;
+        }
+    }
+
+    // limited acceleration gives smooth turns and stops
+    float ax = desiredX - walker.vx;
+    float ay = desiredY - walker.vy;
+    float change = std::sqrt(ax * ax + ay * ay);
+    float maxChange = settings.acceleration * dt;
+    if (change > maxChange)
+    {
+        ax *= maxChange / change;
+        ay *= maxChange / change;
+    }
+    walker.vx += ax;
+    walker.vy += ay;
+}
+
+//--------------------------------------------------------------
+void SyntheticCrowd::getDetections(TrackedPointBuffer& points)
+{
+    // walkers whose bodies touch are one blob, like they would be in the depth image
+    for (int i = 0; i < count; i++)
+    {
+        cluster[i] = i;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = i + 1; j < count; j++)
+        {
+            float dx = walkers[i].x - walkers[j].x;
+            float dy = walkers[i].y - walkers[j].y;
+            float reach = walkers[i].radius + walkers[j].radius;
+            if (dx * dx + dy * dy < reach * reach && cluster[i] != cluster[j])
+            {
+                // the smaller label wins, so a label is always the first walker of its cluster
+                int root = std::min(cluster[i], cluster[j]);
+                int other = std::max(cluster[i], cluster[j]);
+                for (int k = 0; k < count; k++)
+                {
+                    if (cluster[k] == other)
+                    {
+                        cluster[k] = root;
+                    }
+                }
+            }
+        }
+    }
+
+    points.clear();
+    uint32_t id = 1;
+    for (int root = 0; root < count; root++)
+    {
+        float sumX = 0;
+        float sumY = 0;
+        float area = 0;
+        for (int i = root; i < count; i++)
+        {
+            const Walker& walker = walkers[i];
+            if (cluster[i] != root || random(0, 1) < settings.dropoutChance)
+            {
+                continue;
+            }
+            float walkerArea = twoPi * 0.5f * walker.radius * walker.radius;
+            sumX += walker.x * walkerArea;
+            sumY += walker.y * walkerArea;
+            area += walkerArea;
+        }
+        if (area > 0)
+        {
+            float noiseX = (random(-1, 1) + random(-1, 1)) * 0.5f * settings.positionNoise;
+            float noiseY = (random(-1, 1) + random(-1, 1)) * 0.5f * settings.positionNoise;
+            points.push(sumX / area + noiseX, sumY / area + noiseY, area, id++);
+        }
+    }
+
+    // arms and bags far enough from the body are small blobs of their own
+    for (int i = 0; i < count; i++)
+    {
+        const Walker& walker = walkers[i];
+        if (walker.armUntil > time)
+        {
+            float r = walker.radius * armRadius;
+            points.push(walker.x + std::cos(walker.armAngle) * walker.radius * armLength,
+                walker.y + std::sin(walker.armAngle) * walker.radius * armLength, twoPi * 0.5f * r * r, id++);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void SyntheticCrowd::renderDepth(uint8_t* depth, int width, int height, int stride)
+{
+    // floor, a little nearer towards the bottom like a slightly tilted sensor
+    int noiseRange = settings.depthNoise * 2 + 1;
+    for (int y = 0; y < height; y++)
+    {
+        uint8_t* row = depth + (size_t)y * stride;
+        int base = 60 + (y * 40) / height - settings.depthNoise;
+        for (int x = 0; x < width; x++)
+        {
+            row[x] = (uint8_t)(base + (int)(nextNoise() % noiseRange));
+        }
+    }
+
+    float scaleX = width / settings.width;
+    float scaleY = height / settings.height;
+    float scale = std::min(scaleX, scaleY);
+    for (int i = 0; i < count; i++)
+    {
+        const Walker& walker = walkers[i];
+        if (random(0, 1) < settings.dropoutChance)
+        {
+            continue;
+        }
+        float cx = walker.x * scaleX;
+        float cy = walker.y * scaleY;
+        float radius = walker.radius * scale;
+
+        // the projector and the sensor don't sit in the same spot, every person casts an IR shadow with no depth
+        drawDisc(depth, width, height, stride, cx + radius * 0.3f, cy, radius, 0, 0);
+        drawDisc(depth, width, height, stride, cx, cy, radius, bodyDepth, 1);
+        drawDisc(depth, width, height, stride, cx, cy, radius * headRadius, headDepth, 0);
+        if (walker.armUntil > time)
+        {
+            drawDisc(depth, width, height, stride, cx + std::cos(walker.armAngle) * radius * armLength,
+                cy + std::sin(walker.armAngle) * radius * armLength, radius * armRadius, bodyDepth, 0.5f);
+        }
+    }
+}
+
+void SyntheticCrowd::drawDisc(uint8_t* depth, int width, int height, int stride, float cx, float cy, float radius, uint8_t value, float edgeNoise)
+{
+    // the outline flickers by up to edgeNoise pixels like real depth edges
+    float outer = radius + edgeNoise;
+    int x0 = std::max((int)(cx - outer), 0);
+    int x1 = std::min((int)(cx + outer) + 1, width);
+    int y0 = std::max((int)(cy - outer), 0);
+    int y1 = std::min((int)(cy + outer) + 1, height);
+    int noiseRange = settings.depthNoise * 2 + 1;
+    for (int y = y0; y < y1; y++)
+    {
+        uint8_t* row = depth + (size_t)y * stride;
+        float dy = y - cy;
+        for (int x = x0; x < x1; x++)
+        {
+            float dx = x - cx;
+            float r = radius;
+            if (edgeNoise > 0)
+            {
+                r += ((int)(nextNoise() % 256) - 128) / 128.0f * edgeNoise;
+            }
+            if (dx * dx + dy * dy <= r * r)
+            {
+                row[x] = value == 0 ? 0 : (uint8_t)(value - settings.depthNoise + (int)(nextNoise() % noiseRange));
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "BubbleStore.h"
+#include "TrackedPoints.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+struct CrowdSettings {
+    float width = 1920;          // floor, same units as the game
+    float height = 1080;
+    float bodyRadius = 45;       // shoulders seen from above
+    float walkSpeed = 250;       // px/s, every walker varies it by up to 30%
+    float acceleration = 600;    // px/s^2, how quickly walkers turn and stop
+    float groupChance = 0.3f;    // walkers that walk next to another one, their blobs touch and merge
+    float splitRate = 0.1f;      // per walker and second, an arm or a bag shows up as a blob of its own for a moment
+    double maxPause = 3;         // seconds a walker stands at a waypoint, 0 to maxPause
+    float followChance = 0.8f;   // walkers sent to a bubble by setTargets() that actually go
+    float positionNoise = 6;     // px, centroid jitter of getDetections()
+    float dropoutChance = 0.02f; // per walker and frame, not seen at all
+    int depthNoise = 3;          // depth units, renderDepth() only
+    uint32_t seed = 1;
+};
+
+// People walking over the floor for load tests without a kinect. Walkers
+// head for random waypoints with limited acceleration, pause there, keep
+// their distance from strangers and walk side by side with a companion.
+// The crowd is either rendered into depth frames for the vision pipeline,
+// where touching people merge and arms split off by themselves, or turned
+// straight into the detections the vision would report, with the same
+// merges, splits, jitter and dropouts. Nothing in here touches
+// openFrameworks, the same seed gives the same crowd.
+class SyntheticCrowd {
+public:
+    static const int maxPeople = 100;
+
+    void setup(const CrowdSettings& settings);
+
+    // walkers that are added come in from the edge of the floor, removed ones walk out
+    void setPeople(int people);
+    int getNumPeople() const; // including the ones still walking out
+
+    // sends as many walkers into each bubble as it expects, the nearest ones
+    // first, until the next call. Buttons (negative amounts) are left alone
+    void setTargets(const BubbleStore& bubbles);
+    void clearTargets();
+
+    void update(double dt);
+
+    // one point per blob the vision would find, in floor coordinates, area in floor px^2
+    void getDetections(TrackedPointBuffer& points);
+
+    // 8 bit depth image of the whole floor like a kinect looking straight
+    // down: floor below 110, people at 170 to 200, sensor noise and shadows.
+    // Thresholds of 255 (near) and 150 (far) find the people
+    void renderDepth(uint8_t* depth, int width, int height, int stride);
+
+private:
+    struct Walker {
+        float x;
+        float y;
+        float vx;
+        float vy;
+        float speed;
+        float radius;
+        float targetX;
+        float targetY;
+        double pauseUntil;
+        int companion;      // walks next to this walker, -1 if alone
+        float sideX;        // companion offset
+        float sideY;
+        double armUntil;    // an arm or a bag sticks out until then
+        float armAngle;
+        bool assigned;      // picked for a bubble by setTargets()
+        bool inBubble;      // and actually going there, stands once it arrived
+        bool leaving;
+    };
+
+    float random(float min, float max);
+    uint32_t nextNoise();
+    void addWalker(bool atEdge);
+    void removeWalker(int index);
+    void pickWaypoint(Walker& walker);
+    void steer(int index, float dt);
+    void drawDisc(uint8_t* depth, int width, int height, int stride, float cx, float cy, float radius, uint8_t value, float edgeNoise);
+
+    CrowdSettings settings;
+    std::mt19937 generator;
+    uint32_t noiseState = 1;
+    double time = 0;
+
+    std::array<Walker, maxPeople> walkers;
+    int count = 0;
+
+    // getDetections(), one cluster per group of touching walkers
+    std::array<int, maxPeople> cluster;
+};
@@ -0,0 +1,96 @@
+#include "TextCache.h"
+
+void TextCache::setup(size_t maxEntries_)
+{
+    maxEntries = maxEntries_;
+    clear();
+}
+
+void TextCache::clear()
+{
+    fonts.clear();
+    numEntries = 0;
+}
+
+TextCache::Entry& TextCache::get(const FontAtlas& font, const std::string& text)
+{
+    std::map<std::string, Entry>& entries = fonts[&font];
+    auto found = entries.find(text);
+    if (found == entries.end())
+    {
+        if (numEntries >= maxEntries)
+        {
+            evict();
+        }
+        found = entries.emplace(text, Entry()).first;
+        numEntries++;
+
+        Entry& entry = found->second;
+        entry.mesh = font.getStringMesh(text, 0, 0, ofIsVFlipped());
+        entry.mesh.setUsage(GL_STATIC_DRAW);
+        entry.boundingBox = font.getStringBoundingBox(text, 0, 0);
+    }
+    found->second.lastUsedFrame = ofGetFrameNum();
+    return found->second;
+}
+
+void TextCache::evict()
+{
+    // everything not drawn this frame or the one before can go
+    uint64_t frame = ofGetFrameNum();
+    for (auto& font : fonts)
+    {
+        std::map<std::string, Entry>& entries = font.second;
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->second.lastUsedFrame + 1 < frame)
+            {
+                it = entries.erase(it);
+                numEntries--;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
+
+ofRectangle TextCache::getBoundingBox(const FontAtlas& font, const std::string& text)
+{
+    return get(font, text).boundingBox;
+}
+
+void TextCache::draw(const FontAtlas& font, const std::string& text, float x, float y)
+{
+    Entry& entry = get(font, text);
+
+    // what ofTrueTypeFont::drawString() does, minus building the mesh
+    ofPushStyle();
+    ofEnableAlphaBlending();
+    ofPushMatrix();
+    ofTranslate(x, y);
+    font.getFontTexture().bind();
+    entry.mesh.draw();
+    font.getFontTexture().unbind();
+    ofPopMatrix();
+    ofPopStyle();
+}
+
+void TextCache::drawCentered(const FontAtlas& font, const std::string& text, float x, float y)
+{
+    Entry& entry = get(font, text);
+    draw(font, text, x - entry.boundingBox.width / 2, y);
+}
+
+//--------------------------------------------------------------
+const std::string& NumberLabel::get(int value)
+{
+    if (!valid || value != shownValue)
+    {
+        text = prefix + ofToString(value);
+        shownValue = value;
+        valid = true;
+    }
+    return text;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FontAtlas.h"
+
+#include <map>
+#include <string>
+
+// Strings measured and tessellated once per (font, text). Drawing a cached
+// label is one mesh draw with the font atlas bound, no glyph lookups and no
+// re-measuring. Entries nobody drew for a while are dropped once the cache
+// grows past its limit, so changing numbers don't pile up.
+class TextCache {
+public:
+    void setup(size_t maxEntries = 256);
+    void clear();
+
+    ofRectangle getBoundingBox(const FontAtlas& font, const std::string& text);
+
+    // same origin as ofTrueTypeFont::drawString()
+    void draw(const FontAtlas& font, const std::string& text, float x, float y);
+    // horizontally centered on x
+    void drawCentered(const FontAtlas& font, const std::string& text, float x, float y);
+
+private:
+    struct Entry {
+        ofVboMesh mesh; // laid out at the origin
+        ofRectangle boundingBox;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    Entry& get(const FontAtlas& font, const std::string& text);
+    void evict();
+
+    size_t maxEntries = 256;
+    size_t numEntries = 0;
+    std::map<const FontAtlas*, std::map<std::string, Entry>> fonts;
+};
+
+// prefix plus a number, the string is only rebuilt when the number changes
+class NumberLabel {
+public:
+    explicit NumberLabel(const std::string& prefix_ = "") : prefix(prefix_) {}
+
+    const std::string& get(int value);
+
+private:
+    std::string prefix;
+    std::string text;
+    int shownValue = 0;
+    bool valid = false;
+};
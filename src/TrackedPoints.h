@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// one detected person in projector coordinates
+struct TrackedPoint {
+    float x;
+    float y;
+    float area;
+    uint32_t id;
+};
+
+// read-only view into a TrackedPointBuffer, cheap to pass by value
+struct TrackedPointSpan {
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* area = nullptr;
+    const uint32_t* id = nullptr;
+    int count = 0;
+
+    int size() const
+    {
+        return count;
+    }
+
+    TrackedPoint operator[](int i) const
+    {
+        return { x[i], y[i], area[i], id[i] };
+    }
+};
+
+// Fixed capacity structure-of-arrays storage for the points of one frame.
+// It lives as a member and is cleared and refilled every frame, so finding
+// blobs never touches the heap.
+class TrackedPointBuffer {
+public:
+    static const int capacity = 128;
+
+    void clear()
+    {
+        count = 0;
+    }
+
+    // returns false when the buffer is full and the point was dropped
+    bool push(float x_, float y_, float area_, uint32_t id_)
+    {
+        if (count >= capacity)
+        {
+            return false;
+        }
+        x[count] = x_;
+        y[count] = y_;
+        area[count] = area_;
+        id[count] = id_;
+        count++;
+        return true;
+    }
+
+    void set(int i, float x_, float y_, float area_, uint32_t id_)
+    {
+        x[i] = x_;
+        y[i] = y_;
+        area[i] = area_;
+        id[i] = id_;
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    TrackedPoint operator[](int i) const
+    {
+        return { x[i], y[i], area[i], id[i] };
+    }
+
+    TrackedPointSpan getSpan() const
+    {
+        TrackedPointSpan span;
+        span.x = x.data();
+        span.y = y.data();
+        span.area = area.data();
+        span.id = id.data();
+        span.count = count;
+        return span;
+    }
+
+private:
+    std::array<float, capacity> x;
+    std::array<float, capacity> y;
+    std::array<float, capacity> area;
+    std::array<uint32_t, capacity> id;
+    int count = 0;
+};
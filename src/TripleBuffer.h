@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer triple buffer.
+// The producer fills getWriteBuffer() and calls publish(), the consumer calls
+// update() and reads getReadBuffer(). Neither side ever blocks and the consumer
+// always sees the most recently published slot.
+template<typename T>
+class TripleBuffer {
+public:
+    // producer side
+    T& getWriteBuffer()
+    {
+        return buffers[writeIndex];
+    }
+
+    void publish()
+    {
+        uint8_t previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    // consumer side, returns true if a newer slot was swapped in
+    bool update()
+    {
+        if ((middle.load(std::memory_order_acquire) & freshBit) == 0)
+        {
+            return false;
+        }
+        uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    T& getReadBuffer()
+    {
+        return buffers[readIndex];
+    }
+
+    const T& getReadBuffer() const
+    {
+        return buffers[readIndex];
+    }
+
+    // only safe while neither side is running, e.g. to preallocate every slot
+    std::array<T, 3>& getAllBuffers()
+    {
+        return buffers;
+    }
+
+private:
+    static constexpr uint8_t indexMask = 0x3;
+    static constexpr uint8_t freshBit = 0x4;
+
+    std::array<T, 3> buffers;
+    uint8_t writeIndex = 0;
+    uint8_t readIndex = 1;
+    std::atomic<uint8_t> middle{ 2 };
+};
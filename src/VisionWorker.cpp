@@ -0,0 +1,346 @@
+#include "VisionWorker.h"
+#include "Profiler.h"
+#include "TrackedPoints.h"
+
+#include <algorithm>
+
+namespace {
+
+const int followMargin = 16; // sensor pixels around a blob that are processed in the next frame
+
+bool overlaps(const VisionRegion& a, const VisionRegion& b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+} // namespace
+
+VisionWorker::~VisionWorker()
+{
+    stop();
+}
+
+void VisionWorker::setup(int width, int height, Mode mode_, const std::string& name_, int labelStripes)
+{
+    mode = mode_;
+    name = name_;
+
+    depthThreshold.setup(width, height);
+    labeler.setup(width, height, labelStripes, name + " labeler");
+    // sized for the largest blob cap the settings can ask for
+    const int maxBlobs = TrackedPointBuffer::capacity;
+    labeledBlobs.reserve(maxBlobs * 2);
+    regions.reserve(VisionSettings::maxRegions + maxBlobs);
+    followRegions.reserve(maxBlobs);
+    coarseBlobs.reserve(maxBlobs);
+
+    for (DepthFrame& frame : frames.getAllBuffers())
+    {
+        frame.pixels.allocate(width, height, OF_IMAGE_GRAYSCALE);
+    }
+    for (VisionSnapshot& snapshot : snapshots.getAllBuffers())
+    {
+        snapshot.mask.allocate(width, height, OF_IMAGE_GRAYSCALE);
+        snapshot.mask.set(0);
+    }
+
+    if (mode == threaded)
+    {
+        startThread();
+    }
+}
+
+void VisionWorker::stop()
+{
+    if (isThreadRunning())
+    {
+        stopThread();
+        wakeCondition.notify_all();
+        waitForThread(false);
+    }
+}
+
+void VisionWorker::pushDepthFrame(const ofPixels& depth, const VisionSettings& settings)
+{
+    pushDepthFrame(depth, settings, ofGetElapsedTimeMicros());
+}
+
+void VisionWorker::pushDepthFrame(const ofPixels& depth, const VisionSettings& settings, uint64_t timestampMicros)
+{
+    DepthFrame& frame = frames.getWriteBuffer();
+    if (frame.pixels.getWidth() != depth.getWidth() || frame.pixels.getHeight() != depth.getHeight())
+    {
+        ofLogError("VisionWorker") << "depth frame has the wrong size: " << depth.getWidth() << "x" << depth.getHeight();
+        return;
+    }
+    std::memcpy(frame.pixels.getData(), depth.getData(), frame.pixels.getTotalBytes());
+    frame.settings = settings;
+    frame.sequence = nextSequence++;
+    frame.timestampMicros = timestampMicros;
+    frames.publish();
+
+    if (mode == synchronous)
+    {
+        frames.update();
+        process(frames.getReadBuffer(), snapshots.getWriteBuffer());
+        snapshots.publish();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        frameWaiting = true;
+    }
+    wakeCondition.notify_one();
+}
+
+bool VisionWorker::updateSnapshot()
+{
+    return snapshots.update();
+}
+
+const VisionSnapshot& VisionWorker::getSnapshot() const
+{
+    return snapshots.getReadBuffer();
+}
+
+VisionWorker::Mode VisionWorker::getMode() const
+{
+    return mode;
+}
+
+void VisionWorker::threadedFunction()
+{
+    Profiler::setThreadName(name.c_str());
+    while (isThreadRunning())
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(100), [this] { return frameWaiting || !isThreadRunning(); });
+            frameWaiting = false;
+        }
+
+        // frames that arrived while we were busy are skipped, only the newest one counts
+        if (frames.update())
+        {
+            process(frames.getReadBuffer(), snapshots.getWriteBuffer());
+            snapshots.publish();
+        }
+    }
+}
+
+void VisionWorker::process(const DepthFrame& frame, VisionSnapshot& snapshot)
+{
+    PROFILE_SCOPE("vision");
+    uint64_t processStart = ofGetElapsedTimeMicros();
+
+    // keep the pixels between the far and the near plane, straight into the published mask
+    const int width = depthThreshold.getWidth();
+    snapshot.coverage = 1;
+    if (frame.settings.useRegions)
+    {
+        snapshot.coverage = processRegions(frame, snapshot);
+    }
+    else
+    {
+        {
+            PROFILE_SCOPE("threshold");
+            depthThreshold.apply(frame.pixels.getData(), width, snapshot.mask.getData(), width,
+                frame.settings.nearThreshold, frame.settings.farThreshold, frame.settings.morphology);
+        }
+        {
+            // area, centroid and bounding box only, contours are traced by the debug view when it is shown
+            PROFILE_SCOPE("labelBlobs");
+            labeler.label(snapshot.mask.getData(), width, frame.settings.minBlobSize, frame.settings.maxBlobSize, frame.settings.maxBlobs, labeledBlobs);
+        }
+    }
+
+    // wherever someone is now gets processed in full next frame, even outside the regions of interest
+    followRegions.clear();
+    for (const LabeledBlob& blob : labeledBlobs)
+    {
+        VisionRegion region;
+        region.x = blob.minX - followMargin;
+        region.y = blob.minY - followMargin;
+        region.width = blob.maxX - blob.minX + 1 + 2 * followMargin;
+        region.height = blob.maxY - blob.minY + 1 + 2 * followMargin;
+        followRegions.push_back(region);
+    }
+
+    snapshot.sequence = frame.sequence;
+    snapshot.timestampMicros = frame.timestampMicros;
+    snapshot.blobs.resize(labeledBlobs.size());
+    for (size_t i = 0; i < labeledBlobs.size(); i++)
+    {
+        const LabeledBlob& blob = labeledBlobs[i];
+        VisionBlob& out = snapshot.blobs[i];
+        out.centroid = glm::vec2(blob.centroidX, blob.centroidY);
+        out.area = (float)blob.area;
+        out.boundingRect.set(blob.minX, blob.minY, blob.maxX - blob.minX + 1, blob.maxY - blob.minY + 1);
+        out.seed = glm::ivec2(blob.seedX, blob.seedY);
+    }
+    snapshot.processMicros = ofGetElapsedTimeMicros() - processStart;
+}
+
+float VisionWorker::processRegions(const DepthFrame& frame, VisionSnapshot& snapshot)
+{
+    const int width = depthThreshold.getWidth();
+    const int height = depthThreshold.getHeight();
+    const VisionSettings& settings = frame.settings;
+
+    regions.clear();
+    for (int i = 0; i < std::min(settings.numRegions, (int)VisionSettings::maxRegions); i++)
+    {
+        addRegion(settings.regions[i].x, settings.regions[i].y, settings.regions[i].width, settings.regions[i].height);
+    }
+    for (const VisionRegion& region : followRegions)
+    {
+        addRegion(region.x, region.y, region.width, region.height);
+    }
+
+    // overlapping regions become their bounding box, so no pixel is processed twice
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            for (size_t j = i + 1; j < regions.size();)
+            {
+                VisionRegion& a = regions[i];
+                const VisionRegion& b = regions[j];
+                if (!overlaps(a, b))
+                {
+                    j++;
+                    continue;
+                }
+                int x1 = std::max(a.x + a.width, b.x + b.width);
+                int y1 = std::max(a.y + a.height, b.y + b.height);
+                a.x = std::min(a.x, b.x);
+                a.y = std::min(a.y, b.y);
+                a.width = x1 - a.x;
+                a.height = y1 - a.y;
+                regions.erase(regions.begin() + j);
+                merged = true;
+            }
+        }
+    }
+
+    int pixels = 0;
+    {
+        PROFILE_SCOPE("threshold");
+        uint8_t* mask = snapshot.mask.getData();
+        std::memset(mask, 0, (size_t)width * height);
+        for (const VisionRegion& region : regions)
+        {
+            size_t offset = (size_t)region.y * width + region.x;
+            depthThreshold.applyRegion(frame.pixels.getData() + offset, width, mask + offset, width, region.width, region.height,
+                settings.nearThreshold, settings.farThreshold, settings.morphology);
+            pixels += region.width * region.height;
+        }
+    }
+    {
+        // empty rows of the mask cost the labeler one compare per eight pixels
+        PROFILE_SCOPE("labelBlobs");
+        labeler.label(snapshot.mask.getData(), width, settings.minBlobSize, settings.maxBlobSize, settings.maxBlobs, labeledBlobs);
+    }
+
+    if (--framesUntilCoarse <= 0)
+    {
+        framesUntilCoarse = settings.coarseInterval;
+        scanCoarse(frame);
+    }
+    return (float)pixels / (width * height);
+}
+
+void VisionWorker::scanCoarse(const DepthFrame& frame)
+{
+    PROFILE_SCOPE("coarseScan");
+    const int width = depthThreshold.getWidth();
+    const int height = depthThreshold.getHeight();
+    const int scale = std::max(frame.settings.coarseScale, 1);
+    const int coarseWidth = width / scale;
+    const int coarseHeight = height / scale;
+    if (scale != coarseScale)
+    {
+        coarseScale = scale;
+        coarseThreshold.setup(coarseWidth, coarseHeight);
+        coarseLabeler.setup(coarseWidth, coarseHeight, 1);
+        coarseDepth.assign((size_t)coarseWidth * coarseHeight, 0);
+        coarseMask.assign((size_t)coarseWidth * coarseHeight, 0);
+    }
+
+    // every scale-th pixel of every scale-th row
+    const uint8_t* depth = frame.pixels.getData();
+    for (int y = 0; y < coarseHeight; y++)
+    {
+        const uint8_t* src = depth + (size_t)y * scale * width;
+        uint8_t* dst = &coarseDepth[(size_t)y * coarseWidth];
+        for (int x = 0; x < coarseWidth; x++)
+        {
+            dst[x] = src[x * scale];
+        }
+    }
+    coarseThreshold.apply(coarseDepth.data(), coarseWidth, coarseMask.data(), coarseWidth,
+        frame.settings.nearThreshold, frame.settings.farThreshold, frame.settings.morphology);
+    const int pixelArea = scale * scale;
+    coarseLabeler.label(coarseMask.data(), coarseWidth, frame.settings.minBlobSize / pixelArea, frame.settings.maxBlobSize / pixelArea, frame.settings.maxBlobs, coarseBlobs);
+
+    // people touching a region were already seen there, at least in part, and
+    // are followed in full from the next frame on. The others join the result
+    // at coarse precision and are followed from then on too
+    bool added = false;
+    for (const LabeledBlob& coarse : coarseBlobs)
+    {
+        LabeledBlob blob;
+        blob.minX = coarse.minX * scale;
+        blob.minY = coarse.minY * scale;
+        blob.maxX = std::min(coarse.maxX * scale + scale - 1, width - 1);
+        blob.maxY = std::min(coarse.maxY * scale + scale - 1, height - 1);
+        VisionRegion bounds;
+        bounds.x = blob.minX;
+        bounds.y = blob.minY;
+        bounds.width = blob.maxX - blob.minX + 1;
+        bounds.height = blob.maxY - blob.minY + 1;
+        bool seen = false;
+        for (const VisionRegion& region : regions)
+        {
+            seen = seen || overlaps(region, bounds);
+        }
+        if (seen)
+        {
+            continue;
+        }
+        blob.centroidX = coarse.centroidX * scale;
+        blob.centroidY = coarse.centroidY * scale;
+        blob.area = coarse.area * pixelArea;
+        blob.seedX = -1; // not in the full resolution mask, the debug view only draws its box
+        blob.seedY = -1;
+        labeledBlobs.push_back(blob);
+        added = true;
+    }
+    if (added)
+    {
+        std::sort(labeledBlobs.begin(), labeledBlobs.end(), [](const LabeledBlob& a, const LabeledBlob& b) { return a.area > b.area; });
+        labeledBlobs.resize(std::min((int)labeledBlobs.size(), frame.settings.maxBlobs));
+    }
+}
+
+void VisionWorker::addRegion(int x, int y, int width, int height)
+{
+    // clipped to the frame
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + width, depthThreshold.getWidth());
+    int y1 = std::min(y + height, depthThreshold.getHeight());
+    if (x1 <= x0 || y1 <= y0)
+    {
+        return;
+    }
+    VisionRegion region;
+    region.x = x0;
+    region.y = y0;
+    region.width = x1 - x0;
+    region.height = y1 - y0;
+    regions.push_back(region);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "ofMain.h"
+#include "TripleBuffer.h"
+#include "DepthThreshold.h"
+#include "BlobLabeler.h"
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// rectangle in sensor pixels
+struct VisionRegion {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// slider values the depth pipeline needs, copied with every frame so the
+// worker never touches the gui
+struct VisionSettings {
+    int nearThreshold = 0;
+    int farThreshold = 255;
+    int minBlobSize = 0;
+    int maxBlobSize = 76800;
+    int maxBlobs = 10; // largest blobs kept per frame, at most TrackedPointBuffer::capacity are tracked
+    DepthThreshold::Morphology morphology = DepthThreshold::none;
+
+    // Regions of interest, e.g. the bubbles of the current round. With
+    // useRegions set only they and boxes around the blobs of the previous
+    // frame are processed at full resolution. The rest of the frame is
+    // scanned at 1 / coarseScale resolution every coarseInterval frames to
+    // find people walking in, who are then followed at full resolution.
+    static const int maxRegions = 16;
+    bool useRegions = false;
+    std::array<VisionRegion, maxRegions> regions;
+    int numRegions = 0;
+    int coarseScale = 2;    // 2 or 4
+    int coarseInterval = 4; // frames
+};
+
+struct VisionBlob {
+    glm::vec2 centroid;
+    float area = 0;
+    ofRectangle boundingRect;
+    glm::ivec2 seed; // a pixel of the blob in the mask, the debug view traces the contour from there
+};
+
+// result of one depth frame, never modified after it has been published
+struct VisionSnapshot {
+    uint64_t sequence = 0;        // increases by one per processed depth frame
+    uint64_t timestampMicros = 0; // ofGetElapsedTimeMicros() when the depth frame arrived
+    uint64_t processMicros = 0;   // time the worker spent on this frame
+    float coverage = 1;           // share of the frame processed at full resolution
+    std::vector<VisionBlob> blobs;
+    ofPixels mask;                // thresholded depth image
+};
+
+class VisionWorker : public ofThread {
+public:
+    enum Mode
+    {
+        threaded = 0,
+        synchronous = 1 // process inside pushDepthFrame(), for deterministic tests
+    };
+
+    ~VisionWorker();
+
+    // name shows in the profiler. labelStripes is how many threads find the blobs
+    // of one frame, 0 for one per core
+    void setup(int width, int height, Mode mode = threaded, const std::string& name = "vision", int labelStripes = 0);
+    void stop();
+
+    // render thread: hand over a new depth frame, returns immediately in threaded mode
+    void pushDepthFrame(const ofPixels& depth, const VisionSettings& settings);
+    // same with the capture time given, e.g. the recorded time during replay
+    void pushDepthFrame(const ofPixels& depth, const VisionSettings& settings, uint64_t timestampMicros);
+
+    // render thread: swap in the newest snapshot, returns true if it changed
+    bool updateSnapshot();
+    const VisionSnapshot& getSnapshot() const;
+
+    Mode getMode() const;
+
+private:
+    struct DepthFrame {
+        ofPixels pixels;
+        VisionSettings settings;
+        uint64_t sequence = 0;
+        uint64_t timestampMicros = 0;
+    };
+
+    void threadedFunction() override;
+    void process(const DepthFrame& frame, VisionSnapshot& snapshot);
+    // threshold and label only the regions of interest, returns the share of the frame they cover
+    float processRegions(const DepthFrame& frame, VisionSnapshot& snapshot);
+    void scanCoarse(const DepthFrame& frame);
+    void addRegion(int x, int y, int width, int height);
+
+    Mode mode = threaded;
+    std::string name;
+    uint64_t nextSequence = 1;
+
+    TripleBuffer<DepthFrame> frames;
+    TripleBuffer<VisionSnapshot> snapshots;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool frameWaiting = false;
+
+    // owned by the worker thread once it is running
+    DepthThreshold depthThreshold;
+    BlobLabeler labeler;
+    std::vector<LabeledBlob> labeledBlobs;
+
+    // region of interest mode
+    std::vector<VisionRegion> regions;       // this frame's, merged so none overlap
+    std::vector<VisionRegion> followRegions; // around the blobs of the previous frame
+    int framesUntilCoarse = 0;
+    int coarseScale = 0;
+    DepthThreshold coarseThreshold;
+    BlobLabeler coarseLabeler;
+    std::vector<uint8_t> coarseDepth;
+    std::vector<uint8_t> coarseMask;
+    std::vector<LabeledBlob> coarseBlobs;
+};
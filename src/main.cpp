@@ -1,8 +1,82 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "Benchmarks.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char* argv[]){
+
+	// headless: CrazyBubbles --benchmark-pipeline <recording.cbd | synthetic> [report.json] [near far]
+	if (argc >= 3 && std::string(argv[1]) == "--benchmark-pipeline")
+	{
+		VisionSettings settings;
+		if (argc >= 6)
+		{
+			settings.nearThreshold = ofToInt(argv[4]);
+			settings.farThreshold = ofToInt(argv[5]);
+		}
+		runPipelineBenchmark(argv[2], settings, argc >= 4 ? argv[3] : "");
+		return 0;
+	}
+
+	// headless: CrazyBubbles --benchmark-labeler [recording.cbd | synthetic] [near far]
+	if (argc >= 2 && std::string(argv[1]) == "--benchmark-labeler")
+	{
+		VisionSettings settings;
+		if (argc >= 5)
+		{
+			settings.nearThreshold = ofToInt(argv[3]);
+			settings.farThreshold = ofToInt(argv[4]);
+		}
+		runLabelerBenchmark(argc >= 3 ? argv[2] : "", settings);
+		return 0;
+	}
+
+	// headless: CrazyBubbles --benchmark-sensors [max sensors]
+	if (argc >= 2 && std::string(argv[1]) == "--benchmark-sensors")
+	{
+		runSensorScalingBenchmark(argc >= 3 ? ofToInt(argv[2]) : 4);
+		return 0;
+	}
+
+	// headless: CrazyBubbles --benchmark-network [port]
+	if (argc >= 2 && std::string(argv[1]) == "--benchmark-network")
+	{
+		runNetworkBenchmark(argc >= 3 ? ofToInt(argv[2]) : 12000);
+		return 0;
+	}
+
+	// headless: CrazyBubbles --soak [games] [people] [depth | points] [report.json]
+	if (argc >= 2 && std::string(argv[1]) == "--soak")
+	{
+		runSoakTest(argc >= 3 ? ofToInt(argv[2]) : 1000, argc >= 4 ? ofToInt(argv[3]) : 20,
+			argc < 5 || std::string(argv[4]) != "points", argc >= 6 ? argv[5] : "");
+		return 0;
+	}
+
+	// headless: CrazyBubbles --benchmark-audio
+	if (argc >= 2 && std::string(argv[1]) == "--benchmark-audio")
+	{
+		runAudioBenchmark();
+		return 0;
+	}
+
+	// headless: CrazyBubbles --test-vision [recording.cbd | synthetic] [near far], exits with 1 on a difference
+	if (argc >= 2 && std::string(argv[1]) == "--test-vision")
+	{
+		VisionSettings settings;
+		if (argc >= 5)
+		{
+			settings.nearThreshold = ofToInt(argv[3]);
+			settings.farThreshold = ofToInt(argv[4]);
+		}
+		return runVisionCheck(argc >= 3 ? argv[2] : "", settings) ? 0 : 1;
+	}
+
+	// headless: CrazyBubbles --test-simulation, exits with 1 if the frame rate changed the game
+	if (argc >= 2 && std::string(argv[1]) == "--test-simulation")
+	{
+		return runSimulationCheck() ? 0 : 1;
+	}
 
 	//Use ofGLFWWindowSettings for more options like multi-monitor fullscreen
 	ofGLWindowSettings settings;
@@ -1,92 +1,146 @@
 #include "ofApp.h"
+#include "Benchmarks.h"
+#include "AllocationCounter.h"
 #include <iostream>
+#include <iomanip>
+#include <sstream>
 
 // setup
 int amountOfPlayers = 4;
 const int roundAmount = 5;
 const int roundTime = 3; // in seconds
-int waitTime = 2;       // time to stay in circle before game starts (in frames)
+const double cooldownTime = 2; // in seconds, pause between two rounds
+int waitTime = 2;       // time to stay in circle before game starts (in clicks)
 
 //const bool drawKinect = true;
 const bool noKinect = false; // set this to true if testing without a kinect (and test with mouse clicks)
-
-// global variables
-int amountCorrect = 0;
-int frame = 0;
-std::chrono::seconds duration(roundTime);
-auto startTime = std::chrono::steady_clock::now();
-
-int score = 0;
-bool newRound = false;
-int numberOfPeople;
-int amountOfCircles = 0;
-int rounds = 1;
-
-float myMouseX = -1;
-float myMouseY = -1;
-
-int framesInCircle = 0;
-
-int highscore = -1;
+const bool threadedVision = true; // set this to false to run the depth pipeline synchronously (deterministic testing)
+const int numSensors = 1; // kinects covering the floor, each calibrated with the sliders after picking it with "Sensor"
+const std::vector<std::string> replayFiles = {}; // per sensor, a depth recording in data/ (key 'r' records one) to play instead of the kinect
+const double replaySpeed = 1; // 1 = real time, 0 = as fast as frames decode
+const bool visionRegions = true; // process the depth image in full only under the bubbles and around people
+const int coarseScale = 2; // the rest is scanned for people walking in at half (2) or quarter (4) resolution
+const int coarseInterval = 4; // every this many depth frames
+const int frameStatsFrames = 600; // frames captured per 'B'
+const std::string publishHost = ""; // sensing box: send people and game state of every vision frame here, a render node or e.g. "192.168.1.255"
+const bool renderNode = false; // no game and no kinect input here, draw what the sensing box publishes
+const int networkPort = 12000;
+const int syntheticPeople = 0; // > 0: that many synthetic people walk the floor instead of the kinect input, '+'/'-' change it
+const bool syntheticDepth = true; // render them into depth frames for the vision, otherwise their points go straight to the tracker
+const bool soundOutput = true; // false mixes into the null audio output, for boxes without a sound card
+const int audioSampleRate = 44100;
+const int audioBufferFrames = 256; // 5.8 ms at 44.1 kHz, the most a sound can come late
+
+// stages of frameStats
+enum FrameStage
+{
+    kinectStage,
+    visionStage,
+    detectionStage,
+    simulationStage,
+    drawCirclesStage,
+    drawKinectStage,
+    drawStage,
+    endToEndStage // depth frame arrival until its blobs are drawn
+};
 
 //--------------------------------------------------------------
 void ofApp::setup()
 {
     ofLog() << "Setup";
+    startup.begin();
+    Profiler::setThreadName("main");
     if (noKinect)
     {
         waitTime = 3;
         amountOfPlayers = 1;
     }
     ofSetLogLevel(OF_LOG_VERBOSE);
+    ofSetFrameRate(60);
+    ofSeedRandom();
 
-    setupKinect();
+    // only queues the slow parts, update() works through them behind a splash
     setupGui();
+    setupKinect();
     setupAssets();
-    setupMainMenu();
-    ofLog() << "Setup Complete" << endl;
+    startup.addWorker("scores", [this]() { scores.setup(ofToDataPath("scores")); });
+    startup.addStep("game", [this]() { setupGame(); }, { "vision", "fonts", "renderer", "audio", "scores" });
 }
 
-void ofApp::startGame()
+void ofApp::setupGame()
 {
-    circles.clear();
-    amountCorrect = 0;
-    frame = 0;
-    score = 0;
-    amountOfCircles = 0;
-    rounds = 1;
-    numberOfPeople = amountOfPlayers;
-    gameState = gameLoop;
-    newRound = true;
-    startTime = std::chrono::steady_clock::now();
+    frameStats.setup({ "updateKinect", "vision", "updateDetections", "simulation", "drawCircles", "drawKinectImages", "draw", "endToEnd" }, frameStatsFrames);
+
+    GameSettings settings;
+    settings.roundAmount = roundAmount;
+    settings.roundTime = roundTime;
+    settings.cooldownTime = cooldownTime;
+    settings.waitTime = waitTime;
+    settings.amountOfPlayers = amountOfPlayers;
+    settings.width = ofGetWidth();
+    settings.height = ofGetHeight();
+    settings.seed = (uint32_t)ofRandom(0, 4294967295.0f);
+    simulation.setup(settings, ofGetElapsedTimeMicros() / 1000000.0);
+    handleOutputs();
+    simulation.getSnapshot(game);
+
+    if (renderNode)
+    {
+        receiver.setup(networkPort);
+    }
+    else if (publishHost != "")
+    {
+        publisher.setup(publishHost, networkPort);
+    }
+    ofLog() << "Setup Complete" << endl;
 }
 
 void ofApp::setupKinect()
 {
-    // enable depth->video image calibration
-    kinect.setRegistration(true);
-    kinect.init();
-    kinect.open();
-
-    // print the intrinsic IR sensor values
-    if (kinect.isConnected())
+    SensorSettings settings;
+    settings.count = numSensors;
+    settings.replayFiles = replayFiles;
+    settings.replaySpeed = replaySpeed;
+    settings.visionMode = threadedVision ? VisionWorker::threaded : VisionWorker::synchronous;
+    settings.floorWidth = ofGetWidth();
+    settings.floorHeight = ofGetHeight();
+    if (syntheticPeople > 0)
     {
-        ofLogNotice() << "sensor-emitter dist: " << kinect.getSensorEmitterDistance() << "cm";
-        ofLogNotice() << "sensor-camera dist:  " << kinect.getSensorCameraDistance() << "cm";
-        ofLogNotice() << "zero plane pixel size: " << kinect.getZeroPlanePixelSize() << "mm";
-        ofLogNotice() << "zero plane dist: " << kinect.getZeroPlaneDistance() << "mm";
+        CrowdSettings crowdSettings;
+        crowdSettings.width = ofGetWidth();
+        crowdSettings.height = ofGetHeight();
+        crowdSettings.seed = (uint32_t)ofRandom(0, 4294967295.0f);
+        crowd.setup(crowdSettings);
+        crowdSize = syntheticPeople;
+        crowd.setPeople(crowdSize);
+        if (syntheticDepth)
+        {
+            settings.crowd = &crowd;
+        }
     }
 
-    colorImg.allocate(kinect.width, kinect.height);
-    grayImage.allocate(kinect.width, kinect.height);
-    grayThreshNear.allocate(kinect.width, kinect.height);
-    grayThreshFar.allocate(kinect.width, kinect.height);
+    // opening the devices blocks for seconds, the splash keeps drawing meanwhile
+    startup.addWorker("sensors", [this, settings]()
+    {
+        calibrationsLoaded = sensors.loadCalibrations(ofToDataPath("sensors.json"));
+        sensors.open(settings);
+    });
 
-    ofSetFrameRate(60);
+    startup.addStep("vision", [this]()
+    {
+        sensors.setupVision();
+        sensorsReady = true;
+        // first start without sensors.json: sensor 0 takes over the slider calibration
+        if (!calibrationsLoaded)
+        {
+            sensors.setCalibration(0, getSliderCalibration());
+        }
+        showSensorCalibration(getSelectedSensor());
 
-    // zero the tilt on startup
-    angle = 0;
-    kinect.setCameraTiltAngle(angle);
+        const DepthSource& source = *sensors.getSensor(0).source;
+        debugView.setup(source.getWidth(), source.getHeight(), ofxKinect::width, ofxKinect::height);
+        tracker.setup(TrackerSettings());
+    }, { "sensors" });
 }
 
 void ofApp::setupGui()
@@ -96,6 +150,9 @@ void ofApp::setupGui()
     gui.add(farThreshold.setup("Far Threshold", 255, 0, 255));
     gui.add(minBlobSize.setup("Min Blob Size", 0, 0, 76800));
     gui.add(maxBlobSize.setup("Max Blob Size", 76800, 0, 76800));
+    gui.add(maskFilter.setup("Mask Filter (open/close)", 0, 0, 2));
+
+    gui.add(sensorIndex.setup("Sensor", 0, 0, numSensors - 1));
 
     gui.add(translateX.setup("Translate X", 0.0, -1.0 * ofGetWidth() / 2, ofGetWidth() / 2));
     gui.add(translateY.setup("Translate Y", 0.0, -1.0 * ofGetHeight() / 2, ofGetHeight() / 2));
@@ -104,291 +161,427 @@ void ofApp::setupGui()
     gui.add(scaleY.setup("Scale Y", 1.0, 0.5, 2.0));
 
     gui.add(drawKinect.setup("Draw Kinect", true));
+    gui.add(drawProfilerOverlay.setup("Profiler", false));
 
     nearThreshold.setSize(500, 50);
     farThreshold.setSize(500, 50);
     minBlobSize.setSize(500, 50);
     maxBlobSize.setSize(500, 50);
+    maskFilter.setSize(500, 50);
+    sensorIndex.setSize(500, 50);
     translateX.setSize(500, 50);
     translateY.setSize(500, 50);
     rotateAngle.setSize(500, 50);
     scaleX.setSize(500, 50);
     scaleY.setSize(500, 50);
 
+    translateX.addListener(this, &ofApp::calibrationChanged);
+    translateY.addListener(this, &ofApp::calibrationChanged);
+    rotateAngle.addListener(this, &ofApp::calibrationChanged);
+    scaleX.addListener(this, &ofApp::calibrationChanged);
+    scaleY.addListener(this, &ofApp::calibrationChanged);
+    sensorIndex.addListener(this, &ofApp::sensorChanged);
+
     gui.setSize(600, 500);
     ofxGuiSetFont("assets/impact.ttf", 20);
     gui.loadFromFile("kinect_settings.json");
+    if (syntheticPeople > 0 && syntheticDepth)
+    {
+        // where SyntheticCrowd::renderDepth() puts the people
+        nearThreshold = 255;
+        farThreshold = 150;
+    }
 
 }
 
 void ofApp::setupAssets()
 {
-    // load assets
-    title.load("assets/RammettoOne.ttf", 110);
-    font.load("assets/impact.ttf", 50);
-    headerFont.load("assets/RammettoOne.ttf", 80);
-
-    correct.load("assets/correct.wav");
-    correct.setLoop(false);
-    incorrect.load("assets/incorrect2.mp3");
-    incorrect.setLoop(false);
-    outro.load("assets/outro.wav");
-    outro.setLoop(false);
-    background.load("assets/background.wav");
-    background.setLoop(true);
-    background.play();
-
-    ofSeedRandom();
+    // glyph atlases are rasterized in parallel, or read back from data/cache/fonts
+    std::string fontCache = ofToDataPath("cache/fonts");
+    startup.addWorker("font title", [this, fontCache]() { FontAtlas::build(ofToDataPath("assets/RammettoOne.ttf"), 110, fontCache, titleData); });
+    startup.addWorker("font", [this, fontCache]() { FontAtlas::build(ofToDataPath("assets/impact.ttf"), 50, fontCache, fontData); });
+    startup.addWorker("font header", [this, fontCache]() { FontAtlas::build(ofToDataPath("assets/RammettoOne.ttf"), 80, fontCache, headerFontData); });
+    startup.addStep("fonts", [this]()
+    {
+        title.load(titleData);
+        font.load(fontData);
+        headerFont.load(headerFontData);
+        textCache.setup();
+    }, { "font title", "font", "font header" });
+
+    startup.addStep("renderer", [this]() { bubbleRenderer.setup(); });
+
+    // every cue is decoded to PCM by a worker of its own, nothing reads a file once the game runs
+    const char* soundFiles[numSounds] = { "assets/correct.wav", "assets/incorrect2.wav", "assets/outro.wav", "assets/background.wav" };
+    std::vector<std::string> soundWorkers;
+    for (int i = 0; i < numSounds; i++)
+    {
+        std::string file = soundFiles[i];
+        soundWorkers.push_back("sound " + file);
+        startup.addWorker(soundWorkers.back(), [this, i, file]()
+        {
+            std::string error;
+            if (!AudioMixer::decodeWav(ofToDataPath(file), audioSampleRate, sounds[i], error))
+            {
+                ofLogWarning("AudioEngine") << error << ", the cue stays silent";
+            }
+            sounds[i].loop = i == backgroundSound;
+            sounds[i].music = i == backgroundSound;
+        });
+    }
+    startup.addStep("audio", [this]()
+    {
+        audio.setup(audioSampleRate, audioBufferFrames);
+        for (AudioCue& sound : sounds)
+        {
+            audio.addCue(std::move(sound));
+        }
+        audio.start(soundOutput ? AudioEngine::soundCard : AudioEngine::nullOutput);
+        audio.play(backgroundSound);
+    }, soundWorkers);
 }
 
-void ofApp::setupMainMenu()
+//--------------------------------------------------------------
+void ofApp::update()
 {
-    background.setVolume(1);
-    framesInCircle = 0;
-    gameState = mainMenu;
-    circles.clear();
-    ofColor bigCircleColor = generateRandomColor(100, 200);
-    circles.push_back(Circle(ofGetWidth() / 2, ofGetHeight() / 2 - 100, 400, bigCircleColor, -2));
+    if (!startup.isDone())
+    {
+        startup.update();
+        return;
+    }
+
+    PROFILE_SCOPE("update");
+    if (renderNode)
+    {
+        updateFromNetwork();
+        return;
+    }
+    frameStartAllocations = getAllocationCount();
+    if (syntheticPeople > 0)
+    {
+        crowd.update(ofGetLastFrameTime());
+    }
+    uint64_t stageStart = ofGetElapsedTimeMicros();
+    updateKinect();
+    addFrameSample(kinectStage, stageStart);
 
-    int numCircles = 8;
-    float circleDiameter = 200;
-    float spacing = 50;
-    float totalWidth = numCircles * circleDiameter + (numCircles - 3) * spacing;
-    float startX = (ofGetWidth() - totalWidth) / 2;
+    stageStart = ofGetElapsedTimeMicros();
+    updateDetections();
+    addFrameSample(detectionStage, stageStart);
 
-    for (int i = 0; i < numCircles; i++) {
-        ofColor randomColor = generateRandomColor(200, 255);
-        float x = startX + i * (circleDiameter + spacing);
-        float y = ofGetHeight() - 200;
-        circles.push_back(Circle(x, y, circleDiameter / 2, randomColor, i + 1));
+    // the simulation runs on its own fixed ticks, the frame only hands over input
+    stageStart = ofGetElapsedTimeMicros();
+    double now = stageStart / 1000000.0;
+    {
+        PROFILE_SCOPE("simulation");
+        // nobody plays while the floor is being calibrated
+        simulation.pushPeople(now, calibration.isActive() ? TrackedPointSpan() : trackedPoints.getSpan());
+        simulation.advance(now);
+        handleOutputs();
+        simulation.getSnapshot(game);
     }
+    addFrameSample(simulationStage, stageStart);
+    publishFrame();
 }
 
-void ofApp::setupEndScreen()
+void ofApp::publishFrame()
 {
-    background.setVolume(0.2);
-    outro.play();
-    framesInCircle = 0;
-    gameState = endScreen;
-    circles.clear();
-    ofColor randomColor = generateRandomColor(100, 200);
-    circles.push_back(Circle(ofGetWidth() / 2, ofGetHeight() - 650, 360, randomColor, -3));
-    highscore = getHighScoreFromFile();
-    if (score > highscore)
+    if (!publisher.isOpen())
     {
-        highscore = -1;
+        return;
     }
-    writeToFile(score);
-}
-//--------------------------------------------------------------
-void ofApp::update()
-{
-    updateKinect();
-    if (gameState == gameLoop)
+
+    // once per vision frame, without a kinect at about the same rate so render nodes still follow mouse play
+    uint64_t now = ofGetElapsedTimeMicros();
+    if (publishedVisionSequence == sensors.getSequence() && now - lastPublishMicros < 33333)
     {
-        //ofLog() << "update game loop";
-        ofApp::updateCircles();
-        ofApp::updateContours();
-        //ofLog() << "update complete";
+        return;
     }
-    else if (gameState == mainMenu)
+    publishedVisionSequence = sensors.getSequence();
+    lastPublishMicros = now;
+
+    networkFrame.timestampMicros = publishedVisionSequence != 0 ? sensors.getNewestTimestampMicros() : now;
+    networkFrame.game = game;
+    networkFrame.highscore = highscore;
+    networkFrame.bubbleColors = circleColors;
+    networkFrame.people = trackedPoints;
+    publisher.publish(networkFrame);
+}
+
+void ofApp::updateFromNetwork()
+{
+    PROFILE_SCOPE("receive");
+    if (!receiver.update())
     {
-        //ofLog() << "update main menu";
-        ofApp::updateMainMenu();
-        //ofLog() << "update complete";
+        return;
     }
-    else if (gameState == endScreen)
+
+    // the sensing box picked the colors, so every node shows the same ones
+    const NetworkFrame& frame = receiver.getFrame();
+    if (frame.game.layout != game.layout || frame.session != receivedSession)
     {
-        //ofLog() << "update end screen";
-        ofApp::updateEndScreen();
-        //ofLog() << "update complete";
+        receivedSession = frame.session;
+        for (int i = 0; i < frame.game.bubbles.size(); i++)
+        {
+            circleColors[i] = frame.bubbleColors[i];
+            circleLabels[i] = ofToString(frame.game.bubbles.getExpectedAmount(i));
+        }
     }
-    myMouseX = -1;
-    myMouseY = -1;
+    game = frame.game;
+    highscore = frame.highscore;
 }
 
-void ofApp::updateEndScreen()
+void ofApp::handleOutputs()
 {
-    if (circles.size() > 0)
+    // sounds are only queued here, timed from the tick that raised them
+    uint64_t eventMicros = (uint64_t)(simulation.getTime() * 1000000.0);
+    for (GameOutput output : simulation.getOutputs())
     {
-        if (isPointInCircle(myMouseX, myMouseY, circles[0].x, circles[0].y, circles[0].radius) == true)
+        switch (output)
         {
-            framesInCircle++;
-            if (framesInCircle >= waitTime)
+        case GameOutput::menuEntered:
+            audio.duck(1);
+            break;
+        case GameOutput::gameStarted:
+            ofLog() << "Starting game...";
+            break;
+        case GameOutput::roundWon:
+            audio.duck(0.2f);
+            highscore = -1;
+            audio.play(correctSound, eventMicros);
+            break;
+        case GameOutput::roundLost:
+            audio.duck(0.2f);
+            highscore = -1;
+            audio.play(incorrectSound, eventMicros);
+            break;
+        case GameOutput::roundStarted:
+            audio.duck(1);
+            break;
+        case GameOutput::gameEnded:
+            audio.duck(0.2f);
+            audio.play(outroSound, eventMicros);
+            highscore = scores.getHighScore(simulation.getAmountOfPlayers(), simulation.getRoundAmount());
+            if (simulation.getScore() > highscore)
             {
-                setupMainMenu();
+                highscore = -1;
             }
+            scores.addScore(simulation.getAmountOfPlayers(), simulation.getRoundAmount(), simulation.getScore());
+            break;
+        case GameOutput::layoutChanged:
+            updateCircleColors();
+            // the synthetic people play along, the next round's bubbles appear during the cooldown
+            if (simulation.getState() == gameLoop || simulation.getState() == cooldown)
+            {
+                crowd.setTargets(simulation.getBubbles());
+            }
+            else
+            {
+                crowd.clearTargets();
+            }
+            break;
+        case GameOutput::playersChanged:
+            ofLog() << "amountOfPlayers: " << simulation.getAmountOfPlayers();
+            break;
         }
     }
-    
+    simulation.clearOutputs();
 }
 
-void ofApp::updateMainMenu()
+void ofApp::updateKinect()
 {
-    if (circles.size() > 0)
+    PROFILE_SCOPE("updateKinect");
+    // calibration targets can be anywhere, otherwise only the bubbles matter
+    if (visionRegions && !calibration.isActive())
+    {
+        sensors.setRegionsOfInterest(simulation.getBubbles());
+    }
+    else
     {
-        for (int j = 1; j < circles.size(); j++)
+        sensors.clearRegionsOfInterest();
+    }
+    sensors.update(getVisionSettings());
+
+    // the selected sensor feeds the recorder and the debug view
+    SensorManager::Sensor& sensor = sensors.getSensor(getSelectedSensor());
+    if (sensor.source->isFrameNew())
+    {
+        if (recorder.isOpen())
+        {
+            recorder.addFrame(sensor.source->getDepthPixels(), sensor.source->getFrameTimestampMicros());
+        }
+        if (drawKinect)
         {
-            if (isPointInCircle(myMouseX, myMouseY, circles[j].x, circles[j].y, circles[j].radius) == true)
+            debugView.updateDepth(sensor.source->getDepthPixels());
+            if (sensor.kinect)
             {
-                amountOfPlayers = circles[j].expectedAmount;
-                ofLog() << "amountOfPlayers: " << amountOfPlayers;
+                debugView.updateColor(sensor.kinect->getPixels());
             }
         }
+    }
 
-        if (isPointInCircle(myMouseX, myMouseY, circles[0].x, circles[0].y, circles[0].radius) == true)
+    for (int i = 0; i < sensors.size(); i++)
+    {
+        if (capturingFrameStats && sensors.getSensor(i).snapshotNew)
         {
-            framesInCircle++;
-            if (framesInCircle >= waitTime)
-            {
-                ofLog() << "Starting game...";
-                startGame();
-            }
-         }
+            frameStats.addSample(visionStage, (double)sensors.getSensor(i).vision.getSnapshot().processMicros);
+        }
+    }
+    if (drawKinect && sensor.snapshotNew)
+    {
+        debugView.updateContours(sensor.vision.getSnapshot());
+    }
+    if (calibration.isActive() && sensor.snapshotNew)
+    {
+        updateHomographyCalibration(sensor.vision.getSnapshot());
     }
 }
 
-void ofApp::updateContours()
+void ofApp::startHomographyCalibration()
 {
-    auto blobs = ofApp::findBlobs();
-    for (int i = 0; i < blobs.size(); i++)
+    // a 3x3 grid of targets inset from the edges of the projection
+    std::vector<glm::vec2> targets;
+    for (int y = 0; y < 3; y++)
     {
-        vector<float> coordinates = blobs[i];
-        if (coordinates.at(0) >= 0)
+        for (int x = 0; x < 3; x++)
         {
-            for (Circle &circle : circles)
-            {
-                if (isPointInCircle(coordinates.at(0), coordinates.at(1), circle.x, circle.y, circle.radius))
-                {
-                    circle.currentAmount++;
-                    if (circle.expectedAmount == circle.currentAmount)
-                    {
-                        amountCorrect++;
-                    }
-                }
-            }
+            targets.push_back(glm::vec2(ofGetWidth() * (0.15f + x * 0.35f), ofGetHeight() * (0.15f + y * 0.35f)));
         }
     }
+    calibration.start(targets);
+    ofLogNotice("HomographyCalibration") << "calibrating sensor " << getSelectedSensor();
 }
 
-bool ofApp::isPointInCircle(double x, double y, double x_center, double y_center, double radius)
+void ofApp::updateHomographyCalibration(const VisionSnapshot& snapshot)
 {
-    double distance = sqrt(pow(x - x_center, 2) + pow(y - y_center, 2));
-    return distance <= radius;
+    // raw sensor positions, the current calibration doesn't matter here
+    calibrationBlobs.clear();
+    for (const VisionBlob& blob : snapshot.blobs)
+    {
+        if (blob.area >= minBlobSize && blob.area <= maxBlobSize)
+        {
+            calibrationBlobs.push_back(blob.centroid);
+        }
+    }
+    calibration.addFrame(calibrationBlobs, snapshot.timestampMicros / 1000000.0);
+    if (!calibration.isComplete())
+    {
+        return;
+    }
+
+    glm::mat3 homography;
+    float rmsError;
+    if (calibration.solve(homography, rmsError))
+    {
+        SensorCalibration sensorCalibration = sensors.getSensor(getSelectedSensor()).calibration;
+        sensorCalibration.useHomography = true;
+        sensorCalibration.homography = homography;
+        sensors.setCalibration(getSelectedSensor(), sensorCalibration);
+        sensors.saveCalibrations(ofToDataPath("sensors.json"));
+        ofLogNotice("HomographyCalibration") << "sensor " << getSelectedSensor() << " calibrated, " << rmsError << " px rms error";
+    }
+    else
+    {
+        ofLogError("HomographyCalibration") << "the captured positions don't fix a homography, try again";
+    }
+    calibration.cancel();
 }
 
-void ofApp::updateKinect()
+VisionSettings ofApp::getVisionSettings()
 {
-    kinect.update();
-
-    // there is a new frame and we are connected
-    if (kinect.isFrameNew())
+    VisionSettings settings;
+    settings.nearThreshold = nearThreshold;
+    settings.farThreshold = farThreshold;
+    settings.minBlobSize = minBlobSize;
+    settings.maxBlobSize = maxBlobSize;
+    if (syntheticPeople > 0)
     {
-
-        // load grayscale depth image from the kinect source
-        grayImage.setFromPixels(kinect.getDepthPixels());
-
-        // we do two thresholds - one for the far plane and one for the near plane
-        // we then do a cvAnd to get the pixels which are a union of the two thresholds
-        grayThreshNear = grayImage;
-        grayThreshFar = grayImage;
-        grayThreshNear.threshold(nearThreshold, true);
-        grayThreshFar.threshold(farThreshold);
-        cvAnd(grayThreshNear.getCvImage(), grayThreshFar.getCvImage(), grayImage.getCvImage(), NULL);
-
-        // update the cv images
-        grayImage.flagImageChanged();
-
-        // find contours which are between the size of 20 pixels and 1/3 the w*h pixels.
-        // also, find holes is set to true so we will get interior contours as well....
-        contourFinder.findContours(grayImage, minBlobSize, maxBlobSize, 10, false);
+        // the whole crowd, not just the largest few
+        settings.maxBlobs = TrackedPointBuffer::capacity;
     }
+    settings.morphology = (DepthThreshold::Morphology)(int)maskFilter;
+    settings.coarseScale = coarseScale;
+    settings.coarseInterval = coarseInterval;
+    return settings;
 }
 
-void ofApp::updateCircles()
+void ofApp::findBlobs(TrackedPointBuffer& points)
 {
-    if (newRound)
+    points.clear();
+    if (!noKinect)
     {
-        newRound = false;
-        while (numberOfPeople > 0)
-        {
-            int thisCircle = ofRandom(1, numberOfPeople + 1);
-            float new_radius = ofRandom(150 + 100 * thisCircle, 200 + 100 * thisCircle);
-            float new_x = ofRandom(new_radius + 20, ofGetWidth() - (new_radius + 20));
-            float new_y = ofRandom(new_radius + 20, ofGetHeight() - (new_radius + 20));
-            ofColor randomColor = generateRandomColor(200, 255);
-
-            bool overlaps = false;
-
-            for (const Circle &circle : circles)
-            {
-                float distance = ofDist(new_x, new_y, circle.x, circle.y);
-                if (distance < new_radius + circle.radius + 20)
-                {
-                    overlaps = true;
-                    break;
-                }
-            }
-
-            if (!overlaps)
-            {
-                numberOfPeople -= thisCircle;
-                circles.push_back(Circle(new_x, new_y, new_radius, randomColor, thisCircle));
-            }
-        }
-        amountOfCircles = circles.size();
+        // blobs of all sensors in projector coordinates, one point per person in overlap zones
+        sensors.mergeDetections(points, minBlobSize, maxBlobSize);
     }
 }
 
-std::vector<vector<float>> ofApp::findBlobs()
+void ofApp::updateDetections()
 {
-    vector<vector<float>> blobs = {};
-
-    blobs.push_back({ myMouseX, myMouseY });
+    PROFILE_SCOPE("updateDetections");
 
-    if (noKinect)
+    // the synthetic crowd's points stand in for the vision on every frame
+    if (syntheticPeople > 0 && !syntheticDepth)
     {
-        contourFinder.nBlobs = 0;
+        crowd.getDetections(detections);
+        tracker.update(detections.getSpan(), ofGetElapsedTimeMicros() / 1000000.0);
+    }
+    // feed the tracker once per vision frame, at the time the depth frame arrived
+    else if (detectionSequence != sensors.getSequence())
+    {
+        findBlobs(detections);
+        tracker.update(detections.getSpan(), sensors.getNewestTimestampMicros() / 1000000.0);
+        detectionSequence = sensors.getSequence();
     }
-    // Loop through all contours found
-    // Get the current contour
-    if (contourFinder.nBlobs > 0) {
-        //ofLog() << "Amount of Blobs found: " << std::to_string(contourFinder.nBlobs);
-        for (int i = 0; i < contourFinder.nBlobs; i++)
-        {
-            ofxCvBlob blob = contourFinder.blobs[i];
-            float blobSize = blob.area;
-
-            if (blobSize >= minBlobSize && blobSize <= maxBlobSize)
-            {
-                ofPoint centroid = blob.centroid;
-
-                // Transfrom blobs based on beamer size and angle
-                float blobX = centroid.x * (1920 / 640);
-                float blobY = centroid.y * (1080 / 480);
-
-                blobX *= scaleX;
-                blobY *= scaleY;
 
+    // every render frame gets positions predicted to now, even when vision frames are skipped
+    trackedPoints.clear();
+    tracker.predict(ofGetElapsedTimeMicros() / 1000000.0, trackedPoints);
+}
 
-                blobX += translateX;
-                blobY += translateY;
+SensorCalibration ofApp::getSliderCalibration()
+{
+    // a measured homography stays, it wins over the sliders until 'C' drops it
+    SensorCalibration sliderCalibration = sensors.getSensor(getSelectedSensor()).calibration;
+    sliderCalibration.translateX = translateX;
+    sliderCalibration.translateY = translateY;
+    sliderCalibration.rotateAngle = rotateAngle;
+    sliderCalibration.scaleX = scaleX;
+    sliderCalibration.scaleY = scaleY;
+    return sliderCalibration;
+}
 
-                float finalBlobX = blobX * cos(ofDegToRad(rotateAngle)) - blobY * sin(ofDegToRad(rotateAngle));
-                float finalBlobY = blobX * sin(ofDegToRad(rotateAngle)) + blobY * cos(ofDegToRad(rotateAngle));
+void ofApp::showSensorCalibration(int sensor)
+{
+    // the slider listeners would write the half updated values back otherwise
+    showingCalibration = true;
+    const SensorCalibration& sensorCalibration = sensors.getSensor(sensor).calibration;
+    translateX = sensorCalibration.translateX;
+    translateY = sensorCalibration.translateY;
+    rotateAngle = sensorCalibration.rotateAngle;
+    scaleX = sensorCalibration.scaleX;
+    scaleY = sensorCalibration.scaleY;
+    showingCalibration = false;
+}
 
+int ofApp::getSelectedSensor()
+{
+    return ofClamp(sensorIndex, 0, sensors.size() - 1);
+}
 
-                blobs.push_back({ finalBlobX, finalBlobY });
-            }
-        }
+void ofApp::calibrationChanged(float& value)
+{
+    if (sensorsReady && !showingCalibration)
+    {
+        sensors.setCalibration(getSelectedSensor(), getSliderCalibration());
     }
+}
 
-    /*ofLog() << "blobs size: " << blobs.size();
-    for (int i = 0; i < blobs.size(); i++)
+void ofApp::sensorChanged(int& value)
+{
+    if (sensorsReady)
     {
-        ofLog() << "blob " << i << ": x = " << blobs[i].at(0) << ", y = " << blobs[i].at(1);
-    }*/
-    return blobs;
+        showSensorCalibration(getSelectedSensor());
+    }
 }
 
 ofColor ofApp::generateRandomColor(float minBrightness, float maxBrightness) {
@@ -398,272 +591,429 @@ ofColor ofApp::generateRandomColor(float minBrightness, float maxBrightness) {
     return ofColor::fromHsb(hue, saturation, brightness);
 }
 
-void ofApp::setupNewRound()
+void ofApp::updateCircleColors()
 {
-    frame = ofGetFrameNum();
-    circles.clear();
-    newRound = true;
-    amountOfCircles = 0;
-    amountCorrect = 0;
-    background.setVolume(0.2);
-    numberOfPeople = amountOfPlayers;
-    highscore = -1;
+    const BubbleStore& bubbles = simulation.getBubbles();
+    for (int i = 0; i < bubbles.size(); i++)
+    {
+        // buttons are darker so their white label stays readable
+        circleColors[i] = bubbles.getExpectedAmount(i) < 0 ? generateRandomColor(100, 200) : generateRandomColor(200, 255);
+        circleLabels[i] = ofToString(bubbles.getExpectedAmount(i));
+    }
 }
 
 //--------------------------------------------------------------
 void ofApp::draw()
 {
+    if (!startup.isDone())
+    {
+        drawSplash();
+        startup.frameDrawn();
+        return;
+    }
+
+    PROFILE_SCOPE("draw");
+    uint64_t drawStart = ofGetElapsedTimeMicros();
     ofBackground(0, 0, 0);
 
-    if (gameState == gameLoop)
+    gameStateEnum state = game.state;
+    if (calibration.isActive())
+    {
+        drawHomographyCalibration();
+    }
+    else if (state == gameLoop)
     {
         //ofLog() << "draw game loop";
         drawGameLoop();
         //ofLog() << "done";
     }
-    else if (gameState == mainMenu)
+    else if (state == cooldown)
+    {
+        drawCooldown();
+    }
+    else if (state == mainMenu)
     {
         //ofLog() << "draw main menu";
         drawMainMenu();
         //ofLog() << "done";
     }
-    else if (gameState == endScreen)
+    else if (state == endScreen)
     {
         //ofLog() << "draw end screen";
         drawEndScreen();
         //ofLog() << "done";
     }
 
-    drawBlobs();
+    if (renderNode)
+    {
+        drawBlobs(receiver.getFrame().people.getSpan());
+    }
+    else
+    {
+        simulation.getInterpolatedPeople(ofGetElapsedTimeMicros() / 1000000.0, drawnPoints);
+        drawBlobs(drawnPoints.getSpan());
+    }
     if (drawKinect) {
+        uint64_t stageStart = ofGetElapsedTimeMicros();
         drawKinectImages();
+        addFrameSample(drawKinectStage, stageStart);
         gui.draw();
     }
+    if (drawProfilerOverlay)
+    {
+        drawProfiler();
+    }
+    addFrameSample(drawStage, drawStart);
+    endFrameStats();
 }
 
-void ofApp::drawEndScreen()
+void ofApp::addFrameSample(int stage, uint64_t startMicros)
 {
-    newRound = false;
-    std::string highscoreText = "";
-
-    if (highscore == -1)
+    if (capturingFrameStats)
     {
-        highscoreText = "New Highscore!";
+        frameStats.addSample(stage, (double)(ofGetElapsedTimeMicros() - startMicros));
     }
-    else
+}
+
+void ofApp::endFrameStats()
+{
+    if (!capturingFrameStats)
     {
-        highscoreText = "Highscore: " + ofToString(highscore);
+        return;
     }
 
-    ofSetColor(255);
-
-    std::string scoreText = "Your score: " + ofToString(score);
-    ofRectangle boundingBox = title.getStringBoundingBox(scoreText, 0, 0);
-    title.drawString(scoreText, (ofGetWidth() - boundingBox.width) / 2, 500);
+    // the swap follows right after draw(), so the end of draw() stands in for the projection
+    if (drawnVisionSequence != sensors.getSequence())
+    {
+        drawnVisionSequence = sensors.getSequence();
+        frameStats.addSample(endToEndStage, (double)(ofGetElapsedTimeMicros() - sensors.getNewestTimestampMicros()));
+    }
+    frameStats.endFrame(getAllocationCount() - frameStartAllocations);
 
-    boundingBox = headerFont.getStringBoundingBox(highscoreText, 0, 0);
-    headerFont.drawString(highscoreText, (ofGetWidth()-boundingBox.width) / 2, 700);
-    drawCircles();
+    if (frameStats.isFull())
+    {
+        capturingFrameStats = false;
+        frameStats.log("frame");
+        ofJson json = frameStats.toJson();
+        json["benchmark"] = "frame";
+        json["source"] = replayFiles.empty() ? ofJson("kinect") : ofJson(replayFiles);
+        json["sensors"] = numSensors;
+        json["threadedVision"] = threadedVision;
+        ofSavePrettyJson(ofToDataPath("frame_stats_" + ofGetTimestampString() + ".json"), json);
+    }
 }
 
-void ofApp::drawMainMenu()
+void ofApp::drawProfiler()
 {
-    ofSetColor(255, 255, 255);
-    std::string text = "Welcome to Crazy Bubbles!";
-    ofRectangle boundingBox = title.getStringBoundingBox(text, 0, 0);
-    title.drawString(text, (ofGetWidth() - boundingBox.width) / 2, 250);
+    // the text is rebuilt twice a second, drawing it every frame is cheap
+    uint64_t now = Profiler::now();
+    if (now - profilerRefreshMicros >= 500000)
+    {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2);
+        text << "frame " << ofGetLastFrameTime() * 1000.0 << " ms (" << ofGetFrameRate() << " fps)\n";
+        for (int i = 0; i < sensors.size(); i++)
+        {
+            const VisionSnapshot& snapshot = sensors.getSensor(i).vision.getSnapshot();
+            text << "vision " << i << " " << snapshot.processMicros / 1000.0 << " ms, " << snapshot.blobs.size() << " blobs, "
+                << (int)(snapshot.coverage * 100) << "% in full\n";
+        }
+        text << "merged " << detections.size() << " people\n";
+        text << "dropped depth frames " << sensors.getDroppedFrames() << "\n";
+        text << "bubbles " << bubbleRenderer.getModeName() << "\n";
+        const AudioMixer& mixer = audio.getMixer();
+        text << "audio " << (audio.getBackend() == AudioEngine::soundCard ? "" : "(null) ") << mixer.getLastLatencyMicros() / 1000.0
+            << " ms late, " << mixer.getMaxLatencyMicros() / 1000.0 << " ms max, mix " << mixer.getLastMixMicros() << " us, "
+            << mixer.getActiveVoices() << " voices\n";
+        if (publisher.isOpen())
+        {
+            text << "published frame " << publisher.getSequence() << ", " << publisher.getLastPacketSize() << " bytes\n";
+        }
+        if (renderNode)
+        {
+            text << "received frame " << receiver.getFrame().sequence << ", " << receiver.getLostFrames() << " lost, "
+                << receiver.getStaleFrames() << " stale\n";
+        }
+#if CRAZYBUBBLES_PROFILER
+        Profiler::summarize(profilerRefreshMicros, profilerZones);
+        double seconds = std::max((now - profilerRefreshMicros) / 1000000.0, 0.001);
+        for (const ProfileZone& zone : profilerZones)
+        {
+            text << Profiler::getThreadName(zone.thread) << " " << zone.name << ": " << zone.totalMicros / 1000.0 / std::max(zone.count, 1)
+                << " ms avg, " << zone.maxMicros / 1000.0 << " ms max, " << zone.count / seconds << "/s\n";
+        }
+#endif
+        profilerText = text.str();
+        profilerRefreshMicros = now;
+    }
 
-    text = "Amount of players: " + ofToString(amountOfPlayers);
-    boundingBox = font.getStringBoundingBox(text, 0, 0);
-    font.drawString(text, (ofGetWidth() - boundingBox.width) / 2, ofGetHeight() - 400);
-    drawCircles();
+    ofPushStyle();
+    ofSetColor(0, 0, 0, 180);
+    ofDrawRectangle(ofGetWidth() - 620, ofGetHeight() - 420, 610, 410);
+    ofSetColor(255);
+    ofDrawBitmapString(profilerText, ofGetWidth() - 610, ofGetHeight() - 400);
+    ofPopStyle();
 }
 
-void ofApp::drawGameLoop()
+void ofApp::drawEndScreen()
 {
-    if (rounds > roundAmount)
-    { // game is over
-        setupEndScreen();
+    ofSetColor(255);
+    textCache.drawCentered(title, scoreLabel.get(game.score), ofGetWidth() / 2, 500);
+
+    if (highscore == -1)
+    {
+        textCache.drawCentered(headerFont, "New Highscore!", ofGetWidth() / 2, 700);
     }
     else
     {
-        auto current_time = std::chrono::steady_clock::now();
-        auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds>(current_time - startTime).count();
+        textCache.drawCentered(headerFont, highscoreLabel.get(highscore), ofGetWidth() / 2, 700);
+    }
+    drawCircles();
+}
 
-        if (ofGetFrameNum() == frame + 1 && ofGetFrameNum() > 1)
-        { // frame after a new round
-            ofSleepMillis(2000);
-            background.setVolume(1);
-            startTime = std::chrono::steady_clock::now();
-            rounds++;
-        }
-        else if (amountCorrect == amountOfCircles && amountOfCircles != 0)
+void ofApp::drawHomographyCalibration()
+{
+    const std::vector<glm::vec2>& targets = calibration.getTargets();
+    bubbleRenderer.begin();
+    for (int i = 0; i < (int)targets.size(); i++)
+    {
+        if (i < calibration.getCurrentTarget())
         {
-            score += 50 * (duration.count() - elapsed_time);
-            setupNewRound();
-            ofBackground(0, 255, 0);
-            correct.play();
+            bubbleRenderer.addCircle(targets[i].x, targets[i].y, 20, ofColor(0, 200, 0));
         }
-        else if (elapsed_time >= duration.count())
+        else if (i == calibration.getCurrentTarget())
         {
-            setupNewRound();
-            ofBackground(255, 0, 0);
-            incorrect.play();
+            bubbleRenderer.addCircle(targets[i].x, targets[i].y, 12, ofColor(255));
+            bubbleRenderer.addRing(targets[i].x, targets[i].y, 70, 60, ofColor(255));
+            bubbleRenderer.addRing(targets[i].x, targets[i].y, 90, 76, ofColor(0, 200, 0), calibration.getHoldProgress());
         }
         else
         {
-            ofBackground(0, 0, 0);
-            ofApp::drawCircles();
-
-            // draw info
-            ofSetColor(255, 255, 255);
-            font.drawString("Time: " + ofToString(duration.count() - elapsed_time), ofGetWidth() - 300, 100);
-            font.drawString("Score: " + ofToString(score), ofGetWidth() - 300, 200);
-            font.drawString("Round: " + ofToString(rounds), ofGetWidth() - 300, 300);
-
-            for (Circle &circle : circles)
-            {
-                circle.currentAmount = 0;
-            }
-            amountCorrect = 0;
+            bubbleRenderer.addRing(targets[i].x, targets[i].y, 40, 34, ofColor(100));
         }
     }
+    bubbleRenderer.draw();
+
+    ofSetColor(255);
+    ofDrawBitmapString("calibrating sensor " + ofToString(getSelectedSensor()) + ": one person stands still on the white target, 'c' cancels",
+        ofGetWidth() / 2 - 300, ofGetHeight() / 2);
 }
 
-void ofApp::drawBlobs()
+void ofApp::drawSplash()
+{
+    // no fonts yet, just a progress bar
+    ofBackground(0, 0, 0);
+    float width = ofGetWidth() / 3.0f;
+    float x = (ofGetWidth() - width) / 2;
+    float y = ofGetHeight() / 2.0f;
+    ofSetColor(60);
+    ofDrawRectangle(x, y, width, 10);
+    ofSetColor(255);
+    ofDrawRectangle(x, y, width * startup.getProgress(), 10);
+    ofDrawBitmapString("Crazy Bubbles", x, y - 20);
+    ofSetColor(150);
+    ofDrawBitmapString(startup.getCurrentPhase(), x, y + 34);
+}
+
+void ofApp::drawMainMenu()
+{
+    ofSetColor(255, 255, 255);
+    textCache.drawCentered(title, "Welcome to Crazy Bubbles!", ofGetWidth() / 2, 250);
+    textCache.drawCentered(font, playersLabel.get(game.amountOfPlayers), ofGetWidth() / 2, ofGetHeight() - 400);
+    drawCircles();
+}
+
+void ofApp::drawGameLoop()
 {
-    vector<vector<float>> blobs = ofApp::findBlobs();
-    for (int i = 0; i < blobs.size(); i++)
+    ofBackground(0, 0, 0);
+    ofApp::drawCircles();
+
+    // draw info
+    ofSetColor(255, 255, 255);
+    textCache.draw(font, timeLabel.get(game.remainingSeconds), ofGetWidth() - 300, 100);
+    textCache.draw(font, gameScoreLabel.get(game.score), ofGetWidth() - 300, 200);
+    textCache.draw(font, roundLabel.get(game.round), ofGetWidth() - 300, 300);
+}
+
+void ofApp::drawCooldown()
+{
+    // result of the last round, shown until the next one starts
+    ofBackground(game.lastRoundWon ? ofColor(0, 255, 0) : ofColor(255, 0, 0));
+}
+
+void ofApp::drawBlobs(TrackedPointSpan points)
+{
+    bubbleRenderer.begin();
+    for (int i = 0; i < points.size(); i++)
     {
-        vector<float> blobCoordinates = blobs[i];
-        if (blobCoordinates.at(0) >= 0)
-        {
-            ofColor white(255, 255, 255);
-            ofSetColor(white);
-            ofDrawCircle(blobCoordinates.at(0), blobCoordinates.at(1), 15);
-        }
+        bubbleRenderer.addCircle(points.x[i], points.y[i], 15, ofColor(255));
     }
+    bubbleRenderer.draw();
 }
 
 void ofApp::drawKinectImages()
 {
-    ofSetColor(255, 255, 255);
-    // draw from the live kinect
-    kinect.drawDepth(10, 10, 800, 600);
-    kinect.draw(820, 10, 800, 600);
-
-    grayImage.draw(10, 620, 800, 600);
-    contourFinder.draw(820, 620, 800, 600);
+    PROFILE_SCOPE("drawKinectImages");
+    debugView.draw(nearThreshold, farThreshold);
 }
 
 void ofApp::drawCircles()
 {
-    for (const Circle &circle : circles)
+    PROFILE_SCOPE("drawCircles");
+    uint64_t stageStart = ofGetElapsedTimeMicros();
+    const BubbleStore& bubbles = game.bubbles;
+
+    // all bubbles in one draw call, during a round a ring shows how full each one is
+    bubbleRenderer.begin();
+    for (int c = 0; c < bubbles.size(); c++)
     {
-        ofSetColor(circle.color);
-        ofDrawCircle(circle.x, circle.y, circle.radius);
+        float x = bubbles.getX(c);
+        float y = bubbles.getY(c);
+        float radius = bubbles.getRadius(c);
+        int expectedAmount = bubbles.getExpectedAmount(c);
+        bubbleRenderer.addCircle(x, y, radius, circleColors[c]);
+        if (game.state == gameLoop && expectedAmount > 0 && bubbles.getCurrentAmount(c) > 0)
+        {
+            float filled = std::min((float)bubbles.getCurrentAmount(c) / expectedAmount, 1.0f);
+            bubbleRenderer.addRing(x, y, radius, radius - 12, ofColor(255, 255, 255, 200), filled);
+        }
+    }
+    bubbleRenderer.draw();
 
-        if (circle.expectedAmount > 0)
+    for (int c = 0; c < bubbles.size(); c++)
+    {
+        float x = bubbles.getX(c);
+        float y = bubbles.getY(c);
+        int expectedAmount = bubbles.getExpectedAmount(c);
+        if (expectedAmount > 0)
         {
             ofSetColor(0);
-            std::string circleText = ofToString(circle.expectedAmount);
-            ofRectangle boundingBox = font.getStringBoundingBox(circleText, 0, 0);
-            font.drawString(circleText, circle.x - boundingBox.width / 2, circle.y + boundingBox.height / 2);
+            const std::string& circleText = circleLabels[c];
+            ofRectangle boundingBox = textCache.getBoundingBox(font, circleText);
+            textCache.draw(font, circleText, x - boundingBox.width / 2, y + boundingBox.height / 2);
         }
-        else 
+        else
         {
-            vector<std::string> texts = {};
-            if (circle.expectedAmount == -2) {
-                texts.push_back("Start");
-                texts.push_back("Game");
-            }
-            else if (circle.expectedAmount == -3) {
-                texts.push_back("Play");
-                texts.push_back("again");
-            }
+            // buttons carry a two line label
+            static const std::string startLabel[2] = { "Start", "Game" };
+            static const std::string playAgainLabel[2] = { "Play", "again" };
+            const std::string* texts = expectedAmount == -2 ? startLabel : expectedAmount == -3 ? playAgainLabel : nullptr;
 
             ofSetColor(255);
-            for (int i = 0; i < texts.size(); i++)
+            for (int i = 0; texts != nullptr && i < 2; i++)
             {
-                ofRectangle boundingBox = headerFont.getStringBoundingBox(texts[i], 0, 0);
-                headerFont.drawString(texts[i], circle.x - boundingBox.width / 2,(circle.y - 80) + (i*150) + boundingBox.height / 2);
+                ofRectangle boundingBox = textCache.getBoundingBox(headerFont, texts[i]);
+                textCache.draw(headerFont, texts[i], x - boundingBox.width / 2, (y - 80) + (i * 150) + boundingBox.height / 2);
             }
         }
     }
+    addFrameSample(drawCirclesStage, stageStart);
 }
 
 //--------------------------------------------------------------
 void ofApp::exit()
 {
+    startup.wait();
+    if (benchmarks.valid())
+    {
+        benchmarks.wait();
+    }
     ofLog() << std::to_string(minBlobSize);
     gui.saveToFile("kinect_settings.json");
-    kinect.setCameraTiltAngle(0); // zero the tilt on exit
-    kinect.close();
+    recorder.close();
+    scores.close();
+    publisher.close();
+    receiver.close();
+    audio.close();
+    if (sensorsReady)
+    {
+        sensors.saveCalibrations(ofToDataPath("sensors.json"));
+    }
+    sensors.close();
     ofLog() << "Exit";
 }
 
 //--------------------------------------------------------------
 
-void ofApp::writeToFile(int score)
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key)
 {
-    std::string filePath = ofToDataPath("scores_" + std::to_string(amountOfPlayers) + "_" + std::to_string(roundAmount) + ".txt");
-    std::ofstream outputFile(filePath, std::ios::app);
-
-    if (outputFile.is_open())
+    if (!startup.isDone())
     {
-        outputFile << to_string(score) << std::endl;
-        outputFile.close();
+        return;
     }
-    else
-    {
-        ofLogError() << "Fehler beim oeffnen der Datei zum Schreiben.";
-
+    if (key == 'p') {
+        simulation.pushEvent(ofGetElapsedTimeMicros() / 1000000.0, GameEvent::skipToEnd);
     }
-}
-
-int ofApp::getHighScoreFromFile()
-{
-    std::string filePath = ofToDataPath("scores_" + std::to_string(amountOfPlayers) + "_" + std::to_string(roundAmount) + ".txt");
-    // Pr�fe, ob die Datei existiert, und erstelle sie, falls nicht
-    std::ofstream outputFile(filePath, std::ios::app); // �ffnen im Anh�ngemodus erstellt die Datei, wenn sie nicht existiert
-    outputFile.close(); // Sofort wieder schlie�en
-
-    std::ifstream inputFile(filePath);
-    int highscore = 0;
-
-    if (inputFile.is_open())
-    {
-        std::string line;
-        while (std::getline(inputFile, line))
+    else if (key == 'b') {
+        if (benchmarks.valid() && benchmarks.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
         {
-            try {
-                int score = std::stoi(line);
-                if (score > highscore)
-                {
-                    highscore = score;
-                }
-            }
-            catch (const std::invalid_argument&) {
-                ofLogError() << "Ungueltige Zeile in der Datei: " << line;
-            }
-            catch (const std::out_of_range&) {
-                ofLogError() << "Wert ausserhalb des gueltigen Bereichs in der Datei: " << line;
+            ofLogNotice("Benchmark") << "still running";
+            return;
+        }
+        // seconds of work, the projection and the vision hand-off keep going meanwhile
+        VisionSettings settings = getVisionSettings();
+        std::vector<std::string> recordings;
+        for (const std::string& replayFile : replayFiles)
+        {
+            recordings.push_back(ofToDataPath(replayFile));
+        }
+        benchmarks = std::async(std::launch::async, [settings, recordings]() {
+            runThresholdBenchmark();
+            runPlacementBenchmark();
+            runLabelerBenchmark("", settings);
+            runAudioBenchmark();
+            for (const std::string& recording : recordings)
+            {
+                runPipelineBenchmark(recording, settings);
             }
+            ofLogNotice("Benchmark") << "done";
+        });
+    }
+    else if (key == 'B') {
+        frameStats.clear();
+        drawnVisionSequence = sensors.getSequence();
+        capturingFrameStats = true;
+        ofLogNotice("Benchmark") << "capturing " << frameStatsFrames << " frames";
+    }
+    else if (key == 't') {
+        std::string path = ofToDataPath("trace_" + ofGetTimestampString() + ".json");
+        if (Profiler::exportChromeTrace(path))
+        {
+            ofLogNotice() << "trace written to " << path;
         }
-        inputFile.close();
     }
-    else
-    {
-        ofLogError() << "Fehler beim oeffnen der Datei zum Lesen.";
+    else if (key == 'c') {
+        if (calibration.isActive())
+        {
+            calibration.cancel();
+        }
+        else
+        {
+            startHomographyCalibration();
+        }
     }
-    return highscore;
-}
-
-//--------------------------------------------------------------
-void ofApp::keyPressed(int key)
-{
-    if (key == 'p') {
-        setupEndScreen();
+    else if (key == 'C') {
+        // back to the sliders
+        SensorCalibration sensorCalibration = sensors.getSensor(getSelectedSensor()).calibration;
+        sensorCalibration.useHomography = false;
+        sensors.setCalibration(getSelectedSensor(), sensorCalibration);
+    }
+    else if ((key == '+' || key == '-') && syntheticPeople > 0) {
+        crowdSize = std::max(std::min(crowdSize + (key == '+' ? 5 : -5), SyntheticCrowd::maxPeople), 0);
+        crowd.setPeople(crowdSize);
+        ofLogNotice("SyntheticCrowd") << crowdSize << " people";
+    }
+    else if (key == 'r') {
+        if (recorder.isOpen())
+        {
+            recorder.close();
+        }
+        else
+        {
+            const DepthSource& source = *sensors.getSensor(getSelectedSensor()).source;
+            recorder.open(ofToDataPath("depth_" + ofGetTimestampString() + ".cbd"), source.getWidth(), source.getHeight());
+        }
     }
 }
 
@@ -680,8 +1030,11 @@ void ofApp::mousePressed(int x, int y, int button)
 //--------------------------------------------------------------
 void ofApp::mouseReleased(int x, int y, int button)
 {
-    myMouseX = x * 1.0;
-    myMouseY = y * 1.0;
+    // the mouse stands in for a person when testing without a kinect
+    if (startup.isDone())
+    {
+        simulation.pushClick(ofGetElapsedTimeMicros() / 1000000.0, x, y);
+    }
 }
 
 //--------------------------------------------------------------
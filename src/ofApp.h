@@ -5,22 +5,28 @@
 #include "ofxKinect.h"
 #include "ofxCvBlob.h"
 #include "ofxGui.h"
-
+#include "VisionWorker.h"
+#include "DepthRecording.h"
+#include "SensorManager.h"
+#include "DepthDebugView.h"
+#include "PipelineStats.h"
+#include "Profiler.h"
+#include "TextCache.h"
+#include "BubbleRenderer.h"
+#include "TrackedPoints.h"
+#include "PersonTracker.h"
+#include "GameSimulation.h"
+#include "ScoreStore.h"
+#include "FontAtlas.h"
+#include "Startup.h"
+#include "NetworkSync.h"
+#include "SyntheticCrowd.h"
+#include "AudioEngine.h"
+
+#include <array>
+#include <future>
 #include <vector>
 #include <cmath>
-#include <chrono>
-
-class Circle {
-public:
-    Circle(float x_, float y_, float radius_, ofColor color_, int expectedAmount_) : x(x_), y(y_), radius(radius_), color(color_), expectedAmount(expectedAmount_) {}
-
-    float x;
-    float y;
-    float radius;
-    ofColor color;
-    int expectedAmount;
-    int currentAmount = 0;
-};
 
 class ofApp : public ofBaseApp {
 public:
@@ -37,67 +43,145 @@ public:
     void mouseEntered(int x, int y);
     void mouseExited(int x, int y);
     void windowResized(int w, int h);
-    void writeToFile(int score);
-    int getHighScoreFromFile();
 
     void setupGui();
     void setupKinect();
     void setupAssets();
-    void setupMainMenu();
-    void setupEndScreen();
-    void startGame();
-    void updateEndScreen();
-    void updateMainMenu();
-    void updateCircles();
+    void setupGame();
     void updateKinect();
-    void updateContours();
+    VisionSettings getVisionSettings();
+    void handleOutputs();
+    void publishFrame();
+    void updateFromNetwork();
     void drawKinectImages();
     void drawGameLoop();
+    void drawSplash();
     void drawMainMenu();
     void drawEndScreen();
     void drawCircles();
-    void drawBlobs();
-    std::vector<std::vector<float>> findBlobs();
+    void drawBlobs(TrackedPointSpan points);
+    void findBlobs(TrackedPointBuffer& points);
+    void updateDetections();
+    SensorCalibration getSliderCalibration();
+    void showSensorCalibration(int sensor);
+    int getSelectedSensor();
+    void calibrationChanged(float& value);
+    void sensorChanged(int& value);
+    void startHomographyCalibration();
+    void updateHomographyCalibration(const VisionSnapshot& snapshot);
+    void drawHomographyCalibration();
     ofColor generateRandomColor(float minBrightness, float maxBrightness);
-    bool isPointInCircle(double x, double y, double x_center, double y_center, double radius);
-    void setupNewRound();
-
-    //fonts
-    ofTrueTypeFont title;
-    ofTrueTypeFont font;
-    ofTrueTypeFont headerFont;
-
-    //sounds
-    ofSoundPlayer correct;
-    ofSoundPlayer incorrect;
-    ofSoundPlayer background;
-    ofSoundPlayer outro;
+    void updateCircleColors();
+    void drawCooldown();
+    void addFrameSample(int stage, uint64_t startMicros);
+    void endFrameStats();
+    void drawProfiler();
 
+    // setup() only queues work, update() runs it while a splash is drawn
+    Startup startup;
 
-    //circles
-    vector<Circle> circles;
-
-    enum gameStateEnum
+    //fonts
+    FontAtlas title;
+    FontAtlas font;
+    FontAtlas headerFont;
+    FontAtlas::Data titleData; // filled by the startup workers
+    FontAtlas::Data fontData;
+    FontAtlas::Data headerFontData;
+
+    // bubbles and blob markers, one draw call each
+    BubbleRenderer bubbleRenderer;
+
+    // labels are laid out once and redrawn from the cache
+    TextCache textCache;
+    NumberLabel timeLabel{ "Time: " };
+    NumberLabel gameScoreLabel{ "Score: " };
+    NumberLabel roundLabel{ "Round: " };
+    NumberLabel scoreLabel{ "Your score: " };
+    NumberLabel highscoreLabel{ "Highscore: " };
+    NumberLabel playersLabel{ "Amount of players: " };
+
+    // sound cues, decoded by startup workers and mixed on the audio thread
+    enum Sound
     {
-        mainMenu = 0,
-        gameLoop = 1,
-        endScreen = 2
+        correctSound,
+        incorrectSound,
+        outroSound,
+        backgroundSound,
+        numSounds
     };
-    gameStateEnum gameState = mainMenu;
-
-
-    ofxKinect kinect;
-
-    ofxCvColorImage colorImg;
-
-    ofxCvGrayscaleImage grayImage; // grayscale depth image
-    ofxCvGrayscaleImage grayThreshNear; // the near thresholded image
-    ofxCvGrayscaleImage grayThreshFar; // the far thresholded image
-
-    ofxCvContourFinder contourFinder;
+    std::array<AudioCue, numSounds> sounds;
+    AudioEngine audio;
+
+
+    // game logic at a fixed tick rate, the app only feeds it input and draws its state
+    GameSimulation simulation;
+    // per bubble slot, picked when the layout changes
+    std::array<ofColor, BubbleStore::capacity> circleColors;
+    std::array<std::string, BubbleStore::capacity> circleLabels; // expected amount as text
+    int highscore = -1;
+    ScoreStore scores; // per players and rounds, in data/scores
+
+    // what draw() shows, from the simulation or, on a render node, from the network
+    GameSnapshot game;
+
+    // the sensing box publishes every vision frame, render nodes receive them
+    NetworkPublisher publisher;
+    NetworkReceiver receiver;
+    NetworkFrame networkFrame;
+    uint64_t publishedVisionSequence = 0;
+    uint64_t lastPublishMicros = 0;
+    uint32_t receivedSession = 0;
+
+    // raw blobs of the latest vision snapshot in projector coordinates,
+    // rebuilt only when a new snapshot arrives
+    TrackedPointBuffer detections;
+    uint64_t detectionSequence = 0;
+
+    // turns detections into people with stable ids
+    PersonTracker tracker;
+
+    // walks the floor instead of real people for load tests, see syntheticPeople
+    SyntheticCrowd crowd;
+    int crowdSize = 0;
+
+    // tracked people predicted to the current frame, in projector coordinates.
+    // filled once per frame by updateDetections(), everything else only reads it
+    TrackedPointBuffer trackedPoints;
+
+    // the calibration sliders edit the sensor picked with sensorIndex
+    bool calibrationsLoaded = false; // data/sensors.json existed
+    bool sensorsReady = false;
+    bool showingCalibration = false;
+
+    // projected targets matched to blobs of the selected sensor, toggled with 'c'
+    HomographyCalibration calibration;
+    std::vector<glm::vec2> calibrationBlobs;
+
+    // people of the last two simulation ticks blended to the render time
+    TrackedPointBuffer drawnPoints;
+
+    // the 'b' benchmarks, run off the render thread, results go to the log
+    std::future<void> benchmarks;
+
+    // per stage frame timing, captured for a few seconds with 'B' and written to data/
+    PipelineStats frameStats;
+    bool capturingFrameStats = false;
+    uint64_t frameStartAllocations = 0;
+    uint64_t drawnVisionSequence = 0; // newest snapshot whose latency was recorded
+
+    // profiler overlay, refreshed twice a second
+    uint64_t profilerRefreshMicros = 0;
+    vector<ProfileZone> profilerZones;
+    std::string profilerText;
+
+
+    // kinects or recordings, see numSensors and replayFiles. thresholding and
+    // contour finding run on one thread per sensor, off the render thread
+    SensorManager sensors;
+    DepthRecorder recorder; // toggled with 'r', records the selected sensor
+    DepthDebugView debugView; // drawn while drawKinect is on, shows the selected sensor
 
     bool bThreshWithOpenCV;
-    int angle;
 
     // used for viewing the point cloud
     ofEasyCam easyCam;
@@ -108,6 +192,8 @@ public:
     ofxIntSlider farThreshold;
     ofxIntSlider minBlobSize;
     ofxIntSlider maxBlobSize;
+    ofxIntSlider maskFilter; // 0 = off, 1 = open, 2 = close
+    ofxIntSlider sensorIndex; // sensor the calibration sliders and the debug view belong to
 
     ofxFloatSlider translateX;
     ofxFloatSlider translateY;
@@ -116,4 +202,5 @@ public:
     ofxFloatSlider scaleY;
 
     ofxToggle drawKinect;
+    ofxToggle drawProfilerOverlay;
 };